@@ -77,6 +77,8 @@ class callback : public virtual mqtt::callback
 	// This will initiate the attempt to manually reconnect.
 	void connection_lost(const std::string& cause) override {
 		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "connection_lost: {}", cause);
+		assert(pcli);
+		pcli->connection_lost(cause);
 	}
 
 	// Callback for when a message arrives.
@@ -88,661 +90,221 @@ class callback : public virtual mqtt::callback
 
 		first_message_arrived = true;
 
-#ifdef CLIENT_MPO
-		if (msg->get_topic() == TOPIC_OUTPUT_STATE_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED state ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					mpo_.requestQuit();
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_VGR_DO) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED vgr do:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				ft::TxtVgrDoCode_t code = (ft::TxtVgrDoCode_t)root["code"].asInt();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtWorkpiece* wp = NULL;
-					if (root["workpiece"] != Json::Value::null) {
-						wp = new ft::TxtWorkpiece();
-						wp->tag_uid = root["workpiece"]["id"].asString();
-						std::string stype = root["workpiece"]["type"].asString();
-						if (stype == "WHITE") {
-							wp->type = ft::WP_TYPE_WHITE;
-						} else if(stype == "RED") {
-							wp->type = ft::WP_TYPE_RED;
-						} else if (stype == "BLUE") {
-							wp->type = ft::WP_TYPE_BLUE;
-						} else {
-							wp->type = ft::WP_TYPE_NONE;
-						}
-						std::string sstate = root["workpiece"]["state"].asString();
-						if (sstate == "RAW") {
-							wp->state = ft::WP_STATE_RAW;
-						} else if(sstate == "PROCESSED") {
-							wp->state = ft::WP_STATE_PROCESSED;
-						} else if (sstate == "REJECTED") {
-							wp->state = ft::WP_STATE_REJECTED;
-						}
-					}
-
-					switch(code)
-					{
-					case ft::VGR_EXIT:
-						mpo_.requestExit("VGR");
-						break;
-					case ft::VGR_MPO_PRODUCE:
-						mpo_.requestVGRproduce(wp);
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_SLD_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED SLD ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				ft::TxtSldAckCode_t code = (ft::TxtSldAckCode_t)root["code"].asInt();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					switch (code)
-					{
-					case ft::SLD_EXIT:
-						mpo_.requestExit("SLD");
-						break;
-					case ft::SLD_STARTED:
-						mpo_.requestSLDstarted();
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else {
+		if (!cli_.dispatch(msg)) {
+			//unknown or undecodable: dropped, a bad publisher must not stop the station
 			std::cout << "Unknown topic: " << msg->get_topic() << std::endl;
 			spdlog::get("file_logger")->error("Unknown topic: {}",msg->get_topic());
-			exit(1);
 		}
-#elif CLIENT_HBW
-		if (msg->get_topic() == TOPIC_OUTPUT_STATE_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED state ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					hbw_.requestQuit();
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_SSC_JOY) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED joy:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtJoysticksData jd;
-					jd.aX1 = root["aX1"].asInt();
-					jd.aY1 = root["aY1"].asInt();
-					jd.b1 = root["b1"].asBool();
-					jd.aX2 = root["aX2"].asInt();
-					jd.aY2 = root["aY2"].asInt();
-					jd.b2 = root["b2"].asBool();
-					hbw_.requestJoyBut(jd);
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  1:{} {} {} 2:{} {} {}", jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_VGR_DO) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED vgr do:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				ft::TxtVgrDoCode_t code = (ft::TxtVgrDoCode_t)root["code"].asInt();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtWorkpiece* wp = NULL;
-					if (root["workpiece"] != Json::Value::null) {
-						wp = new ft::TxtWorkpiece();
-						wp->tag_uid = root["workpiece"]["id"].asString();
-						std::string stype = root["workpiece"]["type"].asString();
-						if (stype == "WHITE") {
-							wp->type = ft::WP_TYPE_WHITE;
-						} else if(stype == "RED") {
-							wp->type = ft::WP_TYPE_RED;
-						} else if (stype == "BLUE") {
-							wp->type = ft::WP_TYPE_BLUE;
-						} else {
-							wp->type = ft::WP_TYPE_NONE;
-						}
-						std::string sstate = root["workpiece"]["state"].asString();
-						if (sstate == "RAW") {
-							wp->state = ft::WP_STATE_RAW;
-						} else if(sstate == "PROCESSED") {
-							wp->state = ft::WP_STATE_PROCESSED;
-						} else if (sstate == "REJECTED") {
-							wp->state = ft::WP_STATE_REJECTED;
-						}
-					}
-
-					switch(code)
-					{
-					case ft::VGR_EXIT:
-						hbw_.requestExit("VGR");
-						break;
-					case ft::VGR_HBW_FETCHCONTAINER:
-						hbw_.requestVGRfetchContainer(wp);
-						break;
-					case ft::VGR_HBW_STORE_WP:
-						hbw_.requestVGRstore(wp);
-						break;
-					case ft::VGR_HBW_FETCH_WP:
-						hbw_.requestVGRfetch(wp);
-						break;
-					case ft::VGR_HBW_STORECONTAINER:
-						hbw_.requestVGRstoreContainer(wp);
-						break;
-					case ft::VGR_HBW_CALIB:
-						hbw_.requestVGRcalib();
-						break;
-					case ft::VGR_HBW_RESETSTORAGE:
-						hbw_.requestVGRresetStorage();
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
+	}
+
+	void delivery_complete(mqtt::delivery_token_ptr token) override {
+		if (token) {
+			SPDLOG_LOGGER_TRACE(spdlog::get("console"), "delivery_complete: {}: {}", token->get_message_id(), token->get_message()->get_topic());
 		} else {
-			std::cout << "Unknown topic: " << msg->get_topic() << std::endl;
-			spdlog::get("file_logger")->error("Unknown topic: {}",msg->get_topic());
-			exit(1);
-		}
-#elif CLIENT_VGR
-		if (msg->get_topic() == TOPIC_OUTPUT_STATE_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED state ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					vgr_.requestQuit();
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_OUTPUT_ORDER) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED order:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					std::string stype = root["type"].asString();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  type:{}", stype);
-					if (stype == "WHITE")
-					{
-						vgr_.requestOrder(ft::WP_TYPE_WHITE);
-					} else if(stype == "RED")
-					{
-						vgr_.requestOrder(ft::WP_TYPE_RED);
-					} else if (stype == "BLUE")
-					{
-						vgr_.requestOrder(ft::WP_TYPE_BLUE);
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		}
-		else if (msg->get_topic() == TOPIC_OUTPUT_PICKUP) 
-		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED pickup: {}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					std::string sid = root["id"].asString();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  tag_uid:{}", sid);
-					vgr_.requestPickup(sid);
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
+			SPDLOG_LOGGER_TRACE(spdlog::get("console"), "delivery token is NULL",0);
 		}
-		else if (msg->get_topic() == TOPIC_OUTPUT_STORE) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED store: {}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					vgr_.storeWorkpieceFromDSOIntoHBW();
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+	}
+
+	// Handlers of the subscribed topics, called by the router
+	void addHandlers() {
+		ft::TxtMqttTopicRouter& router = cli_.getRouter();
+#ifdef CLIENT_MPO
+		router.add(ft::TOPIC_ID_OUTPUT_STATE_ACK, 0, [this](const ft::TxtMqttMessage& m) {
+			mpo_.requestQuit();
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_VGR_DO, ft::FIELD_CODE|ft::FIELD_WORKPIECE, [this](const ft::TxtMqttMessage& m) {
+			switch((ft::TxtVgrDoCode_t)m.code)
+			{
+			case ft::VGR_EXIT:
+				mpo_.requestExit("VGR");
+				break;
+			case ft::VGR_MPO_PRODUCE:
+				mpo_.requestVGRproduce(m.newWorkpiece());
+				break;
+			default:
+				break;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		}
-		else if (msg->get_topic() == TOPIC_OUTPUT_NFC_DS) 
-		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED nfc ds:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					std::string scmd = root["cmd"].asString();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  cmd:{}", scmd);
-					if (scmd == "read")
-					{
-						vgr_.requestNfcRead();
-					} else if (scmd == "delete") {
-						vgr_.requestNfcDelete();
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		}, true);
+#elif CLIENT_HBW
+		router.add(ft::TOPIC_ID_OUTPUT_STATE_ACK, 0, [this](const ft::TxtMqttMessage& m) {
+			hbw_.requestQuit();
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_SSC_JOY, ft::FIELD_JOY, [this](const ft::TxtMqttMessage& m) {
+			ft::TxtJoysticksData jd = m.joy;
+			hbw_.requestJoyBut(jd);
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  1:{} {} {} 2:{} {} {}", jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_VGR_DO, ft::FIELD_CODE|ft::FIELD_WORKPIECE, [this](const ft::TxtMqttMessage& m) {
+			switch((ft::TxtVgrDoCode_t)m.code)
+			{
+			case ft::VGR_EXIT:
+				hbw_.requestExit("VGR");
+				break;
+			case ft::VGR_HBW_FETCHCONTAINER:
+				hbw_.requestVGRfetchContainer(m.newWorkpiece());
+				break;
+			case ft::VGR_HBW_STORE_WP:
+				hbw_.requestVGRstore(m.newWorkpiece());
+				break;
+			case ft::VGR_HBW_FETCH_WP:
+				hbw_.requestVGRfetch(m.newWorkpiece());
+				break;
+			case ft::VGR_HBW_STORECONTAINER:
+				hbw_.requestVGRstoreContainer(m.newWorkpiece());
+				break;
+			case ft::VGR_HBW_CALIB:
+				hbw_.requestVGRcalib();
+				break;
+			case ft::VGR_HBW_RESETSTORAGE:
+				hbw_.requestVGRresetStorage();
+				break;
+			default:
+				break;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} 
-		else if (msg->get_topic() == TOPIC_LOCAL_SSC_JOY) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED joy but:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtJoysticksData jd;
-					jd.aX1 = root["aX1"].asInt();
-					jd.aY1 = root["aY1"].asInt();
-					jd.b1 = root["b1"].asBool();
-					jd.aX2 = root["aX2"].asInt();
-					jd.aY2 = root["aY2"].asInt();
-					jd.b2 = root["b2"].asBool();
-					vgr_.requestJoyBut(jd);
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  1:{} {} {} 2:{} {} {}", jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		}, true);
+#elif CLIENT_VGR
+		router.add(ft::TOPIC_ID_OUTPUT_STATE_ACK, 0, [this](const ft::TxtMqttMessage& m) {
+			vgr_.requestQuit();
+		}, true);
+		router.add(ft::TOPIC_ID_OUTPUT_ORDER, ft::FIELD_TYPE, [this](const ft::TxtMqttMessage& m) {
+			ft::TxtWPType_t type = m.type;
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  type:{}", ft::toString(type));
+			if (type != ft::WP_TYPE_NONE) {
+				vgr_.requestOrder(type);
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_MPO_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED MPO ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				ft::TxtMpoAckCode_t code = (ft::TxtMpoAckCode_t)root["code"].asInt();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtWorkpiece* wp = NULL;
-					if (root["workpiece"] != Json::Value::null) {
-						wp = new ft::TxtWorkpiece();
-						wp->tag_uid = root["workpiece"]["id"].asString();
-						std::string stype = root["workpiece"]["type"].asString();
-						if (stype == "WHITE") {
-							wp->type = ft::WP_TYPE_WHITE;
-						} else if(stype == "RED") {
-							wp->type = ft::WP_TYPE_RED;
-						} else if (stype == "BLUE") {
-							wp->type = ft::WP_TYPE_BLUE;
-						} else {
-							wp->type = ft::WP_TYPE_NONE;
-						}
-						std::string sstate = root["workpiece"]["state"].asString();
-						if (sstate == "RAW") {
-							wp->state = ft::WP_STATE_RAW;
-						} else if(sstate == "PROCESSED") {
-							wp->state = ft::WP_STATE_PROCESSED;
-						} else if (sstate == "REJECTED") {
-							wp->state = ft::WP_STATE_REJECTED;
-						}
-					}
-
-					switch (code)
-					{
-					case ft::MPO_EXIT:
-						vgr_.requestExit("MPO");
-						break;
-					case ft::MPO_STARTED:
-						vgr_.requestMPOstarted(wp);
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		}, true);
+		router.add(ft::TOPIC_ID_OUTPUT_PICKUP, ft::FIELD_ID, [this](const ft::TxtMqttMessage& m) {
+			std::string sid = m.sid;
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  tag_uid:{}", sid);
+			vgr_.requestPickup(sid);
+		}, true);
+		router.add(ft::TOPIC_ID_OUTPUT_STORE, 0, [this](const ft::TxtMqttMessage& m) {
+			vgr_.storeWorkpieceFromDSOIntoHBW();
+		}, true);
+		router.add(ft::TOPIC_ID_OUTPUT_NFC_DS, ft::FIELD_CMD, [this](const ft::TxtMqttMessage& m) {
+			std::string scmd = m.cmd;
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  cmd:{}", scmd);
+			if (scmd == "read")
+			{
+				vgr_.requestNfcRead();
+			} else if (scmd == "delete") {
+				vgr_.requestNfcDelete();
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_HBW_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED HBW ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtHbwAckCode_t code = (ft::TxtHbwAckCode_t)root["code"].asInt();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-
-					ft::TxtWorkpiece* wp = NULL;
-					if (root["workpiece"] != Json::Value::null) {
-						wp = new ft::TxtWorkpiece();
-						wp->tag_uid = root["workpiece"]["id"].asString();
-						std::string stype = root["workpiece"]["type"].asString();
-						if (stype == "WHITE") {
-							wp->type = ft::WP_TYPE_WHITE;
-						} else if(stype == "RED") {
-							wp->type = ft::WP_TYPE_RED;
-						} else if (stype == "BLUE") {
-							wp->type = ft::WP_TYPE_BLUE;
-						} else {
-							wp->type = ft::WP_TYPE_NONE;
-						}
-						std::string sstate = root["workpiece"]["state"].asString();
-						if (sstate == "RAW") {
-							wp->state = ft::WP_STATE_RAW;
-						} else if(sstate == "PROCESSED") {
-							wp->state = ft::WP_STATE_PROCESSED;
-						} else if (sstate == "REJECTED") {
-							wp->state = ft::WP_STATE_REJECTED;
-						}
-					}
-					switch (code)
-					{
-					case ft::HBW_EXIT:
-						vgr_.requestExit("HBW");
-						break;
-					case ft::HBW_STORED:
-						vgr_.requestHBWstored(wp);
-						break;
-					case ft::HBW_FETCHED:
-						vgr_.requestHBWfetched(wp);
-						break;
-					case ft::HBW_CALIB_NAV:
-						vgr_.requestHBWcalib_nav();
-						break;
-					case ft::HBW_CALIB_END:
-						vgr_.requestHBWcalib_end();
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_SSC_JOY, ft::FIELD_JOY, [this](const ft::TxtMqttMessage& m) {
+			ft::TxtJoysticksData jd = m.joy;
+			vgr_.requestJoyBut(jd);
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  1:{} {} {} 2:{} {} {}", jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_MPO_ACK, ft::FIELD_CODE|ft::FIELD_WORKPIECE, [this](const ft::TxtMqttMessage& m) {
+			switch ((ft::TxtMpoAckCode_t)m.code)
+			{
+			case ft::MPO_EXIT:
+				vgr_.requestExit("MPO");
+				break;
+			case ft::MPO_STARTED:
+				vgr_.requestMPOstarted(m.newWorkpiece());
+				break;
+			default:
+				break;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		}else if (msg->get_topic() == TOPIC_LOCAL_HBW_FAULT) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED HBW Fault :{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtHbwAckCode_t code = (ft::TxtHbwAckCode_t)root["code"].asInt();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-
-					switch (code)
-					{
-						default:
-							vgr_.requestHBWFault();
-							break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_HBW_ACK, ft::FIELD_CODE|ft::FIELD_WORKPIECE, [this](const ft::TxtMqttMessage& m) {
+			switch ((ft::TxtHbwAckCode_t)m.code)
+			{
+			case ft::HBW_EXIT:
+				vgr_.requestExit("HBW");
+				break;
+			case ft::HBW_STORED:
+				vgr_.requestHBWstored(m.newWorkpiece());
+				break;
+			case ft::HBW_FETCHED:
+				vgr_.requestHBWfetched(m.newWorkpiece());
+				break;
+			case ft::HBW_CALIB_NAV:
+				vgr_.requestHBWcalib_nav();
+				break;
+			case ft::HBW_CALIB_END:
+				vgr_.requestHBWcalib_end();
+				break;
+			default:
+				break;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_SLD_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED SLD ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtSldAckCode_t code = (ft::TxtSldAckCode_t)root["code"].asInt();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-
-					std::string stype = root["type"].asString();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  type:{}", stype);
-					ft::TxtWPType_t type = ft::WP_TYPE_NONE;
-					if (stype == "WHITE") {
-						type = ft::WP_TYPE_WHITE;
-					} else if(stype == "RED") {
-						type = ft::WP_TYPE_RED;
-					} else if (stype == "BLUE") {
-						type = ft::WP_TYPE_BLUE;
-					}
-					switch (code)
-					{
-					case ft::SLD_EXIT:
-						vgr_.requestExit("SLD");
-						break;
-					case ft::SLD_SORTED:
-						vgr_.requestSLDsorted(type);
-						break;
-					case ft::SLD_CALIB_END:
-						vgr_.requestSLDcalib_end();
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_HBW_FAULT, ft::FIELD_CODE, [this](const ft::TxtMqttMessage& m) {
+			vgr_.requestHBWFault();
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_SLD_ACK, ft::FIELD_CODE|ft::FIELD_TYPE, [this](const ft::TxtMqttMessage& m) {
+			switch ((ft::TxtSldAckCode_t)m.code)
+			{
+			case ft::SLD_EXIT:
+				vgr_.requestExit("SLD");
+				break;
+			case ft::SLD_SORTED:
+				vgr_.requestSLDsorted(m.type);
+				break;
+			case ft::SLD_CALIB_END:
+				vgr_.requestSLDcalib_end();
+				break;
+			default:
+				break;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else {
-			std::cout << "Unknown topic: " << msg->get_topic() << std::endl;
-			spdlog::get("file_logger")->error("Unknown topic: {}",msg->get_topic());
-			exit(1);
-		}
+		}, true);
 #elif CLIENT_SLD
-		if (msg->get_topic() == TOPIC_OUTPUT_STATE_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED state ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					sld_.requestQuit();
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_SSC_JOY) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED joy:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{}", sts);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtJoysticksData jd;
-					jd.aX1 = root["aX1"].asInt();
-					jd.aY1 = root["aY1"].asInt();
-					jd.b1 = root["b1"].asBool();
-					jd.aX2 = root["aX2"].asInt();
-					jd.aY2 = root["aY2"].asInt();
-					jd.b2 = root["b2"].asBool();
-					sld_.requestJoyBut(jd);
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  1:{} {} {} 2:{} {} {}", jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		router.add(ft::TOPIC_ID_OUTPUT_STATE_ACK, 0, [this](const ft::TxtMqttMessage& m) {
+			sld_.requestQuit();
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_SSC_JOY, ft::FIELD_JOY, [this](const ft::TxtMqttMessage& m) {
+			ft::TxtJoysticksData jd = m.joy;
+			sld_.requestJoyBut(jd);
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  1:{} {} {} 2:{} {} {}", jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_MPO_ACK, ft::FIELD_CODE, [this](const ft::TxtMqttMessage& m) {
+			switch ((ft::TxtMpoAckCode_t)m.code)
+			{
+			case ft::MPO_PRODUCED:
+				sld_.requestMPOproduced();
+				break;
+			default:
+				break;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_MPO_ACK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED mpo ack:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					ft::TxtMpoAckCode_t code = (ft::TxtMpoAckCode_t)root["code"].asInt();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-					switch (code)
-					{
-					case ft::MPO_PRODUCED:
-						sld_.requestMPOproduced();
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		}, true);
+		router.add(ft::TOPIC_ID_LOCAL_VGR_DO, ft::FIELD_CODE, [this](const ft::TxtMqttMessage& m) {
+			switch((ft::TxtVgrDoCode_t)m.code)
+			{
+			case ft::VGR_EXIT:
+				sld_.requestExit("VGR");
+				break;
+			case ft::VGR_SLD_START:
+				sld_.requestVGRstart();
+				break;
+			case ft::VGR_SLD_CALIB:
+				sld_.requestVGRcalib();
+				break;
+			default:
+				break;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_LOCAL_VGR_DO) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED vgr do:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				ft::TxtVgrDoCode_t code = (ft::TxtVgrDoCode_t)root["code"].asInt();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", sts, (int)code);
-				if (ft::trycheckTimestampTTL(sts))
-				{
-					switch(code)
-					{
-					case ft::VGR_EXIT:
-						sld_.requestExit("VGR");
-						break;
-					case ft::VGR_SLD_START:
-						sld_.requestVGRstart();
-						break;
-					case ft::VGR_SLD_CALIB:
-						sld_.requestVGRcalib();
-						break;
-					default:
-						break;
-					}
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
-			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else {
-			std::cout << "Unknown topic: " << msg->get_topic() << std::endl;
-			spdlog::get("file_logger")->error("Unknown topic: {}",msg->get_topic());
-			exit(1);
-		}
+		}, true);
 #else
 	#error Set CLIENT_XXX define first!
 #endif
 	}
 
-	void delivery_complete(mqtt::delivery_token_ptr token) override {
-		if (token) {
-			SPDLOG_LOGGER_TRACE(spdlog::get("console"), "delivery_complete: {}: {}", token->get_message_id(), token->get_message()->get_topic());
-		} else {
-			SPDLOG_LOGGER_TRACE(spdlog::get("console"), "delivery token is NULL",0);
-		}
-	}
-
 public:
 #ifdef CLIENT_MPO
-	callback(ft::TxtMqttFactoryClient& cli, ft::TxtMultiProcessingStation& mpo) : cli_(cli), mpo_(mpo) {}
+	callback(ft::TxtMqttFactoryClient& cli, ft::TxtMultiProcessingStation& mpo) : cli_(cli), mpo_(mpo) { addHandlers(); }
 #elif CLIENT_HBW
-	callback(ft::TxtMqttFactoryClient& cli, ft::TxtHighBayWarehouse& hbw) : cli_(cli), hbw_(hbw) {}
+	callback(ft::TxtMqttFactoryClient& cli, ft::TxtHighBayWarehouse& hbw) : cli_(cli), hbw_(hbw) { addHandlers(); }
 #elif CLIENT_VGR
-	callback(ft::TxtMqttFactoryClient& cli, ft::TxtVacuumGripperRobot& vgr) : cli_(cli), vgr_(vgr) {}
+	callback(ft::TxtMqttFactoryClient& cli, ft::TxtVacuumGripperRobot& vgr) : cli_(cli), vgr_(vgr) { addHandlers(); }
 #elif CLIENT_SLD
-	callback(ft::TxtMqttFactoryClient& cli, ft::TxtSortingLine& sld) : cli_(cli), sld_(sld) {}
+	callback(ft::TxtMqttFactoryClient& cli, ft::TxtSortingLine& sld) : cli_(cli), sld_(sld) { addHandlers(); }
 #else
 	#error Set CLIENT_XXX define first!
 #endif
 };
 
+
 int main(int argc, char* argv[])
 {
 	std::string clientName;
@@ -828,6 +390,9 @@ int main(int argc, char* argv[])
 				std::stringstream sout_port;
 				sout_port << port;
 				ft::TxtMqttFactoryClient mqttclient(mqtt_client_id, mqtt_prefix, host, sout_port.str(), mqtt_user, mqtt_pass);
+				mqttclient.setMinIntervals(root["mqtt_min_interval_ms"]); //e.g. {"f/i/stock": 500}
+				mqttclient.setTopicPolicies(root["mqtt_topic_policy"]); //e.g. {"fl/ssc/joy": {"qos": 1, "expiry_s": 2}}
+				mqttclient.setMqttVersion(root.get("mqtt_version", MQTTVERSION_3_1_1).asInt());
 				pcli = &mqttclient;
 
 				ft::TxtTransfer T(pTArea);
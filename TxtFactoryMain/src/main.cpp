@@ -8,6 +8,7 @@
 #include "TxtBME680.h"
 #include "TxtCamera.h"
 #include "TxtMotionDetection.h"
+#include "TxtMotionRecorder.h"
 #include "TxtPanTiltUnit.h"
 #include "TxtFactoryTypes.h"
 #include "TxtJoystickXYBController.h"
@@ -59,6 +60,8 @@ float tiltpos_published_last = -200.f;
 ft::TxtMqttFactoryClient* pcli = NULL;
 ft::TxtBME680* pBme680 = NULL; // extern in TxtBME680.cpp
 ft::TxtCamera* pCam = NULL;
+ft::TxtMotionDetection* pMdCam = NULL;
+ft::TxtMotionRecorder* pRecorder = NULL;
 
 //uint16_t u16CountState1000ms = 0;
 int16_t ldr_last = 0;
@@ -71,6 +74,10 @@ double period_ldr = 60.0; //Default: 1 Min
 double period_bme680 = 60.0; //Default: 1 Min
 int64_t timestamp_bme680 = 0; //ns
 double timestamp_ldr = 0.; //s
+bool cam_json = true; //legacy i/cam (base64 JSON), c/cam "json"
+bool cam_jpg = false; //binary i/cam/jpg, c/cam "jpg"
+bool cam_stream = false; //stream acquired as a consumer of the camera, c/cam "on"
+double cam_fps = CAM_FPS; //c/cam "fps"
 
 std::chrono::system_clock::time_point tsLastDetectedTemp;
 std::chrono::system_clock::time_point tsLastDetectedHum;
@@ -79,6 +86,7 @@ std::chrono::system_clock::time_point startLast;
 #endif
 
 #define TIMEOUT_CONNECTION_MS 60000 //60 s
+#define CAM_REPORT_S 60.0 //stream report of the change gate
 #define DEGREE2STEPS 10.f
 
 void setLED(int o, int v) {
@@ -150,6 +158,13 @@ public:
 		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtCameraObserver",0);
 		_subject = s;
 		_subject->Attach(this);
+		published = 0;
+		unchanged = 0;
+		bytes = 0;
+		encode_s = 0.;
+		latency_sum_ms = 0.;
+		latency_max_ms = 0.;
+		tsReport = std::chrono::steady_clock::now();
 	}
 	virtual ~TxtCameraObserver() {
 		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtCameraObserver",0);
@@ -162,17 +177,49 @@ public:
 			auto start = std::chrono::system_clock::now();
 #endif
 
-			std::string sdata = _subject->getDataString();
-			if (!sdata.empty()) {
+			assert(pcli);
+			ft::TxtCameraFramePtr f = _subject->getFrame();
+			if (!f) {
+				return;
+			}
+			if (!f->changed) {
+				//no change to the last streamed frame: no encode, no publish
+				unchanged++;
+				report();
+				return;
+			}
+			long timeout_ms = TIMEOUT_CONNECTION_MS;//TODO _subject->getPeriod(); //67 max 15fps
+			bool sent = false;
+			if (cam_jpg) {
+				std::string data(CAM_JPG_HEADER_SIZE, '\0');
+				ft::TxtCameraFrameInfo info;
+				auto t0 = std::chrono::steady_clock::now();
+				bool ok = _subject->getJpeg(f, data, info);
+				encode_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+				if (ok) {
+					if (mleds==1) {
+						setLED(4, 512);
+					}
+					bytes += data.size();
+					pcli->publishCamJpg(info.ts_ns, info.seq, info.width, info.height, std::move(data), timeout_ms);
+					sent = true;
+				}
+			}
+			if (cam_json) {
+				auto t0 = std::chrono::steady_clock::now();
+				std::string sdata = _subject->getDataString(f);
+				encode_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+				if (!sdata.empty()) {
+					bytes += sdata.size();
 #ifdef CAM_TEST
 					spdlog::get("console")->info("CAM 3: --- publish");
 #endif
-				assert(pcli);
-				long timeout_ms = TIMEOUT_CONNECTION_MS;//TODO _subject->getPeriod(); //67 max 15fps
-				if (mleds==1) {
-					setLED(4, 512);
+					if (mleds==1) {
+						setLED(4, 512);
+					}
+					pcli->publishCam(sdata, timeout_ms);
+					sent = true;
 				}
-				pcli->publishCam(sdata, timeout_ms);
 			}
 
 #ifdef DEBUG
@@ -187,11 +234,56 @@ public:
 			if (mleds==1) {
 				setLED(4, 0);
 			}
+			//frames, not messages: json and jpg of the same frame count once
+			if (sent) {
+				published++;
+				latency(f);
+			}
+			report();
 			//SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtCameraObserver Update 2",0);
 		}
 	}
 private:
+	//capture time of the frame to the publish
+	void latency(const ft::TxtCameraFramePtr& f) {
+		double ms = (ft::getnowtimestamp_ns() - f->info.ts_ns) / 1e6;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "cam publish seq:{} latency_ms:{}", f->info.seq, ms);
+		latency_sum_ms += ms;
+		latency_max_ms = std::max(latency_max_ms, ms);
+	}
+
+	//savings of the change gate, estimated with the mean encode time and size of the published frames
+	void report() {
+		auto now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<double>(now - tsReport).count() < CAM_REPORT_S) {
+			return;
+		}
+		tsReport = now;
+		if (published > 0) {
+			double saved_ms = unchanged * encode_s * 1000. / published;
+			double saved_bytes = (double)unchanged * bytes / published;
+			spdlog::get("console")->info("cam stream published:{} unchanged:{} encode_ms:{:.1f} saved_ms:{:.1f} bytes:{} saved_bytes:{:.0f} ({:.1f}%)",
+					published, unchanged, encode_s * 1000., saved_ms, bytes, saved_bytes,
+					100. * saved_bytes / (bytes + saved_bytes));
+			spdlog::get("console")->info("cam stream latency capture to publish mean_ms:{:.1f} max_ms:{:.1f}",
+					latency_sum_ms / published, latency_max_ms);
+		}
+		published = 0;
+		unchanged = 0;
+		bytes = 0;
+		encode_s = 0.;
+		latency_sum_ms = 0.;
+		latency_max_ms = 0.;
+	}
+
 	ft::TxtCamera *_subject;
+	uint64_t published;
+	uint64_t unchanged;
+	uint64_t bytes;
+	double encode_s;
+	double latency_sum_ms;
+	double latency_max_ms;
+	std::chrono::steady_clock::time_point tsReport;
 };
 
 class TxtMotionDetectionObserver : public ft::Observer {
@@ -209,6 +301,17 @@ public:
 	void Update(ft::SubjectObserver* theChangedSubject) {
 		if(theChangedSubject == _subject) {
 			//SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMotionDetectionObserver Update 1",0);
+			if (pRecorder) {
+				//clip id instead of the image, the clip is written by the recorder
+				if (pPtuControl && !pPtuControl->isBusy()) { //Alert if PTU offline
+					assert(pcli);
+					long timeout_ms = TIMEOUT_CONNECTION_MS;
+					std::string clip = pRecorder->trigger();
+					pcli->publishAlertClip("cam", clip, 100, timeout_ms);
+					std::cout << "Alert: cam clip " << clip << std::endl;
+				}
+				return;
+			}
 			std::string sdata = _subject->getDataString();
 			if (!sdata.empty()) {
 				if (pPtuControl && !pPtuControl->isBusy()) { //Alert if PTU offline
@@ -339,6 +442,8 @@ class callback : public virtual mqtt::callback
 	// This will initiate the attempt to manually reconnect.
 	void connection_lost(const std::string& cause) override {
 		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "connection_lost: {}", cause);
+		assert(pcli);
+		pcli->connection_lost(cause);
 	}
 
 	// Callback for when a message arrives.
@@ -350,288 +455,240 @@ class callback : public virtual mqtt::callback
 
 		first_message_arrived = true;
 
-		if (msg->get_topic() == TOPIC_CONFIG_LINK) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED link:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string smessage = root["message"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  message:{}", smessage);
-				int code = -1;
-				if (root.isMember("code")) {
-					code = root["code"].asInt();
-				}
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  code:{}", code);
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+		if (!cli_.dispatch(msg)) {
+			//unknown or undecodable: dropped, a bad publisher must not stop the station
+			std::cout << "Unknown topic: " << msg->get_topic() << std::endl;
+			spdlog::get("file_logger")->error("Unknown topic: {}",msg->get_topic());
+		}
+	}
+
+	// Handlers of the subscribed topics, called by the router
+	void addHandlers() {
+		ft::TxtMqttTopicRouter& router = cli_.getRouter();
+		router.add(ft::TOPIC_ID_CONFIG_LINK, ft::FIELD_ROOT, [](const ft::TxtMqttMessage& m) {
+			std::string smessage = m.root["message"].asString();
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  message:{}", smessage);
+			int code = -1;
+			if (m.root.isMember("code")) {
+				code = m.code;
 			}
-		} else if (msg->get_topic() == TOPIC_LOCAL_BROADCAST) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED local broadcast:{}", msg->get_topic());
-			std::stringstream ssin(msg->to_string());
-			Json::Value root;
-			try {
-				ssin >> root;
-				std::string sts = root["ts"].asString();
-				std::string station = root["station"].asString();
-				std::string hardwareId = root["hardwareId"].asString();
-				std::string softwareName = root["softwareName"].asString();
-				std::string softwareVersion = root["softwareVersion"].asString();
-				std::string message = root["message"].asString();
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  station:{} ts:{}", station, sts);
-				if (station=="MPO") {
-					sts_mpo = sts;
-					std::cout << "ts_mpo: " << sts_mpo << std::endl;
-				} else if (station=="HBW") {
-					sts_hbw = sts;
-					std::cout << "ts_hbw: " << sts_hbw << std::endl;
-				} else if (station=="VGR") {
-					sts_vgr = sts;
-					std::cout << "ts_vgr: " << sts_vgr << std::endl;
-				} else if (station=="SLD") {
-					sts_sld = sts;
-					std::cout << "ts_sld: " << sts_sld << std::endl;
-				} else {
-					std::cout << "Unknown station: " << station << std::endl;
-					spdlog::get("file_logger")->error("Unknown station: {}",station);
-					exit(1);
-				}
-				//check time sync
-				if (!ft::trycheckTimestampTTL(sts))
-				{
-					std::cout << "Please sync time!" << station << ", " << sts << std::endl;
-					spdlog::get("file_logger")->error("Please sync time! {} ({})",station,sts);
-					ft::TxtSound::play(pTArea,2);
-					exit(1);
-				}
-				//check SW version
-				if (TxtAppVer != softwareVersion)
-				{
-					std::cout << "Wrong SW Version!" << station << " " << TxtAppVer << "!=" << softwareVersion << std::endl;
-					spdlog::get("file_logger")->error("Wrong SW Version! {} {}!={}",station,TxtAppVer,softwareVersion);
-					ft::TxtSound::play(pTArea,3);
-					exit(1);
-				}
-			} catch (const Json::RuntimeError& exc) {
-				std::cout << "Error: " << exc.what() << std::endl;
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  code:{}", code);
+		});
+		router.add(ft::TOPIC_ID_LOCAL_BROADCAST, ft::FIELD_ROOT, [](const ft::TxtMqttMessage& m) {
+			const std::string& sts = m.ts;
+			std::string station = m.root["station"].asString();
+			std::string softwareVersion = m.root["softwareVersion"].asString();
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  station:{} ts:{}", station, sts);
+			if (station=="MPO") {
+				sts_mpo = sts;
+				std::cout << "ts_mpo: " << sts_mpo << std::endl;
+			} else if (station=="HBW") {
+				sts_hbw = sts;
+				std::cout << "ts_hbw: " << sts_hbw << std::endl;
+			} else if (station=="VGR") {
+				sts_vgr = sts;
+				std::cout << "ts_vgr: " << sts_vgr << std::endl;
+			} else if (station=="SLD") {
+				sts_sld = sts;
+				std::cout << "ts_sld: " << sts_sld << std::endl;
+			} else {
+				std::cout << "Unknown station: " << station << std::endl;
+				spdlog::get("file_logger")->error("Unknown station: {}",station);
+				return;
 			}
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK.", 0);
-		} else if (msg->get_topic() == TOPIC_CONFIG_BME680) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED bme680 config: {}", msg->get_topic());
+			//check time sync
+			if (!ft::trycheckTimestampTTL(sts))
+			{
+				std::cout << "Please sync time!" << station << ", " << sts << std::endl;
+				spdlog::get("file_logger")->error("Please sync time! {} ({})",station,sts);
+				ft::TxtSound::play(pTArea,2);
+				return;
+			}
+			//check SW version
+			if (TxtAppVer != softwareVersion)
+			{
+				std::cout << "Wrong SW Version!" << station << " " << TxtAppVer << "!=" << softwareVersion << std::endl;
+				spdlog::get("file_logger")->error("Wrong SW Version! {} {}!={}",station,TxtAppVer,softwareVersion);
+				ft::TxtSound::play(pTArea,3);
+				return;
+			}
+		});
+		router.add(ft::TOPIC_ID_CONFIG_BME680, ft::FIELD_ROOT, [](const ft::TxtMqttMessage& m) {
 			if (force_max_rate) {
 				std::cout << "force_max_rate=true: ignoring bme680 config" << std::endl;
-			} else {
-				std::stringstream ssin(msg->to_string());
-				Json::Value root;
-				try {
-					ssin >> root;
-					double period = -1.0;
-					if (root.isMember("period")) {
-						period = root["period"].asDouble();
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  period: {}", period);
-					}
-					if (period >= 3.0) {
-						period_bme680 = period;
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "Setting period_bme680={}s",period_bme680);
-					} else if (period >= 1.0) {
-						period_bme680 = 3.0;
-						spdlog::get("console")->warn("WRONG CONFIG: period should be >= 3.0. Setting period_bme680=3.0s",0);
-					}
-				} catch (const Json::RuntimeError& exc) {
-					std::cout << "Error: " << exc.what() << std::endl;
-				}
+				return;
+			}
+			double period = -1.0;
+			if (m.root.isMember("period")) {
+				period = m.root["period"].asDouble();
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  period: {}", period);
+			}
+			if (period >= 3.0) {
+				period_bme680 = period;
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "Setting period_bme680={}s",period_bme680);
+			} else if (period >= 1.0) {
+				period_bme680 = 3.0;
+				spdlog::get("console")->warn("WRONG CONFIG: period should be >= 3.0. Setting period_bme680=3.0s",0);
 			}
-		} else if (msg->get_topic() == TOPIC_CONFIG_LDR) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED ldr config: {}", msg->get_topic());
+		});
+		router.add(ft::TOPIC_ID_CONFIG_LDR, ft::FIELD_ROOT, [](const ft::TxtMqttMessage& m) {
 			if (force_max_rate) {
 				std::cout << "force_max_rate=true: ignoring ldr config" << std::endl;
+				return;
+			}
+			double period = -1.0;
+			if (m.root.isMember("period")) {
+				period = m.root["period"].asDouble();
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  period: {}", period);
+			}
+			if (period >= 1.0) {
+				period_ldr = period;
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "Setting period_ldr={}s",period_ldr);
 			} else {
-				std::stringstream ssin(msg->to_string());
-				Json::Value root;
-				try {
-					ssin >> root;
-					double period = -1.0;
-					if (root.isMember("period")) {
-						period = root["period"].asDouble();
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  period: {}", period);
-					}
-					if (period >= 1.0) {
-						period_ldr = period;
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "Setting period_ldr={}s",period_ldr);
-					} else {
-						spdlog::get("console")->warn("WRONG CONFIG: period >= 1.0. Setting period_ldr=1.0s",0);
-					}
-				} catch (const Json::RuntimeError& exc) {
-					std::cout << "Error: " << exc.what() << std::endl;
+				spdlog::get("console")->warn("WRONG CONFIG: period >= 1.0. Setting period_ldr=1.0s",0);
+			}
+		});
+		router.add(ft::TOPIC_ID_CONFIG_CAM, ft::FIELD_ROOT, [](const ft::TxtMqttMessage& m) {
+			//motion detection, also with force_max_rate
+			if (pMdCam) {
+				if (m.root.isMember("md_rate")) {
+					pMdCam->setLearningRate(m.root["md_rate"].asDouble());
+					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  md_rate: {}", m.root["md_rate"].asDouble());
+				}
+				if (m.root.isMember("md_thresh")) {
+					pMdCam->setThreshold(m.root["md_thresh"].asInt());
+					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  md_thresh: {}", m.root["md_thresh"].asInt());
+				}
+				if (m.root.isMember("md_var")) {
+					pMdCam->setVariance(m.root["md_var"].asBool());
+					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  md_var: {}", m.root["md_var"].asBool());
+				}
+				if (m.root.isMember("md_opencv")) {
+					pMdCam->setOpenCV(m.root["md_opencv"].asBool());
+					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  md_opencv: {}", m.root["md_opencv"].asBool());
 				}
+				if (m.root.isMember("md")) {
+					double md_fps = m.root.get("md_fps", MOTION_FPS).asDouble();
+					pMdCam->setEnabled(m.root["md"].asBool(), md_fps);
+					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  md: {} md_fps: {}", m.root["md"].asBool(), md_fps);
+				}
+			}
+			//change gate of the stream, also with force_max_rate
+			if (pCam && (m.root.isMember("gate") || m.root.isMember("keepalive_s"))) {
+				double gate = m.root.get("gate", CAM_GATE_THRESH).asDouble();
+				double keepalive_s = m.root.get("keepalive_s", CAM_GATE_KEEPALIVE_S).asDouble();
+				pCam->setGate(gate, keepalive_s);
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  gate: {} keepalive_s: {}", gate, keepalive_s);
 			}
-		} else if (msg->get_topic() == TOPIC_CONFIG_CAM) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED cam config: {}", msg->get_topic());
 			if (force_max_rate) {
 				std::cout << "force_max_rate=true: ignoring cam config" << std::endl;
-			} else {
-				std::stringstream ssin(msg->to_string());
-				Json::Value root;
-				try {
-					ssin >> root;
-					bool bon = root["on"].asBool();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  on: {}", bon);
-					double fps = -1.0;
-					if (root.isMember("fps")) {
-						fps = root["fps"].asDouble();
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  fps: {}", fps);
-					}
-					if (fps > 0.0) {
-						//assert(pCam);
-						if (pCam) pCam->setFps(fps);
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "CONFIG: fps:{}",fps);
-					}
-					if (bon) {
-						//assert(pCam);
-						if (pCam) pCam->start();
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "CONFIG: start camera",0);
-					} else {
-						//assert(pCam);
-						if (pCam) pCam->stop();
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "CONFIG: stop camera",0);
-					}
-				} catch (const Json::RuntimeError& exc) {
-					std::cout << "Error: " << exc.what() << std::endl;
-				}
+				return;
 			}
-		} else if (msg->get_topic() == TOPIC_OUTPUT_PTU) {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED PTU control: {}", msg->get_topic());
-			if (pPtuControl) {
-				std::stringstream ssin(msg->to_string());
-				Json::Value root;
-				try {
-					ssin >> root;
-					std::string scmd = root["cmd"].asString();
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  cmd:{}", scmd);
-					float degree = 0.f;
-					if (root.isMember("degree")) {
-						degree = root["degree"].asFloat();
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  degree:{}", degree);
-					}
-					assert(pPtuControl);
-					int steps = DEGREE2STEPS*degree;
-					if (pPtuControl->executeCmd(scmd, steps)) {
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "executeCmd (TRUE): scmd:{} degree:{} steps:{}", scmd, degree, steps);
-					} else {
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "executeCmd (FALSE)",0);
-					}
-				} catch (const Json::RuntimeError& exc) {
-					std::cout << "Error: " << exc.what() << std::endl;
-				}
-			} else {
+			bool bon = m.root["on"].asBool();
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  on: {}", bon);
+			double fps = -1.0;
+			if (m.root.isMember("fps")) {
+				fps = m.root["fps"].asDouble();
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  fps: {}", fps);
+			}
+			//legacy dashboards only send "on" and "fps" and get i/cam,
+			//clients of the binary topic send "jpg":true and "json":false
+			cam_json = m.root.get("json", true).asBool();
+			cam_jpg = m.root.get("jpg", false).asBool();
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  json: {} jpg: {}", cam_json, cam_jpg);
+			if (fps > 0.0) {
+				cam_fps = fps;
+				//assert(pCam);
+				if (pCam && cam_stream) pCam->setFps("stream", fps);
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "CONFIG: fps:{}",fps);
+			}
+			//the stream is one reference, the camera idles without consumers
+			if (bon && !cam_stream) {
+				//assert(pCam);
+				if (pCam) pCam->acquire("stream", cam_fps);
+				cam_stream = true;
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "CONFIG: start camera",0);
+			} else if (!bon && cam_stream) {
+				//assert(pCam);
+				if (pCam) pCam->release("stream");
+				cam_stream = false;
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "CONFIG: stop camera",0);
+			}
+		});
+		router.add(ft::TOPIC_ID_OUTPUT_PTU, ft::FIELD_ROOT, [](const ft::TxtMqttMessage& m) {
+			if (!pPtuControl) {
 				std::cout << "PTU not available!" << std::endl;
+				return;
 			}
-		}
-		else if (msg->get_topic() == TOPIC_INPUT_STATE_HBW)
+			std::string scmd = m.root["cmd"].asString();
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  cmd:{}", scmd);
+			float degree = 0.f;
+			if (m.root.isMember("degree")) {
+				degree = m.root["degree"].asFloat();
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  degree:{}", degree);
+			}
+			int steps = DEGREE2STEPS*degree;
+			if (pPtuControl->executeCmd(scmd, steps)) {
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "executeCmd (TRUE): scmd:{} degree:{} steps:{}", scmd, degree, steps);
+			} else {
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "executeCmd (FALSE)",0);
+			}
+		});
+		router.add(ft::TOPIC_ID_INPUT_STATE_HBW, ft::FIELD_CODE, [](const ft::TxtMqttMessage& m) { updateLEDs(hbw_lastCode, m.code); });
+		router.add(ft::TOPIC_ID_INPUT_STATE_VGR, ft::FIELD_CODE, [](const ft::TxtMqttMessage& m) { updateLEDs(vgr_lastCode, m.code); });
+		router.add(ft::TOPIC_ID_INPUT_STATE_MPO, ft::FIELD_CODE, [](const ft::TxtMqttMessage& m) { updateLEDs(mpo_lastCode, m.code); });
+		router.add(ft::TOPIC_ID_INPUT_STATE_SLD, ft::FIELD_CODE, [](const ft::TxtMqttMessage& m) { updateLEDs(sld_lastCode, m.code); });
+		router.add(ft::TOPIC_ID_INPUT_STATE_DSI, ft::FIELD_CODE, [](const ft::TxtMqttMessage& m) { updateLEDs(dsi_lastCode, m.code); });
+		router.add(ft::TOPIC_ID_INPUT_STATE_DSO, ft::FIELD_CODE, [](const ft::TxtMqttMessage& m) { updateLEDs(dso_lastCode, m.code); });
+	}
+
+	static void updateLEDs(int& lastCode, int code)
+	{
+		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "updateLEDs",0);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  code: {}", code);
+
+		//update lastCode
+		lastCode = code;
+
+		//aggregate state LEDs
+		if ((hbw_lastCode==ft::LEDS_ERROR)||
+			(vgr_lastCode==ft::LEDS_ERROR)||
+			(mpo_lastCode==ft::LEDS_ERROR)||
+			(sld_lastCode==ft::LEDS_ERROR))
 		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED input state HBW: {}", msg->get_topic());
-			updateLEDs(msg, "hbw");
-		}
-		else if (msg->get_topic() == TOPIC_INPUT_STATE_VGR)
+			setLEDs(ft::LEDS_ERROR);
+		} else if ((hbw_lastCode==ft::LEDS_CALIB)||
+			(vgr_lastCode==ft::LEDS_CALIB)||
+			(mpo_lastCode==ft::LEDS_CALIB)||
+			(sld_lastCode==ft::LEDS_CALIB))
 		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED input state VGR: {}", msg->get_topic());
-			updateLEDs(msg, "vgr");
-		}
-		else if (msg->get_topic() == TOPIC_INPUT_STATE_MPO)
+			setLEDs(ft::LEDS_CALIB);
+		} else if ((hbw_lastCode==ft::LEDS_WAIT_ERROR)||
+			(vgr_lastCode==ft::LEDS_WAIT_ERROR)||
+			(mpo_lastCode==ft::LEDS_WAIT_ERROR)||
+			(sld_lastCode==ft::LEDS_WAIT_ERROR))
 		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED input state MPO: {}", msg->get_topic());
-			updateLEDs(msg, "mpo");
-		}
-		else if (msg->get_topic() == TOPIC_INPUT_STATE_SLD)
+			setLEDs(ft::LEDS_WAIT_ERROR);
+		} else if ((hbw_lastCode==ft::LEDS_WAIT_READY)||
+			(vgr_lastCode==ft::LEDS_WAIT_READY)||
+			(mpo_lastCode==ft::LEDS_WAIT_READY)||
+			(sld_lastCode==ft::LEDS_WAIT_READY))
 		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED input state SLD: {}", msg->get_topic());
-			updateLEDs(msg, "sld");
-		}
-		else if (msg->get_topic() == TOPIC_INPUT_STATE_DSI)
+			setLEDs(ft::LEDS_WAIT_READY);
+		} else if ((hbw_lastCode==ft::LEDS_BUSY)||
+			(vgr_lastCode==ft::LEDS_BUSY)||
+			(mpo_lastCode==ft::LEDS_BUSY)||
+			(sld_lastCode==ft::LEDS_BUSY))
 		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED input state DSI: {}", msg->get_topic());
-			updateLEDs(msg, "dsi");
-		}
-		else if (msg->get_topic() == TOPIC_INPUT_STATE_DSO)
+			setLEDs(ft::LEDS_BUSY);
+		} else if ((hbw_lastCode==ft::LEDS_READY)||
+			(vgr_lastCode==ft::LEDS_READY)||
+			(mpo_lastCode==ft::LEDS_READY)||
+			(sld_lastCode==ft::LEDS_READY))
 		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED input state DSO: {}", msg->get_topic());
-			updateLEDs(msg, "dso");
+			setLEDs(ft::LEDS_READY);
 		} else {
-			std::cout << "Unknown topic: " << msg->get_topic() << std::endl;
-			spdlog::get("file_logger")->error("Unknown topic: {}",msg->get_topic());
-			exit(1);
-		}
-	}
-
-	void updateLEDs(mqtt::const_message_ptr msg, const std::string station)
-	{
-		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "updateLEDs",0);
-		std::stringstream ssin(msg->to_string());
-		Json::Value root;
-		try {
-			ssin >> root;
-			int code = root["code"].asInt();
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  code: {}", code);
-
-			//update lastCode
-			if (station=="hbw") {
-				hbw_lastCode=code;
-			} else if (station=="vgr") {
-				vgr_lastCode=code;
-			} else if (station=="mpo") {
-				mpo_lastCode=code;
-			} else if (station=="sld") {
-				sld_lastCode=code;
-			} else if (station=="dsi") {
-				dsi_lastCode=code;
-			} else if (station=="dso") {
-				dso_lastCode=code;
-			}
-
-
-			//aggregate state LEDs
-			if ((hbw_lastCode==ft::LEDS_ERROR)||
-				(vgr_lastCode==ft::LEDS_ERROR)||
-				(mpo_lastCode==ft::LEDS_ERROR)||
-				(sld_lastCode==ft::LEDS_ERROR))
-			{
-				setLEDs(ft::LEDS_ERROR);
-			} else if ((hbw_lastCode==ft::LEDS_CALIB)||
-				(vgr_lastCode==ft::LEDS_CALIB)||
-				(mpo_lastCode==ft::LEDS_CALIB)||
-				(sld_lastCode==ft::LEDS_CALIB))
-			{
-				setLEDs(ft::LEDS_CALIB);
-			} else if ((hbw_lastCode==ft::LEDS_WAIT_ERROR)||
-				(vgr_lastCode==ft::LEDS_WAIT_ERROR)||
-				(mpo_lastCode==ft::LEDS_WAIT_ERROR)||
-				(sld_lastCode==ft::LEDS_WAIT_ERROR))
-			{
-				setLEDs(ft::LEDS_WAIT_ERROR);
-			} else if ((hbw_lastCode==ft::LEDS_WAIT_READY)||
-				(vgr_lastCode==ft::LEDS_WAIT_READY)||
-				(mpo_lastCode==ft::LEDS_WAIT_READY)||
-				(sld_lastCode==ft::LEDS_WAIT_READY))
-			{
-				setLEDs(ft::LEDS_WAIT_READY);
-			} else if ((hbw_lastCode==ft::LEDS_BUSY)||
-				(vgr_lastCode==ft::LEDS_BUSY)||
-				(mpo_lastCode==ft::LEDS_BUSY)||
-				(sld_lastCode==ft::LEDS_BUSY))
-			{
-				setLEDs(ft::LEDS_BUSY);
-			} else if ((hbw_lastCode==ft::LEDS_READY)||
-				(vgr_lastCode==ft::LEDS_READY)||
-				(mpo_lastCode==ft::LEDS_READY)||
-				(sld_lastCode==ft::LEDS_READY))
-			{
-				setLEDs(ft::LEDS_READY);
-			} else {
-				setLEDs(ft::LEDS_OFF);
-			}
-
-		} catch (const Json::RuntimeError& exc) {
-			std::cout << "Error: " << exc.what() << std::endl;
+			setLEDs(ft::LEDS_OFF);
 		}
 	}
 
@@ -644,7 +701,7 @@ class callback : public virtual mqtt::callback
 	}
 
 public:
-	callback(ft::TxtMqttFactoryClient& cli) : cli_(cli) {}
+	callback(ft::TxtMqttFactoryClient& cli) : cli_(cli) { addHandlers(); }
 };
 
 
@@ -659,9 +716,8 @@ int main(int argc, char* argv[])
 		//can be set globaly or per logger(logger->set_error_handler(..))
 		spdlog::set_error_handler([](const std::string& msg)
 	    {
+			//a failed log call is reported, it does not stop the factory
 			std::cout << "err handler spdlog:" << msg << std::endl;
-			spdlog::get("file_logger")->error("err handler spdlog: {}",msg);
-			exit(1);
 	    });
 
 		auto file_logger = spdlog::basic_logger_mt<spdlog::async_factory>("file_logger", "Data/TxtFactoryMain.log", true);
@@ -703,6 +759,17 @@ int main(int argc, char* argv[])
     mqtt::binary_ref mqtt_pass = root.get("mqtt_pass", "xtx" ).asString();
     int w = root.get("cam_w", 320. ).asDouble();
     int h = root.get("cam_h", 240. ).asDouble();
+    bool cam_passthrough = root.get("cam_mjpeg_passthrough", false).asBool();
+    std::string cam_source = root.get("cam_source", CAM_SOURCE_DEVICE).asString();
+    double cam_source_speed = root.get("cam_source_speed", 1.0).asDouble();
+    bool cam_source_loop = root.get("cam_source_loop", true).asBool();
+    int cam_v4l2_buffers = root.get("cam_v4l2_buffers", CAM_V4L2_BUFFERS).asInt();
+    bool cam_clips = root.get("cam_clips", false).asBool();
+    bool cam_motion = root.get("cam_motion", false).asBool();
+    double cam_clip_pre_s = root.get("cam_clip_pre_s", CLIP_PRE_S).asDouble();
+    double cam_clip_post_s = root.get("cam_clip_post_s", CLIP_POST_S).asDouble();
+    double cam_gate = root.get("cam_gate", CAM_GATE_THRESH).asDouble();
+    double cam_keepalive_s = root.get("cam_keepalive_s", CAM_GATE_KEEPALIVE_S).asDouble();
     force_max_rate = root.get("force_max_rate", false).asBool();
     double max_limit_Area_moveDetect = root.get("max_limit_Area_moveDetect", 10000.0).asDouble();
     double broadcast_retry_delay = root.get("broadcast_retry_delay", 5.0).asDouble();
@@ -713,7 +780,13 @@ int main(int argc, char* argv[])
 		<< " port:" << port
 		<< " mqtt_user:" << mqtt_user
 		<< " mqtt_pass:" << mqtt_pass << std::endl
-		<< " cam w,h:" << w << "," << h << std::endl
+		<< " cam w,h:" << w << "," << h
+		<< " cam_mjpeg_passthrough:" << cam_passthrough
+		<< " cam_source:" << cam_source << " speed:" << cam_source_speed << " loop:" << cam_source_loop
+		<< " cam_v4l2_buffers:" << cam_v4l2_buffers
+		<< " cam_motion:" << cam_motion
+		<< " cam_clips:" << cam_clips << " pre,post:" << cam_clip_pre_s << "," << cam_clip_post_s << std::endl
+		<< " cam_gate:" << cam_gate << " cam_keepalive_s:" << cam_keepalive_s << std::endl
 		<< " force_max_rate:" << force_max_rate
 		<< " control mode:" << mcontrol
 		<< " leds mode:" << mleds
@@ -734,6 +807,8 @@ int main(int argc, char* argv[])
 				sout_port << port;
 				//TODO
 				ft::TxtMqttFactoryClient mqttclient(mqtt_client_id,mqtt_prefix, host, sout_port.str(), mqtt_user, mqtt_pass);
+				mqttclient.setTopicPolicies(root["mqtt_topic_policy"]); //e.g. {"i/ldr": {"qos": 1, "retained": true}}
+				mqttclient.setMqttVersion(root.get("mqtt_version", MQTTVERSION_3_1_1).asInt());
 				pcli = &mqttclient;
 				callback cb(mqttclient);
 				mqttclient.set_callback(cb);
@@ -762,8 +837,12 @@ int main(int argc, char* argv[])
 				std::cout << "Init TxtCamera" << std::endl;
 				ft::TxtCamera cam(w, h);
 				pCam = &cam;
+				cam.setSource(cam_source, cam_source_speed, cam_source_loop, cam_v4l2_buffers);
+				cam.setPassthrough(cam_passthrough);
+				cam.setGate(cam_gate, cam_keepalive_s);
 				std::cout << "Init TxtMotionDetection" << std::endl;
 				ft::TxtMotionDetection mdcam(&cam, max_limit_Area_moveDetect); //default 500
+				pMdCam = &mdcam;
 				std::cout << "Start TxtCamera Thread" << std::endl;
 				bool rcam = cam.startThread();
 				if (!rcam) {
@@ -771,8 +850,9 @@ int main(int argc, char* argv[])
 				} else {
 					if (force_max_rate) {
 						std::cout << "cam force_max_rate" << std::endl;
-						cam.setFps(15.0);
-						cam.start();
+						cam_fps = 15.0;
+						cam.acquire("stream", cam_fps);
+						cam_stream = true;
 					}
 
 					std::cout << "Start TxtMotionDetection Thread" << std::endl;
@@ -781,6 +861,18 @@ int main(int argc, char* argv[])
 						std::cerr << "Error: init TxtMotionDetection" << std::endl;
 						return retcam;
 					}
+					//motion alerts without a dashboard
+					mdcam.setEnabled(cam_motion);
+				}
+				std::unique_ptr<ft::TxtMotionRecorder> recorder;
+				if (rcam && cam_clips) {
+					std::cout << "Start TxtMotionRecorder Thread" << std::endl;
+					recorder.reset(new ft::TxtMotionRecorder(&cam, "Data/", cam_clip_pre_s, cam_clip_post_s));
+					if (recorder->startThread()) {
+						pRecorder = recorder.get();
+					} else {
+						std::cerr << "Error: init TxtMotionRecorder" << std::endl;
+					}
 				}
 
 				std::cout << "Connect MQTTClient" << std::endl;
@@ -10,51 +10,170 @@
 
 #include <chrono>
 #include <thread>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <map>
+#include <stdint.h>
+#include <semaphore.h>
 
 #include "opencv2/opencv.hpp"
 
 #include "Observer.h"
+#include "TxtCameraFrameRing.h"
+#include "TxtCameraGate.h"
+#include "TxtCameraSource.h"
 
 #include "spdlog/spdlog.h"
 
 
+#define CAM_FPS 15.0         // default frame rate of a consumer
+#define TIMEOUT_SNAPSHOT_MS 2000
+#define CAM_CACHE_SIZE 4     // encoded artifacts, one frame in all encodings and the frame before
+#define CAM_JPEG_QUALITY 95  // default of cv::imencode
+
+
 namespace ft {
 
 
+typedef enum
+{
+	CAM_ENC_JPEG,    // JPEG bytes
+	CAM_ENC_BASE64   // data URL "data:image/jpeg;base64,..." of i/cam
+} TxtCameraEncoding;
+
+typedef std::shared_ptr<const std::string> TxtCameraArtifactPtr;
+
+
+typedef struct
+{
+	uint64_t hits;    // artifact found in the cache
+	uint64_t misses;  // artifact encoded
+} TxtCameraCacheStats;
+
+
+typedef struct
+{
+	uint64_t frames;
+	uint64_t late;      // captures after the deadline of the period
+	int64_t sum_us;     // capture time of the source to the frame in the ring
+	int64_t max_us;
+} TxtCameraLatencyStats;
+
+
 class TxtCamera : public SubjectObserver {
 public:
 	TxtCamera(double w=320, double h=240);
 	virtual ~TxtCamera();
 
-	cv::Mat getFrame();
-
-	void setFps(double f) { SPDLOG_LOGGER_TRACE(spdlog::get("console"), ""); fps = f; }
+	//handle of the latest frame without a copy, empty if there is none
+	TxtCameraFramePtr getFrame() { return ring.get(); }
+	TxtCameraFrameRingStats getStats() { return ring.getStats(); }
+
+	//frame source, see TxtCameraSource::create(), call before startThread()
+	void setSource(const std::string& uri, double speed=1.0, bool loop=true, int buffers=CAM_V4L2_BUFFERS)
+		{ sourceUri = uri; sourceSpeed = speed; sourceLoop = loop; sourceBuffers = buffers; }
+	//MJPEG buffers of the driver are published without decode and re-encode,
+	//call before startThread()
+	void setPassthrough(bool p) { passthrough = p; }
+	bool isPassthrough() { return source ? source->isPassthrough() : passthrough; }
+	//pixels of a frame, a passthrough frame is decoded with the DCT scaling of the JPEG decoder,
+	//reduce: 1, 2, 4 or 8
+	static bool getPixels(const TxtCameraFramePtr& f, cv::Mat& out, int reduce=1, bool gray=false);
+
+	//reference counted consumers of the frames (stream, motion detection, snapshot):
+	//the capture runs while one is acquired, at the max fps of all, and idles without.
+	//acquire() wakes the idle capture at once, fps of the consumer is set on each call
+	void acquire(const std::string& consumer, double fps=CAM_FPS);
+	void release(const std::string& consumer);
+	//frame rate of an acquired consumer
+	void setFps(const std::string& consumer, double fps);
+	//references of all consumers
+	size_t getConsumers();
 	double getPeriod() { return 1000./fps; }
+	//a frame captured after the call, with a temporary consumer, empty after timeout_ms
+	TxtCameraFramePtr snapshot(long timeout_ms);
 
 	bool startThread();
 	bool stopThread();
 
-	void start() { doGrab = true; }
-	void stop() { doGrab = false; }
-
 	bool read();
 
 	std::string getDataString();
+	std::string getDataString(const TxtCameraFramePtr& f);
+	//appends the JPEG of the current frame to data, false if there is no frame
+	bool getJpeg(std::string& data, TxtCameraFrameInfo& info);
+	bool getJpeg(const TxtCameraFramePtr& f, std::string& data, TxtCameraFrameInfo& info);
+
+	//change gate of the stream: TxtCameraFrame::changed is false for frames with a mean difference
+	//of the 32x24 thumbnail to the last changed frame below thresh, except one per keepalive_s
+	void setGate(double thresh, double keepalive_s) { changeGate.set(thresh, keepalive_s); }
+	TxtCameraGateStats getGateStats() { return changeGate.getStats(); }
+	TxtCameraLatencyStats getLatencyStats();
+	//frame in the encoding, each frame is encoded once for all consumers, empty on error,
+	//cached: no encode and no wait, empty if the artifact is not encoded yet
+	TxtCameraArtifactPtr getArtifact(const TxtCameraFramePtr& f, TxtCameraEncoding enc, bool cached=false);
+	void setJpegQuality(int q) { quality = q; }
+	int getJpegQuality() { return quality; }
+	TxtCameraCacheStats getCacheStats();
 
 	bool writeFile(const std::string& filename);
 
 protected:
 	bool init();
+	//capture thread: thumbnail of the frame against the last changed frame
+	bool gate(const TxtCameraFrame* f, int64_t ts_ns);
+	TxtCameraArtifactPtr encode(const TxtCameraFramePtr& f, TxtCameraEncoding enc, int q);
 
 private:
-	bool doGrab;
-	cv::VideoCapture cap;
+	//recomputes doGrab and fps, m_mutex is locked by the caller
+	void updateConsumers();
+
+	typedef struct
+	{
+		int refs;
+		double fps;
+	} Consumer_t;
+	std::map<std::string, Consumer_t> consumers; // under m_mutex
+	volatile bool doGrab; // consumers acquired
+	std::string sourceUri;
+	double sourceSpeed;
+	bool sourceLoop;
+	int sourceBuffers;
+	std::unique_ptr<TxtCameraSource> source;
 	double w;
 	double h;
 	int stride;
-	double fps;
-	cv::Mat frame;
-	std::vector<uchar> buf;
+	volatile double fps;  // max of the consumers
+	bool passthrough;
+	TxtCameraFrameRing ring;
+	int quality;
+
+	TxtCameraGate changeGate;
+	cv::Mat gateRef;    // thumbnail of the last changed frame
+	cv::Mat gateThumb;
+	//written by the capture thread only, no lock: the capture never waits for a consumer
+	std::atomic<uint64_t> latencyFrames;
+	std::atomic<uint64_t> latencyLate;
+	std::atomic<int64_t> latencySum_us;
+	std::atomic<int64_t> latencyMax_us;
+
+	typedef struct
+	{
+		uint32_t seq;
+		int quality;
+		TxtCameraEncoding enc;
+		TxtCameraArtifactPtr data; // empty: unused entry
+		bool encoding;             // reserved, the data is encoded outside of the lock
+	} Artifact_t;
+	//cache under m_mutexCache, not m_mutex: an encode does not block the other callers,
+	//concurrent requests of an artifact wait on m_condCache for one encode
+	Artifact_t cache[CAM_CACHE_SIZE];
+	size_t cacheNext;
+	uint64_t cacheHits;
+	uint64_t cacheMisses;
+	pthread_mutex_t m_mutexCache;
+	pthread_cond_t m_condCache;
     unsigned char * yuyv_buffer;
 
 
@@ -63,6 +182,7 @@ private:
     volatile bool m_running;
     pthread_mutex_t m_mutex;
     pthread_t m_thread;
+    sem_t m_semWake; // consumer acquired or stop, the idle capture thread waits for it
 
 	void run();
 
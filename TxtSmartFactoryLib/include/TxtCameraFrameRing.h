@@ -0,0 +1,111 @@
+/*
+ * TxtCameraFrameRing.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTCAMERAFRAMERING_H_
+#define TXTCAMERAFRAMERING_H_
+
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "opencv2/opencv.hpp"
+
+
+#define CAM_RING_SIZE 4 // frame buffers: latest frame, one per consumer, one to capture into
+
+
+namespace ft {
+
+
+typedef struct
+{
+	int64_t ts_ns;   // capture time, ns since epoch
+	uint32_t seq;    // frame number, incremented for every captured frame
+	uint16_t width;
+	uint16_t height;
+} TxtCameraFrameInfo;
+
+
+typedef struct
+{
+	cv::Mat mat;  // BGR pixels, empty in MJPEG passthrough mode
+	cv::Mat jpg;  // MJPEG buffer of the driver, 1xN bytes, passthrough mode only
+	TxtCameraFrameInfo info;
+	bool changed; // passed the change gate of the camera, to be streamed
+} TxtCameraFrame;
+
+//read-only handle of a frame in the ring, the buffer is not overwritten while a handle exists
+typedef std::shared_ptr<const TxtCameraFrame> TxtCameraFramePtr;
+
+
+typedef struct
+{
+	uint64_t captured;   // frames published
+	uint64_t dropped;    // frames not captured, all buffers referenced by consumers
+	uint64_t skipped;    // frames overwritten before any consumer got a handle
+	uint32_t referenced; // buffers with handles
+	uint32_t seq;        // number of the latest frame
+} TxtCameraFrameRingStats;
+
+
+/*
+ * Preallocated frame buffers of the TxtCamera. The capture thread claims
+ * the oldest buffer without handles, captures into it and publishes it as
+ * the latest frame. Consumers get a reference counted handle of the latest
+ * frame instead of a copy. The producer never waits for a consumer: if all
+ * buffers are referenced, the frame is dropped.
+ * The lock is only held to select a buffer, not while capturing.
+ * Handles must be released before the ring is destroyed.
+ */
+class TxtCameraFrameRing
+{
+public:
+	TxtCameraFrameRing(size_t size=CAM_RING_SIZE);
+	virtual ~TxtCameraFrameRing();
+
+	//producer: buffer for the next frame, NULL if there is no free buffer
+	TxtCameraFrame* claim();
+	//producer: the claimed buffer becomes the latest frame with the next sequence number,
+	//width and height are taken from mat, set them in info for a passthrough frame
+	void publish(TxtCameraFrame* f, int64_t ts_ns);
+	//producer: returns a claimed buffer without a frame
+	void abandon(TxtCameraFrame* f);
+
+	//latest frame, empty if there is none
+	TxtCameraFramePtr get();
+	//no latest frame anymore, buffers without handles are freed
+	void clear();
+
+	TxtCameraFrameRingStats getStats();
+
+protected:
+	typedef struct
+	{
+		TxtCameraFrame frame;
+		std::atomic<int> refs;
+		bool writing;
+		bool read;
+	} Slot_t;
+
+	Slot_t* find(TxtCameraFrame* f);
+
+	std::unique_ptr<Slot_t[]> slots;
+	size_t size;
+	Slot_t* latest;
+	uint32_t seq;
+	uint64_t captured;
+	uint64_t dropped;
+	uint64_t skipped;
+
+	pthread_mutex_t m_mutex;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTCAMERAFRAMERING_H_ */
@@ -0,0 +1,66 @@
+/*
+ * TxtCameraGate.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTCAMERAGATE_H_
+#define TXTCAMERAGATE_H_
+
+#include <atomic>
+#include <stdint.h>
+
+
+#define CAM_GATE_W 32        // thumbnail of the change gate
+#define CAM_GATE_H 24
+#define CAM_GATE_THRESH 2.0  // change gate: mean gray value difference to the last streamed frame, 0: off
+#define CAM_GATE_KEEPALIVE_S 10.0 // change gate: an unchanged frame is streamed after this time
+
+
+namespace ft {
+
+
+typedef struct
+{
+	uint64_t changed;   // frames passed the gate
+	uint64_t keepalive; // unchanged frames passed after the keep-alive time
+	uint64_t unchanged; // frames not to be streamed
+} TxtCameraGateStats;
+
+
+/*
+ * Decision of the change gate of the camera stream, on the sum of absolute
+ * differences of the 32x24 thumbnail of a frame to the last changed frame.
+ * update() runs in the capture thread, set() and getStats() in any thread.
+ * The capture thread is the only writer of the counters: they are relaxed
+ * atomics without read-modify-write, a reader never delays a capture.
+ */
+class TxtCameraGate
+{
+public:
+	TxtCameraGate(double thresh=CAM_GATE_THRESH, double keepalive_s=CAM_GATE_KEEPALIVE_S);
+	virtual ~TxtCameraGate() {}
+
+	//thresh: mean difference per pixel, 0: off
+	void set(double thresh, double keepalive_s);
+	bool isEnabled() const { return threshSad.load(std::memory_order_relaxed) > 0; }
+	TxtCameraGateStats getStats() const;
+
+	//capture thread: true if the frame is streamed, the caller keeps its thumbnail as the
+	//new reference. first: no reference yet, sad is not used
+	bool update(bool first, uint32_t sad, int64_t ts_ns);
+
+protected:
+	std::atomic<uint32_t> threshSad; // sad of the thumbnail, 0: off
+	std::atomic<int64_t> keepalive_ns;
+	int64_t tsLast_ns;  // last changed frame, capture thread only
+	std::atomic<uint64_t> changed;
+	std::atomic<uint64_t> keepalives;
+	std::atomic<uint64_t> unchanged;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTCAMERAGATE_H_ */
@@ -0,0 +1,225 @@
+/*
+ * TxtCameraSource.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTCAMERASOURCE_H_
+#define TXTCAMERASOURCE_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "opencv2/opencv.hpp"
+
+#include "TxtCameraFrameRing.h"
+
+
+#define CAM_SOURCE_DEVICE ""  // default source: the first V4L2 device
+#define CAM_SOURCE_V4L2 "v4l2:" // prefix of the native V4L2 source, "v4l2:/dev/video0"
+#define CAM_V4L2_BUFFERS 4    // mmap buffers of the driver
+#define CAM_V4L2_TIMEOUT_MS 2000 // no frame from the driver: error
+
+
+namespace ft {
+
+
+/*
+ * Frames of a TxtCamera. TxtCameraDeviceSource captures from a V4L2 device
+ * with cv::VideoCapture, TxtCameraV4l2Source with mmap buffers of the driver,
+ * TxtCameraFileSource and TxtCameraDirSource replay a video file or a
+ * directory of JPEGs (sorted by name) for tests and benchmarks without a
+ * camera. Replay sources pace themselves in read() with the original frame
+ * period divided by speed (speed 0: as fast as the consumers take them).
+ * Methods are called on the capture thread of the camera.
+ */
+class TxtCameraSource
+{
+public:
+	virtual ~TxtCameraSource() {}
+
+	//"" or "/dev/videoN": device, "v4l2:/dev/videoN": native V4L2 device with buffers,
+	//directory: JPEG replay, other: video file
+	static TxtCameraSource* create(const std::string& uri, double speed=1.0, bool loop=true,
+			int buffers=CAM_V4L2_BUFFERS);
+
+	//passthrough: deliver the JPEG bytes in jpg if the source can
+	virtual bool open(double w, double h, bool passthrough, double fps) = 0;
+	virtual bool isOpened() = 0;
+	//frames are delivered as JPEG bytes, not decoded
+	virtual bool isPassthrough() = 0;
+	//live source: the camera limits the rate, replay: read() waits for the frame time
+	virtual bool isLive() = 0;
+	//end of a replay without loop
+	virtual bool isEnded() = 0;
+
+	//next frame into mat or jpg with info.width/height, info.ts_ns is the capture time
+	//of the driver if the source knows it (0: unknown), false: no frame
+	virtual bool read(TxtCameraFrame* f) = 0;
+	//drops the next frame, all buffers are referenced
+	virtual void grab() = 0;
+	//stops the transfer of the frames without closing the source while the camera idles
+	virtual void setStreaming(bool on) {}
+
+	virtual std::string getName() = 0;
+};
+
+
+class TxtCameraDeviceSource : public TxtCameraSource
+{
+public:
+	TxtCameraDeviceSource(int index) : index(index), cap(), passthrough(false), frameW(0), frameH(0), yuyv() {}
+	virtual ~TxtCameraDeviceSource() {}
+
+	bool open(double w, double h, bool passthrough, double fps) override;
+	bool isOpened() override { return cap.isOpened(); }
+	bool isPassthrough() override { return passthrough; }
+	bool isLive() override { return true; }
+	bool isEnded() override { return false; }
+
+	bool read(TxtCameraFrame* f) override;
+	void grab() override { cap.grab(); }
+
+	std::string getName() override { return "/dev/video" + std::to_string(index); }
+
+protected:
+	int index;
+	cv::VideoCapture cap;
+	bool passthrough;
+	uint16_t frameW; // size of the passthrough frames
+	uint16_t frameH;
+	cv::Mat yuyv;
+};
+
+
+//streaming I/O of V4L2: the driver fills mmap buffers, read() waits for a buffer with poll()
+//and takes the newest one, older ones go back to the driver
+class TxtCameraV4l2Source : public TxtCameraSource
+{
+public:
+	TxtCameraV4l2Source(const std::string& device, int buffers);
+	virtual ~TxtCameraV4l2Source();
+
+	bool open(double w, double h, bool passthrough, double fps) override;
+	bool isOpened() override { return fd >= 0; }
+	bool isPassthrough() override { return passthrough; }
+	bool isLive() override { return true; }
+	bool isEnded() override { return false; }
+
+	bool read(TxtCameraFrame* f) override;
+	void grab() override;
+	void setStreaming(bool on) override;
+
+	std::string getName() override { return device; }
+
+protected:
+	void close();
+	//index of the newest filled buffer, -1: none
+	int dequeue(bool wait);
+	bool queue(int index);
+
+	typedef struct
+	{
+		void* start;
+		size_t length;
+	} Buffer_t;
+
+	std::string device;
+	int buffers;
+	int fd;
+	bool streaming;
+	std::vector<Buffer_t> bufs;
+	uint32_t pixfmt;
+	uint32_t stride;
+	bool passthrough;
+	uint16_t frameW;
+	uint16_t frameH;
+	uint32_t bytesused;  // of the dequeued buffer
+	int64_t tsDriver_ns; // of the dequeued buffer, CLOCK_REALTIME, 0: unknown
+	uint64_t frames;     // buffers dequeued
+	uint64_t stale;      // buffers returned unused, a newer one was ready
+};
+
+
+//pacing of the replay sources
+class TxtCameraReplaySource : public TxtCameraSource
+{
+public:
+	TxtCameraReplaySource(double speed, bool loop) : speed(speed), loop(loop), ended(false),
+		period_ns(0), tsNext_ns(0), frames(0) {}
+	virtual ~TxtCameraReplaySource() {}
+
+	bool isLive() override { return false; }
+	bool isEnded() override { return ended; }
+
+protected:
+	//waits for the time of the next frame
+	void pace();
+
+	double speed;
+	bool loop;
+	bool ended;
+	int64_t period_ns; // original frame period
+	int64_t tsNext_ns;
+	uint64_t frames;   // frames read
+};
+
+
+class TxtCameraFileSource : public TxtCameraReplaySource
+{
+public:
+	TxtCameraFileSource(const std::string& filename, double speed, bool loop)
+		: TxtCameraReplaySource(speed, loop), filename(filename), cap() {}
+	virtual ~TxtCameraFileSource() {}
+
+	bool open(double w, double h, bool passthrough, double fps) override;
+	bool isOpened() override { return cap.isOpened(); }
+	bool isPassthrough() override { return false; }
+
+	bool read(TxtCameraFrame* f) override;
+	void grab() override;
+
+	std::string getName() override { return filename; }
+
+protected:
+	std::string filename;
+	cv::VideoCapture cap;
+};
+
+
+//the frames are replayed at the fps of the camera, all JPEGs have the size of the first one
+class TxtCameraDirSource : public TxtCameraReplaySource
+{
+public:
+	TxtCameraDirSource(const std::string& dir, double speed, bool loop)
+		: TxtCameraReplaySource(speed, loop), dir(dir), files(), next(0), passthrough(false),
+		  frameW(0), frameH(0) {}
+	virtual ~TxtCameraDirSource() {}
+
+	bool open(double w, double h, bool passthrough, double fps) override;
+	bool isOpened() override { return !files.empty(); }
+	bool isPassthrough() override { return passthrough; }
+
+	bool read(TxtCameraFrame* f) override;
+	void grab() override;
+
+	std::string getName() override { return dir; }
+
+protected:
+	//index of the next file, false at the end without loop
+	bool advance();
+
+	std::string dir;
+	std::vector<cv::String> files;
+	size_t next;
+	bool passthrough;
+	uint16_t frameW;
+	uint16_t frameH;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTCAMERASOURCE_H_ */
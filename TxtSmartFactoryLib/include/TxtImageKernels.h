@@ -0,0 +1,45 @@
+/*
+ * TxtImageKernels.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTIMAGEKERNELS_H_
+#define TXTIMAGEKERNELS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "opencv2/opencv.hpp"
+
+
+namespace ft {
+
+
+/*
+ * Integer kernels of the motion detection on 8 bit gray images.
+ * NEON versions are used if the compiler targets NEON (-mfpu=neon),
+ * the scalar versions give the same results on other targets.
+ */
+
+//box blur with a (2r+1)x(2r+1) window, border pixels replicated, src and dst may be the same
+void boxBlur(const cv::Mat& src, cv::Mat& dst, int r);
+
+//sum of absolute differences
+uint32_t sad(const uint8_t* a, const uint8_t* b, size_t n);
+
+//background subtraction with a running average bg in 8.8 fixed point, updated in place:
+//mask[i] = |g[i]-bg[i]| > thresh ? 255 : 0, bg[i] += (g[i]-bg[i]) * alpha/256.
+//With var (running average of the squared difference, NULL: off) a pixel must also
+//differ by more than k standard deviations. Returns the number of set pixels.
+uint32_t backgroundDiff(const uint8_t* g, uint16_t* bg, uint16_t* var, uint8_t* mask, size_t n,
+		uint8_t thresh, uint16_t alpha, uint8_t k);
+
+//bounding box of the set pixels of a CV_8UC1 mask, empty if none is set
+cv::Rect maskBounds(const cv::Mat& mask);
+
+
+} /* namespace ft */
+
+
+#endif /* TXTIMAGEKERNELS_H_ */
@@ -0,0 +1,79 @@
+/*
+ * TxtJsonReader.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTJSONREADER_H_
+#define TXTJSONREADER_H_
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "TxtFactoryTypes.h"
+
+
+namespace ft {
+
+
+/*
+ * Streaming JSON reader for the inbound mqtt payloads.
+ * Reads directly from the payload buffer, without copying it and without
+ * building a Json::Value tree. The caller walks the members of an object
+ * and reads the values it is interested in, all others are skipped.
+ * Errors are sticky: after the first syntax error every call returns false.
+ */
+class TxtJsonReader
+{
+public:
+	TxtJsonReader(const char* data, size_t size);
+	virtual ~TxtJsonReader() {}
+
+	bool ok() const { return !error; }
+	size_t getErrorOffset() const { return errorOffset; }
+
+	//object: beginObject(), then nextMember() until false, read or skip each value
+	bool beginObject();
+	bool nextMember(const char*& key, size_t& len);
+	//true if the next value is null, the null is consumed
+	bool readNull();
+	bool isObject();
+
+	//string value, unescaped into s. numbers and literals as text (like Json::Value::asString())
+	bool readString(std::string& s);
+	//raw string value without quotes, false if it contains escapes
+	bool readStringRef(const char*& s, size_t& len);
+	//number value, truncated (like Json::Value::asInt()), null and false are 0, true is 1
+	bool readInt(int& i);
+	bool readDouble(double& d);
+	bool readBool(bool& b);
+	bool readWPType(TxtWPType_t& t);
+	bool readWPState(TxtWPState_t& s);
+	//{"id","state","type"} into wp
+	bool readWorkpiece(TxtWorkpiece& wp);
+	bool skipValue();
+
+protected:
+	bool fail();
+	void skipWs();
+	bool expect(char c);
+	bool scanString(const char*& s, size_t& len, bool& escaped);
+	bool scanNumber(const char*& s, size_t& len);
+	bool scanLiteral(const char* lit, size_t len);
+	void unescape(const char* s, size_t len, std::string& out);
+
+	const char* p;
+	const char* end;
+	const char* begin;
+	bool error;
+	size_t errorOffset;
+	int depth;
+	bool first; // no member read yet in the current object
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTJSONREADER_H_ */
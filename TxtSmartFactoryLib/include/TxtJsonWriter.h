@@ -0,0 +1,87 @@
+/*
+ * TxtJsonWriter.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTJSONWRITER_H_
+#define TXTJSONWRITER_H_
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+
+#define JSON_WRITER_MAX_DEPTH 8
+#define JSON_WRITER_RESERVE 4096
+
+
+namespace ft {
+
+
+/*
+ * Streaming JSON writer for the mqtt payloads.
+ * Writes directly into a reusable buffer, without building a Json::Value tree.
+ * The output is byte-identical to "sout << Json::Value" (jsoncpp
+ * StreamWriterBuilder defaults: tab indent, " : ", all arrays multi-line,
+ * doubles "%.17g"). jsoncpp sorts object members, so keys must be written
+ * in ascending byte order (checked by assert in DEBUG builds).
+ */
+class TxtJsonWriter
+{
+public:
+	TxtJsonWriter();
+	virtual ~TxtJsonWriter() {}
+
+	//writer of the calling thread, cleared for a new document
+	static TxtJsonWriter& local();
+
+	void clear();
+	const std::string& str() const { return buf; }
+	const char* data() const { return buf.data(); }
+	size_t size() const { return buf.size(); }
+
+	//keys are string literals, their length is known at compile time
+	template<size_t N> TxtJsonWriter& key(const char (&k)[N]) { return key(k, N-1); }
+	TxtJsonWriter& key(const char* k, size_t n);
+
+	TxtJsonWriter& beginObject();
+	TxtJsonWriter& endObject();
+	TxtJsonWriter& beginArray();
+	TxtJsonWriter& endArray();
+
+	TxtJsonWriter& valueString(const char* s, size_t n);
+	TxtJsonWriter& valueString(const char* s);
+	TxtJsonWriter& valueString(const std::string& s) { return valueString(s.data(), s.size()); }
+	TxtJsonWriter& valueInt(int64_t i);
+	TxtJsonWriter& valueBool(bool b);
+	TxtJsonWriter& valueDouble(double d);
+	TxtJsonWriter& valueNull();
+
+protected:
+	typedef struct
+	{
+		bool isArray;
+		bool opened;
+		int count;
+		const char* lastKey;
+	} Level_t;
+
+	void beginValue();
+	void endValue();
+	void open(int i);
+	void writeIndent(int n);
+	void writeWithIndent(int n, char c);
+	void writeQuoted(const char* s, size_t n);
+
+	std::string buf;
+	Level_t level[JSON_WRITER_MAX_DEPTH];
+	int depth;
+	bool indented;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTJSONWRITER_H_ */
@@ -19,11 +19,33 @@
 #include "TxtCamera.h"
 
 #define TIMEWAIT_S_MAX 5.0
+#define MOTION_REDUCE 2      // frames are processed at 1/2 size (pyramid or JPEG DCT scaling)
+#define MOTION_BLUR_R 2      // radius of the box blur at MOTION_REDUCE
+#define MOTION_THRESH 25     // changed pixel: gray value difference above
+#define MOTION_LEARN_RATE 0.05 // background: weight of a new frame, 1.0: previous frame
+#define MOTION_VAR_K 3       // with variance: changed pixel also differs by more than k standard deviations
+#define MOTION_GLOBAL_PCT 60 // more changed pixels [%]: lighting or exposure change, no motion
+#define MOTION_FPS 5.0       // frame rate of the detection as a consumer of the camera
+#define MOTION_IDLE_MS 500   // poll of the camera without consumers
+#define MOTION_DILATE 2      // iterations of the 3x3 dilation of the changed pixels before the contour search
 
 
 namespace ft {
 
 
+typedef struct
+{
+	uint64_t frames;      // processed frames
+	uint64_t earlyExits;  // frames without contour search
+	uint64_t contourRuns; // frames with contour search
+	uint64_t globalChanges; // lighting or exposure changes, background reset
+	uint64_t detections;  // frames with motion
+	uint64_t triggers;    // alerts, at most one per TIMEWAIT_S_MAX
+	double sum_ms;        // processing time of all frames, without capture and decode
+	double max_ms;
+} TxtMotionDetectionStats;
+
+
 class TxtMotionDetection : public SubjectObserver {
 public:
 	TxtMotionDetection(ft::TxtCamera* cam, double max_limit_Area);
@@ -35,11 +57,45 @@ public:
 
 	std::string getDataString();
 
+	TxtMotionDetectionStats getStats();
+	void logStats();
+
+	//weight of a new frame in the background model 1/256..1
+	void setLearningRate(double rate);
+	//gray value difference of a changed pixel
+	void setThreshold(int t);
+	//per-pixel variance of the background, noisy pixels need a larger difference
+	void setVariance(bool v);
+	//previous chain for comparisons: full size frames, GaussianBlur, difference to the last frame,
+	//the stats start again
+	void setOpenCV(bool o);
+	//enabled: the camera captures for the detection at fps, disabled: only the frames
+	//of the other consumers of the camera are processed
+	void setEnabled(bool e, double fps=MOTION_FPS);
+	bool isEnabled() { return enabled; }
+
 protected:
 	ft::TxtCamera* cam;
-	cv::Mat gray_last;
+	//true if a contour of the changes between background and gray is above the limit,
+	//updates the background
+	bool detect(const cv::Mat& gray);
+	//previous chain with OpenCV, gray at full size
+	bool detectOpenCV(cv::Mat& gray);
+	void resetStats();
+
+	uint32_t seqLast;
+	cv::Mat bg;   // running average, CV_16UC1 8.8 fixed point
+	cv::Mat var;  // running average of the squared difference, CV_16UC1
+	cv::Mat mask;
+	cv::Mat grayLast; // previous frame of the OpenCV chain
+	uint16_t alpha; // learning rate * 256
+	uint8_t thresh;
+	bool useVariance;
+	bool useOpenCV;
+	bool enabled;
 	std::chrono::system_clock::time_point tsLastDetected;
 	double max_limit_Area;
+	TxtMotionDetectionStats stats;
 
 	//Thread
     volatile bool m_stoprequested;
@@ -0,0 +1,134 @@
+/*
+ * TxtMotionRecorder.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMOTIONRECORDER_H_
+#define TXTMOTIONRECORDER_H_
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "Observer.h"
+#include "TxtCamera.h"
+
+
+#define CLIP_PRE_S 3.0       // recorded before the trigger [s]
+#define CLIP_POST_S 5.0      // recorded after the trigger [s]
+#define CLIP_FPS 5.0         // max frame rate of a clip
+#define CLIP_FRAMES_MAX 150  // frames of a clip, pre and post
+#define CLIP_QUEUE_MAX 2     // clips waiting for the writer, more are dropped
+#define CLIP_FILES_MAX 20    // clips in the directory, the oldest are deleted
+#define CLIP_INDEX "Clips.json"
+
+
+namespace ft {
+
+
+typedef struct
+{
+	uint64_t clips;    // clips written
+	uint64_t frames;   // frames written
+	uint64_t bytes;    // bytes written
+	uint64_t dropped;  // clips dropped, writer busy
+	uint64_t failed;   // clips not written, file error
+} TxtMotionRecorderStats;
+
+
+/*
+ * Motion event clips: JPEG frames of the camera are kept for CLIP_PRE_S in a
+ * ring. trigger() starts a clip with these frames, frames are added for
+ * CLIP_POST_S more. The finished clip is written by the writer thread as
+ * MJPEG AVI <dir><id>.avi, the index <dir>Clips.json lists the clips.
+ * Frames are taken in Update() of the camera without an encode: the MJPEG
+ * buffer in passthrough mode, the JPEG of the encode cache if a consumer
+ * encoded the frame already, a copy of the pixels otherwise. The writer
+ * encodes the copies, the capture and the detection never wait for an
+ * encode or the disk.
+ */
+class TxtMotionRecorder : public Observer
+{
+public:
+	TxtMotionRecorder(TxtCamera* cam, const std::string& dir="Data/",
+			double pre_s=CLIP_PRE_S, double post_s=CLIP_POST_S);
+	virtual ~TxtMotionRecorder();
+
+	//new camera frame
+	void Update(SubjectObserver* theChangedSubject);
+
+	//starts a clip or extends the running clip, returns the clip id
+	std::string trigger();
+
+	TxtMotionRecorderStats getStats();
+
+	bool startThread();
+	bool stopThread();
+
+protected:
+	typedef struct
+	{
+		int64_t ts_ns;
+		uint16_t width;
+		uint16_t height;
+		TxtCameraArtifactPtr jpg;
+		cv::Mat mat; // BGR pixels if there is no JPEG yet, encoded by the writer
+	} Frame_t;
+
+	typedef struct
+	{
+		std::string id;
+		int64_t tsTrigger_ns;
+		std::vector<Frame_t> frames;
+	} Clip_t;
+
+	//writer thread
+	bool write(Clip_t& clip);
+	//JPEGs of the frames with pixels, frames that cannot be encoded are removed
+	void encode(Clip_t& clip);
+	//all frames have the size of the first one
+	bool writeAvi(const std::string& filename, const Clip_t& clip, size_t& bytes);
+	void writeIndex(const Clip_t& clip, const std::string& file, size_t bytes);
+	void finish();
+
+	TxtCamera* cam;
+	std::string dir;
+	int64_t pre_ns;
+	int64_t post_ns;
+
+	std::deque<Frame_t> ring;  // frames of the last pre_s
+	int64_t tsLast_ns;         // last frame taken
+	bool recording;
+	int64_t tsEnd_ns;          // end of the running clip
+	Clip_t clip;               // running clip
+	std::deque<Clip_t> queue;  // clips for the writer
+	TxtMotionRecorderStats stats;
+
+	pthread_mutex_t m_mutex;
+	sem_t m_semQueue;
+
+	//Thread
+	volatile bool m_stoprequested;
+	volatile bool m_running;
+	pthread_t m_thread;
+
+	void run();
+
+	// This is the static class function that serves as a C style function pointer
+	// for the pthread_create call
+	static void* start_thread(void *obj)
+	{
+		//All we do here is call the do_work() function
+		reinterpret_cast<TxtMotionRecorder*>(obj)->run();
+		return 0;
+	}
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMOTIONRECORDER_H_ */
@@ -9,17 +9,35 @@
 #ifndef TxtMqttFactoryClient_H_
 #define TxtMqttFactoryClient_H_
 
+#include <functional>
+#include <chrono>
+#include <memory>
+
 #include <mqtt/client.h>
 #include <json/json.h>
 
 #include "Utils.h"
 #include "TxtFactoryTypes.h"
+#include "TxtMqttTransport.h"
+#include "TxtMqttOutbox.h"
+#include "TxtMqttTopicPolicy.h"
+#include "TxtMqttPublishQueue.h"
+#include "TxtMqttTopicRouter.h"
 
 #include "spdlog/spdlog.h"
 
 
 #define TIMEOUT_MS_PUBLISH 5000
 
+//i/cam/jpg payload: fixed header, little endian, followed by the JPEG data
+//  0: int64  ts     capture time, ns since epoch
+//  8: uint32 seq    frame number
+// 12: uint16 width
+// 14: uint16 height
+#define CAM_JPG_HEADER_SIZE 16
+
+#define CORR_HISTORY 16 // fl/vgr/do requests kept for pairing the acks
+
 template<class T> std::string toString(const T& t)
 {
      std::ostringstream stream;
@@ -79,62 +97,11 @@ typedef enum
 } TxtSldAckCode_t;
 
 
-class action_listener_subscribe : public virtual mqtt::iaction_listener
-{
-	void on_failure(const mqtt::token& tok) override {
-		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_failure", 0);
-		if (tok.get_message_id() != 0)
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
-	}
-
-	void on_success(const mqtt::token& tok) override {
-		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_success", 0);
-		if (tok.get_message_id() != 0)
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
-		auto topics_ = tok.get_topics();
-		if (topics_ && !topics_->empty()) {
-			for(unsigned int i = 0; i < topics_->size(); i++) {
-				std::string topic0 = (*topics_)[i];
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  token topic: '{}'", topic0);
-			}
-		}
-	}
-
-public:
-	action_listener_subscribe() {};
-};
-
-
-class action_listener_publish : public virtual mqtt::iaction_listener
-{
-	void on_failure(const mqtt::token& tok) override {
-		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_failure", 0);
-		if (tok.get_message_id() != 0)
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
-	}
-
-	void on_success(const mqtt::token& tok) override {
-		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_success", 0);
-		if (tok.get_message_id() != 0)
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
-		auto topics_ = tok.get_topics();
-		if (topics_ && !topics_->empty()) {
-			for(unsigned int i = 0; i < topics_->size(); i++) {
-				std::string topic0 = (*topics_)[i];
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  token topic: '{}'", topic0);
-			}
-		}
-	}
-
-public:
-	action_listener_publish() {};
-};
-
-
 //smart home
 #define TOPIC_INPUT_BME680      "i/bme680"
 #define TOPIC_INPUT_LDR         "i/ldr"
 #define TOPIC_INPUT_CAM         "i/cam"
+#define TOPIC_INPUT_CAM_JPG     "i/cam/jpg"
 #define TOPIC_INPUT_PTUPOS      "i/ptu/pos"
 #define TOPIC_INPUT_ALERT       "i/alert"
 #define TOPIC_INPUT_BROADCAST   "i/broadcast"
@@ -159,6 +126,7 @@ public:
 #define TOPIC_INPUT_STATE_PICKUP "f/i/pickup"
 #define TOPIC_INPUT_STATE_STORE  "f/i/store"
 #define TOPIC_INPUT_NFC_DS       "f/i/nfc/ds"
+#define TOPIC_INPUT_METRICS_     "f/i/metrics/" // main, hbw, vgr, mpo, sld
 
 #define TOPIC_OUTPUT_STATE_ACK   "f/o/state/ack"
 #define TOPIC_OUTPUT_ORDER       "f/o/order"
@@ -176,29 +144,84 @@ public:
 #define TOPIC_LOCAL_SLD_ACK      "fl/sld/ack"
 
 
+typedef struct
+{
+	uint64_t connects;    // (re)connects, start_consume() calls
+	uint64_t subscribed;  // acknowledged SUBSCRIBE requests
+	uint64_t failed;      // failed SUBSCRIBE requests
+	double suback_ms;     // SUBSCRIBE -> SUBACK, last connect
+	double ready_ms;      // connection lost (or connect()) -> SUBACK, last connect
+	double readyAvg_ms;
+	double readyMax_ms;
+} TxtMqttConnectStats;
+
+typedef struct
+{
+	uint64_t requests;  // fl/vgr/do sent with a correlation id
+	uint64_t acks;      // acks of a known request
+	uint64_t unmatched; // acks of an unknown request: earlier session or older than CORR_HISTORY requests
+	uint64_t legacy;    // acks without correlation id
+	double rttAvg_ms;   // request -> first ack
+	double rttMax_ms;
+} TxtMqttCorrelationStats;
+
+
 class TxtMqttFactoryClient {
 public:
 	TxtMqttFactoryClient(std::string clientname, std::string clientNamePrefix, std::string host, std::string port,
 			std::string mqtt_user, mqtt::binary_ref mqtt_pass, bool bretained=false, int iqos=1);
 	virtual ~TxtMqttFactoryClient();
 
-	bool is_connected() { return cli.is_connected(); }
+	bool is_connected() { return transport->isConnected(); }
 
 	bool connect(long int timeout);
 	void disconnect(long int timeout);
 
-	void set_callback(mqtt::callback& cb) { cli.set_callback(cb); }
+	void set_callback(mqtt::callback& cb) { transport->setCallback(cb); }
+	//MQTTVERSION_*, call before connect(). The transports implement 3.1.1:
+	//requests and acks carry the correlation id in the payload ("cid"),
+	//expiry is applied by the topic policy before sending
+	int setMqttVersion(int version);
 
+	//subscribes the topics registered in the router, one SUBSCRIBE request
 	bool start_consume(long int timeout);
+	//call from mqtt::callback::connection_lost, starts the reconnect-to-ready time
+	void connection_lost(const std::string& cause);
+	//true after the SUBACK of the last start_consume()
+	bool is_ready() { return ready; }
+	TxtMqttConnectStats getConnectStats();
+	TxtMqttTopicRouter& getRouter() { return router; }
+	//pairs fl/vgr/do requests and acks, then passes the message to the router
+	bool dispatch(mqtt::const_message_ptr msg);
+	TxtMqttCorrelationStats getCorrelationStats();
+
+	//wait until all queued messages are delivered
+	bool flush(long timeout) { return pubQueue.flush(timeout); }
+	TxtMqttPublishStats getPublishStats() { return pubQueue.getStats(); }
+	//per-topic publish metrics, published every period on f/i/metrics/<station>
+	void getMetrics(std::vector<TxtMqttTopicMetrics>& m) { pubQueue.getMetrics().getSnapshot(m); }
+	void setMetricsPeriod(long period_ms) { pubQueue.setPeriodic([this]() { publishMetrics(TIMEOUT_MS_PUBLISH); }, period_ms); }
+	void publishMetrics(long timeout);
+	//min interval between two coalesced messages of a topic (f/i/stock, f/i/state/*)
+	void setMinInterval(const std::string& topic, long interval_ms) { pubQueue.setMinInterval(topic, interval_ms); }
+	void setMinIntervals(const Json::Value& js);
+	//QoS, retained flag and expiry per topic filter, overrides the defaults of TxtMqttTopicPolicy
+	void setTopicPolicies(const Json::Value& js) { policy.set(js); }
+	TxtMqttTopicPolicy& getTopicPolicy() { return policy; }
 	//mqtt::const_message_ptr consume_message() { return cli.consume_message(); }
 
 	//Smart Home remote
 	void publishLDR(double timestamp_s, int16_t ldr, long timeout);
 	void publishPtuPos(float pan, float tilt, long timeout);
 	void publishCam(const std::string sdata, long timeout);
+	//data: CAM_JPG_HEADER_SIZE reserved bytes followed by the JPEG data,
+	//the header is written in place and data is moved into the message
+	void publishCamJpg(int64_t ts_ns, uint32_t seq, uint16_t width, uint16_t height, std::string&& data, long timeout);
 	void publishBme680(int64_t timestamp, float iaq, uint8_t iaq_accuracy, float temperature, float humidity,
 		float pressure, float raw_temperature, float raw_humidity, float gas, long timeout);
 	void publishAlert(bool st, const std::string id, const std::string sdata, int code, long timeout);
+	//alert with the id of a recorded clip instead of the image
+	void publishAlertClip(const std::string id, const std::string clip, int code, long timeout);
 	void publishBroadcast(double timestamp_s, const std::string sw, const std::string ver, const std::string message, long timeout);
 
 	//Factory remote
@@ -228,23 +251,57 @@ protected:
 	//Factory remote
 	void publishStateStation(const std::string station, TxtLEDSCode_t code, const std::string desc, long timeout, int active=-1, const std::string target="");
 
-	void subTopic(const std::string& topicFilter, long int timeout);
-	void unsubTopic(const std::string& topicFilter, long int timeout);
+	void subscribed(bool ok);
+
+	//"cid" and "code" members of the payload
+	static bool readCid(mqtt::const_message_ptr msg, std::string& cid, int& code);
+	void correlate(mqtt::const_message_ptr msg);
+	std::string getAckCid();
 
 	std::string clientname;
+	std::string station; // clientname without "TxtFactory", lower case
 	mqtt::string host;
 	mqtt::string port;
 	mqtt::string mqtt_user;
 	mqtt::binary_ref mqtt_pass;
 	bool bretained;
 	int iqos;
-	mqtt::async_client cli;
-	mqtt::connect_options connOpts;
+	//paho async_client, or the in-process bus if host is TRANSPORT_LOOPBACK_HOST
+	std::unique_ptr<TxtMqttTransport> transport;
 
+	//payload and message of the publishers, released before pubQueue.push(): the push
+	//waits for free space under back-pressure and must not block the other publishers
 	pthread_mutex_t m_mutex;
 
-	action_listener_subscribe aListSub;
-	action_listener_publish aListPub;
+	//bretained/iqos: topics without a policy
+	TxtMqttTopicPolicy policy;
+	TxtMqttOutbox outbox;
+	TxtMqttPublishQueue pubQueue;
+	TxtMqttTopicRouter router;
+
+	//reconnect-to-ready, m_mutexConnect: the SUBACK arrives on the paho thread
+	pthread_mutex_t m_mutexConnect;
+	volatile bool ready;
+	std::chrono::steady_clock::time_point tsLost;
+	std::chrono::steady_clock::time_point tsSubscribe;
+	TxtMqttConnectStats connStats;
+
+	typedef struct
+	{
+		std::string cid;
+		std::chrono::steady_clock::time_point tsSent;
+		bool acked;
+	} CorrRequest_t;
+
+	//request/ack correlation, m_mutexCorr: acks arrive on the paho thread
+	pthread_mutex_t m_mutexCorr;
+	uint32_t corrSession; // start time, acks of an earlier VGR session do not match
+	uint32_t corrNext;
+	CorrRequest_t corrSent[CORR_HISTORY];
+	std::string cidReceived; // last fl/vgr/do for this station, echoed in the acks
+	TxtMqttCorrelationStats corrStats;
+	double corrRttSum_ms;
+	uint64_t corrRttCount;
 };
 
 
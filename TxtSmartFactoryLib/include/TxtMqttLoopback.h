@@ -0,0 +1,196 @@
+/*
+ * TxtMqttLoopback.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMQTTLOOPBACK_H_
+#define TXTMQTTLOOPBACK_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "TxtMqttTransport.h"
+
+
+#define LOOPBACK_QUEUE_SIZE 1024 // inbound messages per client, power of 2
+#define LOOPBACK_BLOCK_MS 1000   // QoS>=1: max wait for space in a full queue, then the delivery fails
+
+
+namespace ft {
+
+
+typedef struct
+{
+	uint64_t published;  // publish() calls
+	uint64_t delivered;  // messages queued for a subscriber
+	uint64_t dropped;    // QoS 0 messages, queue of the subscriber full
+	uint64_t failed;     // QoS>=1 messages, queue of the subscriber full for LOOPBACK_BLOCK_MS
+	size_t clients;      // connected clients
+	size_t retained;     // retained topics
+} TxtMqttLoopbackStats;
+
+
+/*
+ * Bounded multi-producer single-consumer queue of message pointers.
+ * Each cell has a sequence number: producers claim a cell by
+ * compare-and-swap of the head, the consumer is the delivery thread of the
+ * client. No lock and no allocation, the payload is not copied.
+ */
+class TxtMqttLoopbackQueue
+{
+public:
+	TxtMqttLoopbackQueue(size_t size=LOOPBACK_QUEUE_SIZE);
+	virtual ~TxtMqttLoopbackQueue() {}
+
+	//false if the queue is full
+	bool push(mqtt::const_message_ptr msg);
+	//consumer only, false if the queue is empty
+	bool pop(mqtt::const_message_ptr& msg);
+
+protected:
+	typedef struct
+	{
+		std::atomic<size_t> seq;
+		mqtt::const_message_ptr msg;
+	} Cell_t;
+
+	std::unique_ptr<Cell_t[]> cells;
+	size_t mask;
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+};
+
+
+class TxtMqttLoopback;
+
+/*
+ * Process-wide broker of the TxtMqttLoopback clients. Subscriptions and
+ * retained messages follow MQTT 3.1.1: wildcard filters, one delivery per
+ * client at the highest QoS of its matching filters, downgraded to the QoS
+ * of the message, retained messages sent on subscribe.
+ * The client table is locked for reading by publish(), for writing by
+ * (un)subscribe, connect, disconnect and retained messages. The targets of
+ * a message are collected under the lock, the messages are queued after
+ * it is released: a full queue of a slow subscriber only blocks its
+ * publisher, not the table.
+ */
+class TxtMqttLoopbackBus
+{
+public:
+	static TxtMqttLoopbackBus& instance();
+
+	void attach(TxtMqttLoopback* cli);
+	void detach(TxtMqttLoopback* cli);
+	void subscribe(TxtMqttLoopback* cli, const std::vector<std::string>& topics, int qos);
+	void unsubscribe(TxtMqttLoopback* cli, const std::vector<std::string>& topics);
+	//false if a QoS>=1 delivery failed
+	bool publish(mqtt::const_message_ptr msg);
+
+	TxtMqttLoopbackStats getStats();
+
+protected:
+	TxtMqttLoopbackBus();
+	virtual ~TxtMqttLoopbackBus();
+
+	typedef std::vector<std::pair<TxtMqttLoopback*, mqtt::const_message_ptr> > Targets_t;
+
+	//under the lock: the client stays attached until its delivery is done
+	void addTarget(Targets_t& targets, TxtMqttLoopback* cli, mqtt::const_message_ptr msg);
+	//without the lock
+	bool deliver(Targets_t& targets);
+	bool deliver(TxtMqttLoopback* cli, mqtt::const_message_ptr msg);
+
+	std::set<TxtMqttLoopback*> clients;
+	std::map<std::string, mqtt::const_message_ptr> retained;
+	std::atomic<uint64_t> published;
+	std::atomic<uint64_t> delivered;
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> failed;
+
+	pthread_rwlock_t m_lock;
+};
+
+
+/*
+ * In-process transport for simulation runs with all stations in one
+ * process: messages go through the TxtMqttLoopbackBus instead of a broker.
+ * A delivered message is complete when it is queued for all subscribers,
+ * there is no last will.
+ */
+class TxtMqttLoopback : public TxtMqttTransport
+{
+	friend class TxtMqttLoopbackBus;
+
+public:
+	TxtMqttLoopback(const std::string& clientId);
+	virtual ~TxtMqttLoopback();
+
+	bool isConnected() override { return m_running && !m_stoprequested; }
+	bool connect(long timeout) override;
+	bool disconnect(long timeout) override;
+	void setCallback(mqtt::callback& cb) override { callback = &cb; }
+	void setWill(const mqtt::message& msg) override {}
+	int setMqttVersion(int version) override { return MQTTVERSION_3_1_1; }
+
+	void subscribe(const std::vector<std::string>& topics, int qos, std::function<void(bool)> done) override;
+	bool unsubscribe(const std::vector<std::string>& topics, long timeout) override;
+
+	TxtMqttDeliveryPtr publish(mqtt::const_message_ptr msg) override;
+	void setDeliveryDone(std::function<void()> fn) override { done = fn; }
+
+	bool startThread();
+	bool stopThread();
+	bool isThreadRunning() { return m_running; }
+
+protected:
+	std::string clientId;
+	mqtt::callback* callback;
+	std::function<void()> done;
+
+	std::map<std::string, int> subs; // filter -> QoS, under the lock of the bus
+	TxtMqttLoopbackQueue inbox;
+	sem_t m_semInbox;
+	std::atomic<bool> connectPending;
+
+	//deliveries of the bus outside its lock, detach() waits for them
+	std::atomic<bool> attached;
+	std::atomic<int> pending;
+	std::atomic<int> waiters;      // publishers waiting for space in inbox
+	pthread_mutex_t m_mutexSpace;
+	pthread_cond_t m_condSpace;    // space in inbox, detached, pending deliveries done
+
+	//QoS>=1 into a full inbox: waits until run() pops or the client is detached
+	bool waitPush(mqtt::const_message_ptr msg, long timeout);
+	void notifySpace();
+	void release();
+
+	//Thread
+	volatile bool m_stoprequested;
+	volatile bool m_running;
+	pthread_t m_thread;
+
+	void run();
+
+	// This is the static class function that serves as a C style function pointer
+	// for the pthread_create call
+	static void* start_thread(void *obj)
+	{
+		//All we do here is call the do_work() function
+		reinterpret_cast<TxtMqttLoopback*>(obj)->run();
+		return 0;
+	}
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMQTTLOOPBACK_H_ */
@@ -0,0 +1,96 @@
+/*
+ * TxtMqttMetrics.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMQTTMETRICS_H_
+#define TXTMQTTMETRICS_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+
+#define METRICS_MAX_TOPICS 48
+#define METRICS_TOPIC_LEN 48     // longer topics are truncated
+#define METRICS_HIST_BUCKETS 24  // log2 buckets: bucket i counts values < 2^i, last bucket all above
+#define METRICS_PERIOD_MS 60000  // f/i/metrics/<station>
+
+
+namespace ft {
+
+
+typedef struct
+{
+	std::string topic;
+	uint64_t enqueued;    // push() calls
+	uint64_t sent;        // handed over to the mqtt client
+	uint64_t acked;       // delivery completed (PUBACK for QoS 1)
+	uint64_t failed;      // delivery failed or timed out
+	uint64_t slow;        // delivery completed after 3/4 of the publish timeout
+	uint64_t bytes;       // payload bytes enqueued
+	uint64_t queueMax_us; // maximum enqueue -> send
+	uint64_t ackMax_us;   // maximum send -> PUBACK
+	uint64_t queue_us[METRICS_HIST_BUCKETS]; // enqueue -> send
+	uint64_t ack_us[METRICS_HIST_BUCKETS];   // send -> PUBACK
+	uint64_t size[METRICS_HIST_BUCKETS];     // payload bytes
+} TxtMqttTopicMetrics;
+
+
+/*
+ * Per-topic counters and histograms of the outbound messages.
+ * The table has a fixed number of slots, a topic claims a free slot with
+ * compare-and-swap the first time it is seen. Recording only does relaxed
+ * atomic increments: no lock and no allocation on the publish path.
+ */
+class TxtMqttMetrics
+{
+public:
+	TxtMqttMetrics();
+	virtual ~TxtMqttMetrics() {}
+
+	//slot of the topic, -1 if the table is full
+	int slot(const std::string& topic);
+
+	void enqueued(int slot, size_t bytes);
+	void sent(int slot, uint64_t queue_us);
+	void acked(int slot, uint64_t ack_us, long timeout_ms);
+	void failed(int slot);
+
+	//copy of all used slots
+	void getSnapshot(std::vector<TxtMqttTopicMetrics>& out);
+	void reset();
+
+	static int bucket(uint64_t v);
+
+protected:
+	typedef struct
+	{
+		std::atomic<uint32_t> hash; // 0: free
+		std::atomic<bool> ready;    // topic is written
+		char topic[METRICS_TOPIC_LEN];
+		std::atomic<uint64_t> enqueued;
+		std::atomic<uint64_t> sent;
+		std::atomic<uint64_t> acked;
+		std::atomic<uint64_t> failed;
+		std::atomic<uint64_t> slow;
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> queueMax_us;
+		std::atomic<uint64_t> ackMax_us;
+		std::atomic<uint64_t> queue_us[METRICS_HIST_BUCKETS];
+		std::atomic<uint64_t> ack_us[METRICS_HIST_BUCKETS];
+		std::atomic<uint64_t> size[METRICS_HIST_BUCKETS];
+	} Slot_t;
+
+	static void updateMax(std::atomic<uint64_t>& m, uint64_t v);
+
+	Slot_t slots[METRICS_MAX_TOPICS];
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMQTTMETRICS_H_ */
@@ -0,0 +1,122 @@
+/*
+ * TxtMqttOutbox.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMQTTOUTBOX_H_
+#define TXTMQTTOUTBOX_H_
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+#include <mqtt/message.h>
+
+
+#define OUTBOX_SIZE (256*1024) // ring bytes, without file header
+
+
+namespace ft {
+
+
+typedef struct
+{
+	size_t depth;        // messages stored, not acknowledged yet
+	size_t depthMax;     // high water mark of depth
+	size_t bytes;        // ring bytes used
+	uint64_t appended;   // messages stored
+	uint64_t acked;      // messages removed after PUBACK
+	uint64_t overflow;   // oldest messages dropped because the ring was full
+	uint64_t rejected;   // messages larger than half the ring, not stored
+	uint64_t recovered;  // messages found in the file by open()
+} TxtMqttOutboxStats;
+
+
+/*
+ * Disk-backed store of the outbound QoS>=1 messages that are not
+ * acknowledged by the broker yet. The messages are kept in a ring file
+ * under Data/, mapped into memory. A record is stored before the message
+ * is published and removed after its PUBACK, the file header is updated
+ * after the record is written. Records are checked with a crc32 when the
+ * file is opened, a torn record at the head ends the recovery. PUBACKs can
+ * arrive out of order, acknowledged records behind the tail are flagged.
+ * Not thread safe, used under the lock of the TxtMqttPublishQueue.
+ */
+class TxtMqttOutbox
+{
+public:
+	TxtMqttOutbox(const std::string& filename, size_t size=OUTBOX_SIZE);
+	virtual ~TxtMqttOutbox();
+
+	//maps the file, creates it if it does not exist or does not match
+	bool open();
+	void close();
+	bool isOpen() const { return base != NULL; }
+
+	//stores the message, returns its sequence number, 0 if not stored
+	uint64_t append(mqtt::const_message_ptr msg);
+	//removes the message after its PUBACK
+	void ack(uint64_t seq);
+	//stored messages, oldest first
+	void getMessages(std::vector<std::pair<uint64_t, mqtt::const_message_ptr> >& msgs);
+	void sync();
+
+	TxtMqttOutboxStats getStats();
+
+protected:
+	typedef struct
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t size;    // ring bytes
+		uint64_t head;    // write offset, not wrapped
+		uint64_t tail;    // offset of the oldest record, not wrapped
+		uint64_t nextSeq;
+		uint8_t reserved[24];
+	} Header_t;
+
+	typedef struct
+	{
+		uint32_t len;     // record length including this header, multiple of 8
+		uint32_t acked;   // set after the PUBACK, not covered by crc
+		uint32_t crc;     // crc32 of the record after this field
+		uint32_t payloadLen;
+		uint64_t seq;
+		uint16_t topicLen;
+		uint8_t qos;
+		uint8_t retained;
+		uint32_t reserved;
+	} Record_t;
+
+	typedef struct
+	{
+		uint64_t seq;
+		uint64_t offset;
+		uint32_t len;
+		bool acked;
+	} Index_t;
+
+	void write(uint64_t offset, const void* data, size_t n);
+	void read(uint64_t offset, void* data, size_t n);
+	uint32_t crc(uint64_t offset, size_t n);
+	bool recover();
+	void dropOldest();
+	void advanceTail();
+
+	std::string filename;
+	size_t size;
+	int fd;
+	uint8_t* base;
+	Header_t* header;
+	uint8_t* ring;
+	std::deque<Index_t> index;
+	TxtMqttOutboxStats stats;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMQTTOUTBOX_H_ */
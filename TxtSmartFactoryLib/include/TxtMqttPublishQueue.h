@@ -0,0 +1,238 @@
+/*
+ * TxtMqttPublishQueue.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMQTTPUBLISHQUEUE_H_
+#define TXTMQTTPUBLISHQUEUE_H_
+
+#include <deque>
+#include <map>
+#include <set>
+#include <functional>
+#include <chrono>
+#include <pthread.h>
+
+#include "TxtMqttTransport.h"
+#include "TxtMqttOutbox.h"
+#include "TxtMqttTopicPolicy.h"
+#include "TxtMqttMetrics.h"
+
+#include "spdlog/spdlog.h"
+
+
+#define PUBLISH_QUEUE_SIZE 64
+#define PUBLISH_MAX_INFLIGHT 10 //paho default max inflight
+#define PUBLISH_RETRY_MS 1000 //parked messages are replayed at most once per interval while connected
+#define PUBLISH_REPLAY_TIMEOUT_MS 60000 //delivery timeout of messages recovered from the outbox
+
+
+namespace ft {
+
+
+typedef enum
+{
+	LANE_CONTROL = 0, // fl/* local factory control, sent first
+	LANE_STATE,       // f/i/state/* and all other topics
+	LANE_BULK,        // camera images, latest message per topic wins
+	LANE_COUNT
+} TxtMqttLane_t;
+
+typedef struct
+{
+	uint64_t enqueued;  // messages accepted by push()
+	uint64_t sent;      // messages handed over to the mqtt client
+	uint64_t dropped;   // queue full or replaced by a newer bulk message
+	size_t depth;       // messages waiting in the lane
+	double delayAvg_us; // average time between push() and publish
+	double delayMax_us; // maximum time between push() and publish
+} TxtMqttLaneStats;
+
+typedef struct
+{
+	uint64_t enqueued;  // messages accepted by push()
+	uint64_t sent;      // messages handed over to the mqtt client
+	uint64_t completed; // delivery tokens completed successfully
+	uint64_t failed;    // publish exceptions and failed delivery tokens
+	uint64_t timeouts;  // delivery tokens not completed within timeout
+	uint64_t dropped;   // messages rejected because the queue was full
+	uint64_t blocked;   // push() calls that had to wait for free space
+	uint64_t suppressed; // coalesced messages replaced by a newer value
+	uint64_t deferred;  // coalesced messages held back by the min interval
+	uint64_t expired;   // messages not sent within the expiry of their topic policy
+	size_t depth;       // messages waiting in the queue
+	size_t depthMax;    // high water mark of depth
+	size_t inflight;    // messages sent but not completed
+	double pushAvg_us;  // average time spent by the caller in push()
+	double pushMax_us;  // maximum time spent by the caller in push()
+	TxtMqttLaneStats lane[LANE_COUNT];
+	size_t parked;      // stored messages waiting for the next replay
+	size_t late;        // timed out, still delivered by the mqtt client
+	uint64_t replays;   // replay() calls with parked messages
+	uint64_t replayed;  // messages requeued by replay()
+	double replay_ms;   // last replay: replay() until all replayed messages are acknowledged
+	double replayMax_ms;
+	TxtMqttOutboxStats outbox;
+} TxtMqttPublishStats;
+
+
+/*
+ * Bounded outbound queue of the TxtMqttFactoryClient.
+ * push() only enqueues the message, a sender thread hands it over to the
+ * transport and tracks the deliveries. Callers never wait for the
+ * broker, except if the queue is full (back-pressure) or they call flush().
+ * Messages are sent by lane priority. Bulk messages are only sent if no
+ * control message is waiting or in flight, a newer bulk message replaces a
+ * waiting one of the same topic.
+ * pushLatest() coalesces by key: only the newest value of a key is sent,
+ * at most once per min interval of its topic.
+ * With an outbox, QoS>=1 messages of non-lossy topics are stored on disk
+ * until their PUBACK. Messages that cannot be sent or fail are parked
+ * and requeued in order by replay() after the reconnect, messages found in
+ * the outbox at startup are replayed on the first connect. A timed out
+ * message is not sent again while the client still delivers it: it is only
+ * parked if its token fails or the connection is lost.
+ * With a topic policy, messages older than the expiry of their topic are
+ * dropped instead of sent.
+ */
+class TxtMqttPublishQueue
+{
+public:
+	TxtMqttPublishQueue(TxtMqttTransport& transport,
+			size_t capacity=PUBLISH_QUEUE_SIZE, size_t max_inflight=PUBLISH_MAX_INFLIGHT);
+	virtual ~TxtMqttPublishQueue();
+
+	bool startThread();
+	bool stopThread();
+	bool isThreadRunning() { return m_running; }
+
+	static TxtMqttLane_t getLane(const std::string& topic);
+	//latest value only (camera, ldr), never stored in the outbox
+	static bool isLossy(const std::string& topic);
+
+	//takes the stored messages of the outbox, call before startThread()
+	void setOutbox(TxtMqttOutbox* ob);
+	//requeues the parked messages in order, call after (re)connect
+	void replay();
+	//expiry of the queued messages, call before startThread()
+	void setPolicy(TxtMqttTopicPolicy* p) { policy = p; }
+
+	bool push(mqtt::const_message_ptr msg, long timeout) { return push(msg, timeout, getLane(msg->get_topic())); }
+	bool push(mqtt::const_message_ptr msg, long timeout, TxtMqttLane_t lane);
+	bool pushLatest(mqtt::const_message_ptr msg, long timeout, const std::string& key);
+	bool flush(long timeout);
+
+	void setMinInterval(const std::string& topic, long interval_ms);
+
+	TxtMqttPublishStats getStats();
+	void resetStats();
+	TxtMqttMetrics& getMetrics() { return metrics; }
+	//fn is called by the sender thread every period_ms, without the queue lock
+	void setPeriodic(std::function<void()> fn, long period_ms);
+
+protected:
+	//a delivery completed
+	void notify();
+
+	typedef struct
+	{
+		mqtt::const_message_ptr msg;
+		long timeout;
+		TxtMqttLane_t lane;
+		std::chrono::steady_clock::time_point tsEnqueued;
+		std::string key; // coalescing key, empty if not coalesced
+		uint64_t seq;    // outbox sequence number, 0 if not stored
+		std::chrono::steady_clock::time_point tsExpiry;
+	} Entry_t;
+
+	typedef struct
+	{
+		TxtMqttDeliveryPtr tok;
+		mqtt::const_message_ptr msg;
+		TxtMqttLane_t lane;
+		std::chrono::steady_clock::time_point deadline;
+		long timeout;
+		uint64_t seq;
+		int metric;     // TxtMqttMetrics slot
+		std::chrono::steady_clock::time_point tsSent;
+		std::chrono::steady_clock::time_point tsExpiry;
+	} Inflight_t;
+
+	typedef struct
+	{
+		bool pending;
+		Entry_t entry;
+		std::chrono::steady_clock::time_point tsLastSent;
+	} Coalesce_t;
+
+	bool enqueue(mqtt::const_message_ptr msg, long timeout, TxtMqttLane_t lane, const std::string& key);
+	void persist(Entry_t& e);
+	void park(Entry_t& e);
+	void park(const Inflight_t& f);
+	void acked(uint64_t seq);
+	long getMinInterval(const std::string& topic);
+	std::chrono::steady_clock::time_point getExpiry(const std::string& topic, std::chrono::steady_clock::time_point ts);
+	void releasePending();
+	void reap();
+	int nextLane();
+	size_t getDepth();
+	bool isIdle() { return (getDepth() == 0) && (npending == 0) && inflight.empty() && (sending == 0); }
+	void timedwait(pthread_cond_t* cond, long timeout_ms);
+
+	TxtMqttTransport& transport;
+	size_t capacity;
+	size_t max_inflight;
+
+	std::deque<Entry_t> queue[LANE_COUNT];
+	std::deque<Inflight_t> inflight;
+	size_t inflightLane[LANE_COUNT];
+	int sending;
+
+	std::map<std::string, Coalesce_t> coalesce;
+	std::map<std::string, long> minInterval;
+	size_t npending;
+
+	TxtMqttOutbox* outbox;
+	TxtMqttTopicPolicy* policy;
+	std::map<uint64_t, Entry_t> parked; // by seq
+	std::deque<Inflight_t> late; // timed out, token still pending, not in inflight anymore
+	std::set<uint64_t> replaying; // replayed messages not acknowledged yet
+	std::chrono::steady_clock::time_point tsReplay;
+	std::chrono::steady_clock::time_point tsRetry;
+
+	std::function<void()> periodic;
+	long periodic_ms;
+	std::chrono::steady_clock::time_point tsPeriodic;
+
+	TxtMqttPublishStats stats;
+	TxtMqttMetrics metrics;
+	double pushSum_us;
+	double delaySum_us[LANE_COUNT];
+
+	//Thread
+	volatile bool m_stoprequested;
+	volatile bool m_running;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_condWork;  // new message or completed token
+	pthread_cond_t m_condSpace; // message removed from queue
+	pthread_cond_t m_condIdle;  // queue and inflight empty
+	pthread_t m_thread;
+
+	void run();
+
+	// This is the static class function that serves as a C style function pointer
+	// for the pthread_create call
+	static void* start_thread(void *obj)
+	{
+		//All we do here is call the do_work() function
+		reinterpret_cast<TxtMqttPublishQueue*>(obj)->run();
+		return 0;
+	}
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMQTTPUBLISHQUEUE_H_ */
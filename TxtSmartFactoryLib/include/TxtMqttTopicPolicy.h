@@ -0,0 +1,75 @@
+/*
+ * TxtMqttTopicPolicy.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMQTTTOPICPOLICY_H_
+#define TXTMQTTTOPICPOLICY_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <pthread.h>
+
+#include <mqtt/message.h>
+#include <json/json.h>
+
+
+namespace ft {
+
+
+typedef struct
+{
+	int qos;
+	bool retained;
+	long expiry_s; // not sent anymore after expiry_s in the queue, 0: never expires
+} TxtMqttPolicy_t;
+
+
+/*
+ * Delivery policy of the outbound topics: topic filter -> QoS, retained
+ * flag and expiry. The most specific filter wins: a filter without
+ * wildcards before all others, then the longer part before the first
+ * wildcard. Defaults: telemetry QoS 0, commands QoS 1, states and stock
+ * QoS 1 retained for dashboards that connect later. Topics without a
+ * matching filter use the QoS and retained flag of the constructor.
+ * The result of a topic is cached, set() clears the cache.
+ */
+class TxtMqttTopicPolicy
+{
+public:
+	TxtMqttTopicPolicy(int qos=1, bool retained=false);
+	virtual ~TxtMqttTopicPolicy();
+
+	void set(const std::string& filter, const TxtMqttPolicy_t& p);
+	//{"<filter>": {"qos": 0, "retained": false, "expiry_s": 10}, ...}, missing members keep the current value
+	void set(const Json::Value& js);
+	TxtMqttPolicy_t get(const std::string& topic);
+	//sets QoS and retained flag of the message
+	void apply(mqtt::message_ptr msg);
+
+	void print();
+
+protected:
+	typedef struct
+	{
+		std::string filter;
+		TxtMqttPolicy_t policy;
+		size_t rank;
+	} Rule_t;
+
+	static size_t getRank(const std::string& filter);
+	TxtMqttPolicy_t lookup(const std::string& topic);
+
+	TxtMqttPolicy_t dflt;
+	std::vector<Rule_t> rules; // sorted by rank, highest first
+	std::map<std::string, TxtMqttPolicy_t> cache;
+	pthread_mutex_t m_mutex;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMQTTTOPICPOLICY_H_ */
@@ -0,0 +1,168 @@
+/*
+ * TxtMqttTopicRouter.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMQTTTOPICROUTER_H_
+#define TXTMQTTTOPICROUTER_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <pthread.h>
+
+#include <mqtt/message.h>
+#include <json/json.h>
+
+#include "TxtFactoryTypes.h"
+
+
+#define ROUTER_HIST_BUCKETS 16 // log2 latency buckets: <1us, <2us, <4us ... >=16ms
+
+
+namespace ft {
+
+
+typedef enum
+{
+	TOPIC_ID_UNKNOWN = -1,
+	//smart home
+	TOPIC_ID_OUTPUT_PTU = 0,
+	TOPIC_ID_CONFIG_LINK,
+	TOPIC_ID_CONFIG_BME680,
+	TOPIC_ID_CONFIG_LDR,
+	TOPIC_ID_CONFIG_CAM,
+	//factory remote
+	TOPIC_ID_INPUT_STATE_HBW,
+	TOPIC_ID_INPUT_STATE_VGR,
+	TOPIC_ID_INPUT_STATE_MPO,
+	TOPIC_ID_INPUT_STATE_SLD,
+	TOPIC_ID_INPUT_STATE_DSI,
+	TOPIC_ID_INPUT_STATE_DSO,
+	TOPIC_ID_OUTPUT_STATE_ACK,
+	TOPIC_ID_OUTPUT_ORDER,
+	TOPIC_ID_OUTPUT_PICKUP,
+	TOPIC_ID_OUTPUT_STORE,
+	TOPIC_ID_OUTPUT_NFC_DS,
+	//factory local
+	TOPIC_ID_LOCAL_BROADCAST,
+	TOPIC_ID_LOCAL_SSC_JOY,
+	TOPIC_ID_LOCAL_MPO_ACK,
+	TOPIC_ID_LOCAL_VGR_DO,
+	TOPIC_ID_LOCAL_HBW_ACK,
+	TOPIC_ID_LOCAL_HBW_FAULT,
+	TOPIC_ID_LOCAL_SLD_ACK,
+	TOPIC_ID_COUNT
+} TxtMqttTopicId_t;
+
+
+typedef enum
+{
+	FIELD_TS        = 0x0001, // "ts"
+	FIELD_CODE      = 0x0002, // "code"
+	FIELD_WORKPIECE = 0x0004, // "workpiece": {"id","state","type"}
+	FIELD_TYPE      = 0x0008, // "type"
+	FIELD_JOY       = 0x0010, // "aX1","aY1","b1","aX2","aY2","b2"
+	FIELD_ID        = 0x0020, // "id"
+	FIELD_CMD       = 0x0040, // "cmd"
+	FIELD_ROOT      = 0x8000  // complete Json::Value tree, for all other members
+} TxtMqttField_t;
+
+
+/*
+ * Inbound message as seen by a handler. The router decodes only the fields
+ * the handler declared, directly from the payload buffer. Members that are
+ * not declared or missing keep their default value.
+ */
+class TxtMqttMessage
+{
+public:
+	TxtMqttMessage(TxtMqttTopicId_t id, mqtt::const_message_ptr msg)
+		: id(id), msg(msg), ts(), code(0), hasWorkpiece(false), wp(),
+		  type(WP_TYPE_NONE), joy(), sid(), cmd(), root() {}
+
+	//copy of the workpiece, NULL if null or missing, caller takes ownership
+	TxtWorkpiece* newWorkpiece() const { return hasWorkpiece ? new TxtWorkpiece(wp) : NULL; }
+
+	TxtMqttTopicId_t id;
+	mqtt::const_message_ptr msg;
+	std::string ts;     // FIELD_TS, empty if missing
+	int code;           // FIELD_CODE, 0 if missing (as Json::Value::asInt())
+	bool hasWorkpiece;  // FIELD_WORKPIECE
+	TxtWorkpiece wp;
+	TxtWPType_t type;   // FIELD_TYPE, WP_TYPE_NONE if unknown
+	TxtJoysticksData joy; // FIELD_JOY
+	std::string sid;    // FIELD_ID
+	std::string cmd;    // FIELD_CMD
+	Json::Value root;   // FIELD_ROOT
+};
+
+typedef std::function<void(const TxtMqttMessage&)> TxtMqttHandler_t;
+
+typedef struct
+{
+	uint64_t count;    // messages passed to the handler
+	uint64_t expired;  // messages dropped by the ts TTL check
+	uint64_t errors;   // payloads that could not be parsed or handled
+	double avg_us;     // average time to parse and handle a message
+	double max_us;     // maximum time to parse and handle a message
+	uint64_t hist[ROUTER_HIST_BUCKETS]; // bucket i: latency < 2^i us, last bucket: all above
+} TxtMqttHandlerStats;
+
+
+/*
+ * Dispatches inbound messages to the handlers registered by the station.
+ * The topic is mapped to its TxtMqttTopicId_t with a precomputed hash table
+ * (FNV-1a, open addressing) instead of comparing it with every known topic.
+ * The payload is decoded with TxtJsonReader, a Json::Value tree is only
+ * built for handlers that declare FIELD_ROOT.
+ * The registered topics are also the subscription list of the client.
+ */
+class TxtMqttTopicRouter
+{
+public:
+	TxtMqttTopicRouter();
+	virtual ~TxtMqttTopicRouter();
+
+	static TxtMqttTopicId_t lookup(const char* topic, size_t len);
+	static TxtMqttTopicId_t lookup(const std::string& topic) { return lookup(topic.data(), topic.size()); }
+	static const char* getTopic(TxtMqttTopicId_t id);
+
+	//fields: TxtMqttField_t flags the handler reads
+	//checkTTL: drop messages with an expired "ts" before the handler is called
+	void add(TxtMqttTopicId_t id, unsigned int fields, TxtMqttHandler_t handler, bool checkTTL=false);
+	void remove(TxtMqttTopicId_t id);
+	std::vector<std::string> getTopics();
+
+	//false if there is no handler for the topic
+	bool dispatch(mqtt::const_message_ptr msg);
+
+	TxtMqttHandlerStats getStats(TxtMqttTopicId_t id);
+	void resetStats();
+	void printStats();
+
+protected:
+	typedef struct
+	{
+		TxtMqttHandler_t fn;
+		unsigned int fields;
+		bool checkTTL;
+		TxtMqttHandlerStats stats;
+		double sum_us;
+	} Handler_t;
+
+	bool decode(const char* data, size_t size, unsigned int fields, TxtMqttMessage& m, std::string& errs);
+	void record(Handler_t& h, double us);
+
+	Handler_t handlers[TOPIC_ID_COUNT];
+	std::unique_ptr<Json::CharReader> reader; // FIELD_ROOT
+	pthread_mutex_t m_mutex;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMQTTTOPICROUTER_H_ */
@@ -0,0 +1,173 @@
+/*
+ * TxtMqttTransport.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTMQTTTRANSPORT_H_
+#define TXTMQTTTRANSPORT_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <mqtt/async_client.h>
+
+#include "spdlog/spdlog.h"
+
+
+#define TRANSPORT_LOOPBACK_HOST "loopback" // host of the in-process bus, see TxtMqttLoopback
+
+
+namespace ft {
+
+
+class action_listener_subscribe : public virtual mqtt::iaction_listener
+{
+	std::function<void(bool)> done;
+
+	void on_failure(const mqtt::token& tok) override {
+		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_failure", 0);
+		if (tok.get_message_id() != 0)
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
+		if (done) done(false);
+	}
+
+	void on_success(const mqtt::token& tok) override {
+		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_success", 0);
+		if (tok.get_message_id() != 0)
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
+		auto topics_ = tok.get_topics();
+		if (topics_ && !topics_->empty()) {
+			for(unsigned int i = 0; i < topics_->size(); i++) {
+				std::string topic0 = (*topics_)[i];
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  token topic: '{}'", topic0);
+			}
+		}
+		if (done) done(true);
+	}
+
+public:
+	action_listener_subscribe() {};
+	//called with the result of the SUBSCRIBE request
+	void setDone(std::function<void(bool)> fn) { done = fn; }
+};
+
+
+class action_listener_publish : public virtual mqtt::iaction_listener
+{
+	std::function<void()> done;
+
+	void on_failure(const mqtt::token& tok) override {
+		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_failure", 0);
+		if (tok.get_message_id() != 0)
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
+		if (done) done();
+	}
+
+	void on_success(const mqtt::token& tok) override {
+		SPDLOG_LOGGER_TRACE(spdlog::get("console"), "on_success", 0);
+		if (tok.get_message_id() != 0)
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  for token: [{}]", tok.get_message_id());
+		auto topics_ = tok.get_topics();
+		if (topics_ && !topics_->empty()) {
+			for(unsigned int i = 0; i < topics_->size(); i++) {
+				std::string topic0 = (*topics_)[i];
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  token topic: '{}'", topic0);
+			}
+		}
+		if (done) done();
+	}
+
+public:
+	action_listener_publish() {};
+	//called when a delivery token completes
+	void setDone(std::function<void()> fn) { done = fn; }
+};
+
+
+/*
+ * Completion state of a published message, polled by the TxtMqttPublishQueue.
+ */
+class TxtMqttDelivery
+{
+public:
+	virtual ~TxtMqttDelivery() {}
+	virtual bool isComplete() = 0;
+	//0 if delivered
+	virtual int getReturnCode() = 0;
+};
+
+typedef std::shared_ptr<TxtMqttDelivery> TxtMqttDeliveryPtr;
+
+
+/*
+ * Connection of a TxtMqttFactoryClient. TxtMqttPahoTransport talks to a
+ * broker over TCP, TxtMqttLoopback delivers to the other clients of the
+ * same process. Inbound messages and the connected event are passed to the
+ * mqtt::callback of setCallback() on the thread of the transport.
+ * The methods throw mqtt::exception.
+ */
+class TxtMqttTransport
+{
+public:
+	virtual ~TxtMqttTransport() {}
+
+	//loopback bus if host is TRANSPORT_LOOPBACK_HOST, paho async_client otherwise
+	static TxtMqttTransport* create(const std::string& host, const std::string& port, const std::string& clientId,
+			const std::string& user, mqtt::binary_ref pass);
+	//MQTT topic filter with + and # wildcards
+	static bool matches(const std::string& filter, const std::string& topic);
+
+	virtual bool isConnected() = 0;
+	virtual bool connect(long timeout) = 0;
+	virtual bool disconnect(long timeout) = 0;
+	virtual void setCallback(mqtt::callback& cb) = 0;
+	//last will, call before connect()
+	virtual void setWill(const mqtt::message& msg) = 0;
+	//MQTTVERSION_*, call before connect(), returns the version used
+	virtual int setMqttVersion(int version) = 0;
+
+	//done is called with the result of the SUBSCRIBE, do not wait for it in the callback thread
+	virtual void subscribe(const std::vector<std::string>& topics, int qos, std::function<void(bool)> done) = 0;
+	virtual bool unsubscribe(const std::vector<std::string>& topics, long timeout) = 0;
+
+	virtual TxtMqttDeliveryPtr publish(mqtt::const_message_ptr msg) = 0;
+	//fn is called when a delivery completes
+	virtual void setDeliveryDone(std::function<void()> fn) = 0;
+};
+
+
+class TxtMqttPahoTransport : public TxtMqttTransport
+{
+public:
+	TxtMqttPahoTransport(const std::string& serverURI, const std::string& clientId,
+			const std::string& user, mqtt::binary_ref pass);
+	virtual ~TxtMqttPahoTransport() {}
+
+	bool isConnected() override { return cli.is_connected(); }
+	bool connect(long timeout) override;
+	bool disconnect(long timeout) override;
+	void setCallback(mqtt::callback& cb) override { cli.set_callback(cb); }
+	void setWill(const mqtt::message& msg) override;
+	int setMqttVersion(int version) override;
+
+	void subscribe(const std::vector<std::string>& topics, int qos, std::function<void(bool)> done) override;
+	bool unsubscribe(const std::vector<std::string>& topics, long timeout) override;
+
+	TxtMqttDeliveryPtr publish(mqtt::const_message_ptr msg) override;
+	void setDeliveryDone(std::function<void()> fn) override { aListPub.setDone(fn); }
+
+protected:
+	mqtt::async_client cli;
+	mqtt::connect_options connOpts;
+	action_listener_subscribe aListSub;
+	action_listener_publish aListPub;
+};
+
+
+} /* namespace ft */
+
+
+#endif /* TXTMQTTTRANSPORT_H_ */
@@ -13,6 +13,8 @@
 #include <string>
 #include <time.h>
 #include <iomanip>
+#include <chrono>
+#include <stdint.h>
 
 #include "spdlog/spdlog.h"
 
@@ -20,18 +22,25 @@
 namespace ft {
 
 
-long time_offset();
+//timestamps: UTC "YYYY-MM-DDTHH:MM:SS.mmmZ" (sts: 25 chars), int64_t in ns since epoch
 bool trycheckTimestampTTL(const std::string& str, double diff_max = 10.0);
+bool checkTimestampTTL(const char* s, size_t len, int64_t ttl_ns);
+bool parsetimestamp(const char* s, size_t len, int64_t& timestamp);
 
 void gettimestampstr(int64_t timestamp, char* sts);
 void gettimestr(time_t rawtime, int ms, char* sts);
 void getnowstr(char* sts);
 double getnowtimestamp_s();
+int64_t getnowtimestamp_ns();
 
 std::chrono::system_clock::time_point trygettimepoint(const std::string& str);
 
 #ifndef NO_MQTT
 std::string ftos(float f, int nd);
+//ftos without allocation: into buf, returns length
+int ftoa(float f, int nd, char* buf, size_t size);
+//same as fromString<double>(ftos(f, nd))
+double ftod(float f, int nd);
 #endif
 
 
@@ -27,10 +27,28 @@
 
    René Nyffenegger rene.nyffenegger@adp-gmbh.ch
 
+   Modified: base64_encode reserves the exact size and encodes blocks of
+   48 (NEON), 24 (AVX2), 12 (SSSE3) or 6 (SWAR) bytes, the variant is
+   selected by the compiler target. base64_encode into a caller buffer.
+
 */
 
 #include "base64.h"
 #include <iostream>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BASE64_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define BASE64_AVX2
+#define BASE64_SSSE3
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define BASE64_SSSE3
+#endif
 
 static const std::string base64_chars = 
              "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -42,46 +60,179 @@ static inline bool is_base64(unsigned char c) {
   return (isalnum(c) || (c == '+') || (c == '/'));
 }
 
-std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  while (in_len--) {
-    char_array_3[i++] = *(bytes_to_encode++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for(i = 0; (i <4) ; i++)
-        ret += base64_chars[char_array_4[i]];
-      i = 0;
+static const char base64_table[] =
+             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+             "abcdefghijklmnopqrstuvwxyz"
+             "0123456789+/";
+
+#ifdef BASE64_NEON
+// 48 bytes -> 64 chars: vld3 splits the bytes of the 3-byte groups,
+// the 6 bit indices are mapped to ASCII by range offsets.
+static size_t encode_neon(const unsigned char* in, size_t len, char* out, size_t i) {
+  const uint8x16_t c26 = vdupq_n_u8(26), c52 = vdupq_n_u8(52);
+  const uint8x16_t c62 = vdupq_n_u8(62), c63 = vdupq_n_u8(63);
+  const uint8x16_t m3f = vdupq_n_u8(0x3f);
+  out += i / 3 * 4;
+  for (; i + 48 <= len; i += 48, out += 64) {
+    uint8x16x3_t b = vld3q_u8(in + i);
+    uint8x16x4_t x;
+    x.val[0] = vshrq_n_u8(b.val[0], 2);
+    x.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(b.val[0], 4), vshrq_n_u8(b.val[1], 4)), m3f);
+    x.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(b.val[1], 2), vshrq_n_u8(b.val[2], 6)), m3f);
+    x.val[3] = vandq_u8(b.val[2], m3f);
+    for (int k = 0; k < 4; k++) {
+      uint8x16_t v = x.val[k];
+      // 'A'+v, 'a'-26+v, '0'-52+v, '+', '/'
+      uint8x16_t r = vaddq_u8(v, vdupq_n_u8('A'));
+      r = vaddq_u8(r, vandq_u8(vcgeq_u8(v, c26), vdupq_n_u8(6)));
+      r = vsubq_u8(r, vandq_u8(vcgeq_u8(v, c52), vdupq_n_u8(75)));
+      r = vsubq_u8(r, vandq_u8(vcgeq_u8(v, c62), vdupq_n_u8(15)));
+      r = vaddq_u8(r, vandq_u8(vcgeq_u8(v, c63), vdupq_n_u8(3)));
+      x.val[k] = r;
     }
+    vst4q_u8((uint8_t*)out, x);
   }
+  return i;
+}
+#endif
+
+#ifdef BASE64_SSSE3
+// 6 bit indices of 12 bytes in the 16 lanes and their ASCII chars (W. Mula).
+static inline __m128i enc_reshuffle(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
 
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
+static inline __m128i enc_translate(__m128i in) {
+  const __m128i lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m128i idx = _mm_subs_epu8(in, _mm_set1_epi8(51));
+  const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), in);
+  idx = _mm_or_si128(idx, _mm_and_si128(less, _mm_set1_epi8(13)));
+  return _mm_add_epi8(in, _mm_shuffle_epi8(lut, idx));
+}
 
-    char_array_4[0] = ( char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+// 12 bytes -> 16 chars, reads 16 bytes
+static size_t encode_ssse3(const unsigned char* in, size_t len, char* out, size_t i) {
+  out += i / 3 * 4;
+  for (; i + 16 <= len; i += 12, out += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm_storeu_si128((__m128i*)out, enc_translate(enc_reshuffle(v)));
+  }
+  return i;
+}
+#endif
+
+#ifdef BASE64_AVX2
+static inline __m256i enc_reshuffle256(__m256i in) {
+  // the load starts 4 bytes early: lane 0 holds bytes 0..11 at 4..15, lane 1 bytes 12..23 at 0..11
+  in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+      14, 15, 13, 14, 11, 12, 10, 11, 8, 9, 7, 8, 5, 6, 4, 5));
+  const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+  const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+  const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+  const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+  return _mm256_or_si256(t1, t3);
+}
 
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars[char_array_4[j]];
+static inline __m256i enc_translate256(__m256i in) {
+  const __m256i lut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m256i idx = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+  const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), in);
+  idx = _mm256_or_si256(idx, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+  return _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, idx));
+}
 
-    while((i++ < 3))
-      ret += '=';
+// 24 bytes -> 32 chars, starts at byte 4, reads from in+i-4 to in+i+27
+static size_t encode_avx2(const unsigned char* in, size_t len, char* out, size_t i) {
+  out += i / 3 * 4;
+  for (; i + 28 <= len; i += 24, out += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(in + i - 4));
+    _mm256_storeu_si256((__m256i*)out, enc_translate256(enc_reshuffle256(v)));
+  }
+  return i;
+}
+#endif
+
+// 6 bytes -> 8 chars: the indices are packed into the bytes of a 64 bit word
+// and mapped to ASCII in all bytes at once (SIMD within a register).
+static size_t encode_swar(const unsigned char* in, size_t len, char* out, size_t i) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t high = 0x8080808080808080ULL;
+  out += i / 3 * 4;
+  for (; i + 6 <= len; i += 6, out += 8) {
+    uint64_t v = ((uint64_t)in[i] << 40) | ((uint64_t)in[i+1] << 32) | ((uint64_t)in[i+2] << 24)
+        | ((uint64_t)in[i+3] << 16) | ((uint64_t)in[i+4] << 8) | (uint64_t)in[i+5];
+    uint64_t x = 0;
+    for (int k = 0; k < 8; k++) {
+      x |= ((v >> (42 - 6*k)) & 0x3f) << (8*k);
+    }
+    // per byte x >= n: bit 7 of x + 128 - n, the bytes are < 64 so there is no carry
+    uint64_t ge26 = ((x + ones * (128 - 26)) & high) >> 7;
+    uint64_t ge52 = ((x + ones * (128 - 52)) & high) >> 7;
+    uint64_t ge62 = ((x + ones * (128 - 62)) & high) >> 7;
+    uint64_t ge63 = ((x + ones * (128 - 63)) & high) >> 7;
+    x += ones * 'A' + ge26 * 6 + ge63 * 3;
+    x -= ge52 * 75 + ge62 * 15;
+    for (int k = 0; k < 8; k++) {
+      out[k] = (char)(x >> (8*k));
+    }
+  }
+  return i;
+}
 
+// The block encoders start at byte i and return the end of their last block,
+// the blocks are multiples of 3 bytes: the chars of i bytes end at out + i/3*4.
+size_t base64_encode(unsigned char const* bytes_to_encode, size_t in_len, char* out) {
+  size_t i = 0;
+#if defined(BASE64_NEON)
+  i = encode_neon(bytes_to_encode, in_len, out, i);
+#elif defined(BASE64_AVX2)
+  if (in_len >= 32) {
+    // the AVX2 load starts 4 bytes before the block: first block with SSSE3
+    i = encode_ssse3(bytes_to_encode, 16, out, i);
+    i = encode_avx2(bytes_to_encode, in_len, out, i);
+  }
+  i = encode_ssse3(bytes_to_encode, in_len, out, i);
+#elif defined(BASE64_SSSE3)
+  i = encode_ssse3(bytes_to_encode, in_len, out, i);
+#endif
+  i = encode_swar(bytes_to_encode, in_len, out, i);
+  char* p = out + i / 3 * 4;
+
+  // last 0..5 bytes
+  for (; i + 3 <= in_len; i += 3) {
+    uint32_t v = (bytes_to_encode[i] << 16) | (bytes_to_encode[i+1] << 8) | bytes_to_encode[i+2];
+    *p++ = base64_table[(v >> 18) & 0x3f];
+    *p++ = base64_table[(v >> 12) & 0x3f];
+    *p++ = base64_table[(v >> 6) & 0x3f];
+    *p++ = base64_table[v & 0x3f];
   }
+  if (i < in_len) {
+    uint32_t v = bytes_to_encode[i] << 16;
+    if (i + 1 < in_len) v |= bytes_to_encode[i+1] << 8;
+    *p++ = base64_table[(v >> 18) & 0x3f];
+    *p++ = base64_table[(v >> 12) & 0x3f];
+    *p++ = (i + 1 < in_len) ? base64_table[(v >> 6) & 0x3f] : '=';
+    *p++ = '=';
+  }
+  return p - out;
+}
 
+std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
+  std::string ret(base64_encoded_size(in_len), '\0');
+  if (in_len) {
+    base64_encode(bytes_to_encode, (size_t)in_len, &ret[0]);
+  }
   return ret;
-
 }
 
 std::string base64_decode(std::string const& encoded_string) {
@@ -2,13 +2,23 @@
 //  base64 encoding and decoding with C++.
 //  Version: 1.01.00
 //
+//  Modified: block encoders (NEON, SSSE3, AVX2, SWAR) and encoding into a
+//  caller buffer, see base64.cpp.
+//
 
 #ifndef BASE64_H_C0CE2A47_D10E_42C9_A27C_C883944E704A
 #define BASE64_H_C0CE2A47_D10E_42C9_A27C_C883944E704A
 
 #include <string>
+#include <stddef.h>
 
 std::string base64_encode(unsigned char const* , unsigned int len);
 std::string base64_decode(std::string const& s);
 
+// Encoded size of len bytes, with padding.
+inline size_t base64_encoded_size(size_t len) { return 4 * ((len + 2) / 3); }
+// Encodes len bytes into out, which must hold base64_encoded_size(len) chars.
+// No terminating '\0'. Returns the number of chars written.
+size_t base64_encode(unsigned char const* bytes_to_encode, size_t in_len, char* out);
+
 #endif /* BASE64_H_C0CE2A47_D10E_42C9_A27C_C883944E704A */
@@ -6,76 +6,140 @@
  */
 
 #include "TxtCamera.h"
+#include "TxtImageKernels.h"
 
 #include "base64.h"
+#include "Utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 #include <thread>	// For sleep
 #include <chrono>
-
-//#define USE_YUYV
+#include <algorithm>
 
 
 namespace ft {
 
 
 TxtCamera::TxtCamera(double w, double h) :
-	doGrab(false), cap(), w(w), h(h), stride(0), fps(15.0), yuyv_buffer(0), m_stoprequested(false),
-	m_running(false), m_mutex(), m_thread()
+	consumers(), doGrab(false), sourceUri(CAM_SOURCE_DEVICE), sourceSpeed(1.0), sourceLoop(true), sourceBuffers(CAM_V4L2_BUFFERS), source(),
+	w(w), h(h), stride(0), fps(CAM_FPS), passthrough(false), ring(),
+	quality(CAM_JPEG_QUALITY), changeGate(),
+	gateRef(), gateThumb(), cacheNext(0), cacheHits(0), cacheMisses(0), m_mutexCache(), m_condCache(), yuyv_buffer(0), m_stoprequested(false),
+	m_running(false), m_mutex(), m_thread(), m_semWake()
 {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtCamera w:{} h:{}", w, h);
 	pthread_mutexattr_t attr;
 	pthread_mutexattr_init(&attr);
 	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 	pthread_mutex_init(&m_mutex, &attr);
+	sem_init(&m_semWake, 0, 0);
+	pthread_mutex_init(&m_mutexCache, 0);
+	pthread_cond_init(&m_condCache, 0);
+	for (size_t i = 0; i < CAM_CACHE_SIZE; i++) {
+		cache[i].seq = 0;
+		cache[i].quality = 0;
+		cache[i].enc = CAM_ENC_JPEG;
+		cache[i].encoding = false;
+	}
+	latencyFrames = 0;
+	latencyLate = 0;
+	latencySum_us = 0;
+	latencyMax_us = 0;
 }
 
 TxtCamera::~TxtCamera() {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtCamera");
 	if (m_running) {
-		stop();
+		stopThread();
 	}
+	sem_destroy(&m_semWake);
+	pthread_cond_destroy(&m_condCache);
+	pthread_mutex_destroy(&m_mutexCache);
 	pthread_mutex_destroy(&m_mutex);
 }
 
+void TxtCamera::acquire(const std::string& consumer, double fps) {
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "camera acquire consumer:{} fps:{}", consumer, fps);
+	pthread_mutex_lock(&m_mutex);
+	Consumer_t& c = consumers[consumer]; // new: refs 0
+	c.refs++;
+	c.fps = fps;
+	updateConsumers();
+	pthread_mutex_unlock(&m_mutex);
+	sem_post(&m_semWake);
+}
+
+void TxtCamera::release(const std::string& consumer) {
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "camera release consumer:{}", consumer);
+	pthread_mutex_lock(&m_mutex);
+	std::map<std::string, Consumer_t>::iterator it = consumers.find(consumer);
+	if ((it != consumers.end()) && (--it->second.refs <= 0)) {
+		consumers.erase(it);
+	}
+	updateConsumers();
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtCamera::setFps(const std::string& consumer, double fps) {
+	pthread_mutex_lock(&m_mutex);
+	std::map<std::string, Consumer_t>::iterator it = consumers.find(consumer);
+	if (it != consumers.end()) {
+		it->second.fps = fps;
+		updateConsumers();
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+size_t TxtCamera::getConsumers() {
+	pthread_mutex_lock(&m_mutex);
+	size_t n = 0;
+	for (std::map<std::string, Consumer_t>::iterator it = consumers.begin(); it != consumers.end(); ++it) {
+		n += it->second.refs;
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return n;
+}
+
+void TxtCamera::updateConsumers() {
+	double f = 0.;
+	for (std::map<std::string, Consumer_t>::iterator it = consumers.begin(); it != consumers.end(); ++it) {
+		f = std::max(f, it->second.fps);
+	}
+	if (f > 0.) {
+		fps = f;
+	}
+	doGrab = !consumers.empty();
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "camera consumers:{} fps:{}", consumers.size(), fps);
+}
+
+TxtCameraFramePtr TxtCamera::snapshot(long timeout_ms) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "snapshot timeout_ms:{}", timeout_ms);
+	uint32_t seq = ring.getStats().seq;
+	acquire("snapshot", fps);
+	TxtCameraFramePtr f;
+	auto tsEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	while (std::chrono::steady_clock::now() < tsEnd) {
+		f = ring.get();
+		if (f && (f->info.seq > seq)) {
+			break;
+		}
+		f.reset();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	release("snapshot");
+	return f;
+}
+
 bool TxtCamera::init() {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "init");
-	bool ret = cap.open(0);
-	if (!ret) {
-        std::cout << "error cap.open(0)" << std::endl;
-	}
-#ifndef USE_YUYV
-    bool r = cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'));
-    if (!r) {
-        std::cout << "error cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'))" << std::endl;
-    	return false;
-    }
-#else
-    bool r = cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y','U','Y','V'));
-    if (!r) {
-        std::cout << "error cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y','U','Y','V'))" << std::endl;
-    	return false;
-    }
-#endif
-    //cap.set(cv::CAP_PROP_FPS, 15);
-    //cap.set(cv::CAP_PROP_AUTO_EXPOSURE, 3);
-    r = cap.set(cv::CAP_PROP_FRAME_WIDTH, w);//640);
-    if (!r) {
-        std::cout << "error cap.set(cv::CAP_PROP_FRAME_WIDTH, w)" << std::endl;
-    	return false;
-    }
-    r = cap.set(cv::CAP_PROP_FRAME_HEIGHT, h);//480);
-    if (!r) {
-        std::cout << "error cap.set(cv::CAP_PROP_FRAME_HEIGHT, h)" << std::endl;
-    	return false;
-    }
-    std::cout << "init frame " << cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_WIDTH);
-    std::cout << "x" << cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_HEIGHT);
-    std::cout << " Format: " << cap.get(cv::VideoCaptureProperties::CAP_PROP_FORMAT) << std::endl;
-    return cap.isOpened();
+	if (!source) {
+		source.reset(TxtCameraSource::create(sourceUri, sourceSpeed, sourceLoop, sourceBuffers));
+	}
+	return source->open(w, h, passthrough, fps);
 }
 
 bool TxtCamera::startThread() {
@@ -108,99 +172,340 @@ bool TxtCamera::stopThread() {
     assert(m_running == true);
     m_running = false;
     m_stoprequested = true;
-    return pthread_join(m_thread, 0) == 0;
-}
-
-cv::Mat TxtCamera::getFrame() {
-	//SPDLOG_LOGGER_TRACE(spdlog::get("console"), "getFrame");
-	cv::Mat frame_ret;
-	//SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock getFrame");
-	pthread_mutex_lock(&m_mutex);
-	frame.copyTo(frame_ret);
-	pthread_mutex_unlock(&m_mutex);
-	//SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock getFrame");
-	return frame_ret;
-
+    sem_post(&m_semWake);
+    bool ret = pthread_join(m_thread, 0) == 0;
+    TxtCameraFrameRingStats st = ring.getStats();
+    spdlog::get("console")->info("camera frames captured:{} dropped:{} skipped:{}", st.captured, st.dropped, st.skipped);
+    TxtCameraCacheStats cst = getCacheStats();
+    spdlog::get("console")->info("camera encode cache hits:{} misses:{}", cst.hits, cst.misses);
+    TxtCameraGateStats gst = getGateStats();
+    spdlog::get("console")->info("camera gate changed:{} keepalive:{} unchanged:{}", gst.changed, gst.keepalive, gst.unchanged);
+    TxtCameraLatencyStats lst = getLatencyStats();
+    spdlog::get("console")->info("camera latency frames:{} late:{} mean_us:{} max_us:{}", lst.frames, lst.late,
+    		lst.frames ? lst.sum_us / (int64_t)lst.frames : 0, lst.max_us);
+    return ret;
 }
 
 void TxtCamera::run() {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "run");
+	int64_t tsNext_ns = 0; // deadline of the next capture, steady clock
+	bool streaming = true;
     while (!m_stoprequested)
     {
-    	if (doGrab)
-    	{
-            if (!cap.isOpened()) {
-        		spdlog::get("console")->warn("cap.isOpened() == false. Will try to reopen capture.");
-            	if (!init()) {
-                    std::cout << "error init" << std::endl;
-            	}
-            }
+    	if (!doGrab || source->isEnded()) {
+    		//no consumer: no capture and no decode until acquire()
+    		if (streaming) {
+    			spdlog::get("console")->info("camera idle");
+    			source->setStreaming(false);
+    			streaming = false;
+    		}
+    		tsNext_ns = 0;
+    		sem_wait(&m_semWake);
+    		continue;
+    	}
+    	if (!streaming) {
+    		spdlog::get("console")->info("camera resume fps:{}", fps);
+    		source->setStreaming(true);
+    		streaming = true;
+    	}
+    	if (!source->isOpened()) {
+    		spdlog::get("console")->warn("camera source {} not opened. Will try to reopen capture.", source->getName());
+    		if (!init()) {
+    			std::cout << "error init" << std::endl;
+    		}
+    	}
 
 #ifdef CAM_TEST
-    		spdlog::get("console")->info("CAM 0: --- get frame");
-#endif
-    		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock run");
-    		pthread_mutex_lock(&m_mutex);
-#ifdef USE_YUYV
-    		cap >> frame;
-    		cvtColor(frame, frame, cv::COLOR_YUV2BGR_YUYV);
-#else
-    		cap >> frame;
+    	spdlog::get("console")->info("CAM 0: --- get frame");
 #endif
-    		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock run");
+    	//capture into a free buffer of the ring, consumers keep their frames
+    	TxtCameraFrame* f = ring.claim();
+    	if (f) {
+    		f->info.ts_ns = 0;
+    		bool valid = source->read(f);
     		//cv::flip(frame,frame,0);
-    		//bool rg = cap.grab();
-    		//bool rr = cap.retrieve(frame);
-
-    		if (!frame.empty()) {
+    		if (valid) {
+    			//capture time of the driver if the source has it
+    			int64_t now_ns = getnowtimestamp_ns();
+    			int64_t ts_ns = (f->info.ts_ns > 0) ? f->info.ts_ns : now_ns;
+    			f->changed = gate(f, ts_ns);
+    			ring.publish(f, ts_ns);
+    			int64_t lat_us = (now_ns - ts_ns) / 1000;
+    			latencyFrames++;
+    			latencySum_us += lat_us;
+    			if (lat_us > latencyMax_us) latencyMax_us = lat_us; // capture thread only
     			Notify(); // new frame
+    		} else {
+    			ring.abandon(f);
+    		}
+    	} else {
+    		//all buffers referenced: drop the frame, the driver queue stays current
+    		source->grab();
+    	}
+    	if (source->isLive()) {
+    		//deadline pacing: the time of the capture is part of the period, late captures are not caught up
+    		//(a replay source waits in read() for the time of the frame)
+    		int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    				std::chrono::steady_clock::now().time_since_epoch()).count();
+    		int64_t period_ns = (fps > 0.) ? (int64_t)(1e9 / fps) : 67000000;
+    		tsNext_ns = (tsNext_ns == 0) ? now_ns + period_ns : tsNext_ns + period_ns;
+    		if (tsNext_ns > now_ns) {
+    			std::this_thread::sleep_for(std::chrono::nanoseconds(tsNext_ns - now_ns));
+    		} else {
+    			latencyLate++;
+    			tsNext_ns = now_ns;
     		}
-    		pthread_mutex_unlock(&m_mutex);
-
     	}
-		std::this_thread::sleep_for(std::chrono::milliseconds(67));
 	}
-    frame.release();
+    ring.clear();
 }
 
-std::string TxtCamera::getDataString() {
-	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "getDataString");
-	std::string s;
-	pthread_mutex_lock(&m_mutex);
-	if (!frame.empty()) {
-		bool ret = false;
-		try {
+bool TxtCamera::getPixels(const TxtCameraFramePtr& f, cv::Mat& out, int reduce, bool gray) {
+	if (!f) {
+		return false;
+	}
+	try {
+		if (!f->jpg.empty()) {
+			int flags = gray ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+			switch (reduce) {
+			case 2: flags = gray ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2; break;
+			case 4: flags = gray ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4; break;
+			case 8: flags = gray ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8; break;
+			default: break;
+			}
+			out = cv::imdecode(f->jpg, flags);
+		} else if (!f->mat.empty()) {
+			cv::Mat m = f->mat;
+			if (gray) {
+				cv::cvtColor(m, out, cv::COLOR_BGR2GRAY);
+				m = out;
+			}
+			//image pyramid: each level halves the size
+			for (int r = reduce; r > 1; r /= 2) {
+				cv::pyrDown(m, out);
+				m = out;
+			}
+			if ((reduce <= 1) && !gray) {
+				m.copyTo(out);
+			}
+		} else {
+			return false;
+		}
+	} catch (const cv::Exception& exc) {
+		std::cout << "Error: " << exc.what() << std::endl;
+		return false;
+	}
+	return !out.empty();
+}
+
+TxtCameraArtifactPtr TxtCamera::encode(const TxtCameraFramePtr& f, TxtCameraEncoding enc, int q) {
+	//no lock held, the frame is read-only
+	std::string* s = 0;
+	try {
+		switch (enc) {
+		case CAM_ENC_JPEG:
+		{
+			if (f->mat.empty()) {
+				return TxtCameraArtifactPtr();
+			}
 #ifdef CAM_TEST
 			spdlog::get("console")->info("CAM 1: --- imencode jpg");
 #endif
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock getDataString");
-			ret = cv::imencode(".jpg", frame, buf);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock getDataString");
-		} catch (const cv::Exception& exc) {
-			std::cout << "Error: " << exc.what() << std::endl;
-			return "";
+			std::vector<uchar> buf;
+			std::vector<int> params;
+			params.push_back(cv::IMWRITE_JPEG_QUALITY);
+			params.push_back(q);
+			if (!cv::imencode(".jpg", f->mat, buf, params) || buf.empty()) {
+				return TxtCameraArtifactPtr();
+			}
+			s = new std::string((const char*)buf.data(), buf.size());
+			break;
 		}
-		if (!buf.empty()) {
-			if (ret) {
+		case CAM_ENC_BASE64:
+		{
+			const uchar* data = 0;
+			size_t size = 0;
+			TxtCameraArtifactPtr jpg;
+			if (!f->jpg.empty()) {
+				data = f->jpg.ptr();
+				size = f->jpg.total();
+			} else {
+				jpg = getArtifact(f, CAM_ENC_JPEG);
+				if (!jpg) {
+					return TxtCameraArtifactPtr();
+				}
+				data = (const uchar*)jpg->data();
+				size = jpg->size();
+			}
 #ifdef CAM_TEST
-				spdlog::get("console")->info("CAM 2: --- base64_encode");
+			spdlog::get("console")->info("CAM 2: --- base64_encode");
 #endif
-				s = "data:image/jpeg;base64," + base64_encode(buf.data(), buf.size());
+			//prefix and base64 in one allocation of the exact size
+			static const char prefix[] = "data:image/jpeg;base64,";
+			const size_t n = sizeof(prefix) - 1;
+			s = new std::string(n + base64_encoded_size(size), '\0');
+			memcpy(&(*s)[0], prefix, n);
+			base64_encode(data, size, &(*s)[n]);
+			break;
+		}
+		}
+	} catch (const cv::Exception& exc) {
+		std::cout << "Error: " << exc.what() << std::endl;
+		return TxtCameraArtifactPtr();
+	}
+	return TxtCameraArtifactPtr(s);
+}
+
+TxtCameraArtifactPtr TxtCamera::getArtifact(const TxtCameraFramePtr& f, TxtCameraEncoding enc, bool cached) {
+	if (!f) {
+		return TxtCameraArtifactPtr();
+	}
+	//passthrough: the MJPEG buffer is the JPEG, quality of the camera
+	int q = f->jpg.empty() ? quality : 0;
+	pthread_mutex_lock(&m_mutexCache);
+	bool found = true;
+	while (found) {
+		found = false;
+		for (size_t i = 0; i < CAM_CACHE_SIZE; i++) {
+			Artifact_t& a = cache[i];
+			if ((a.seq == f->info.seq) && (a.quality == q) && (a.enc == enc)) {
+				if (a.data) {
+					TxtCameraArtifactPtr data = a.data;
+					cacheHits++;
+					pthread_mutex_unlock(&m_mutexCache);
+					return data;
+				}
+				if (a.encoding && !cached) {
+					//encoded by another thread
+					found = true;
+					pthread_cond_wait(&m_condCache, &m_mutexCache);
+					break;
+				}
 			}
 		}
 	}
-	pthread_mutex_unlock(&m_mutex);
-	return s;
+	if (cached) {
+		pthread_mutex_unlock(&m_mutexCache);
+		return TxtCameraArtifactPtr();
+	}
+	cacheMisses++;
+	//oldest entry that is not being encoded, the entries are filled round robin
+	Artifact_t* a = 0;
+	for (size_t i = 0; (i < CAM_CACHE_SIZE) && !a; i++) {
+		Artifact_t& c = cache[cacheNext];
+		cacheNext = (cacheNext + 1) % CAM_CACHE_SIZE;
+		if (!c.encoding) a = &c;
+	}
+	if (a) {
+		a->seq = f->info.seq;
+		a->quality = q;
+		a->enc = enc;
+		a->data.reset();
+		a->encoding = true;
+	}
+	pthread_mutex_unlock(&m_mutexCache);
+
+	TxtCameraArtifactPtr data = encode(f, enc, q);
+
+	if (a) {
+		//a reserved entry is not reused until encoding is reset
+		pthread_mutex_lock(&m_mutexCache);
+		a->data = data;
+		a->encoding = false;
+		pthread_cond_broadcast(&m_condCache);
+		pthread_mutex_unlock(&m_mutexCache);
+	}
+	return data;
+}
+
+TxtCameraCacheStats TxtCamera::getCacheStats() {
+	TxtCameraCacheStats st;
+	pthread_mutex_lock(&m_mutexCache);
+	st.hits = cacheHits;
+	st.misses = cacheMisses;
+	pthread_mutex_unlock(&m_mutexCache);
+	return st;
+}
+
+bool TxtCamera::gate(const TxtCameraFrame* f, int64_t ts_ns) {
+	if (!changeGate.isEnabled()) {
+		return true;
+	}
+	try {
+		//gray thumbnail, a passthrough frame is decoded at 1/8 size
+		cv::Mat gray;
+		if (!f->jpg.empty()) {
+			gray = cv::imdecode(f->jpg, cv::IMREAD_REDUCED_GRAYSCALE_8);
+		} else {
+			cv::cvtColor(f->mat, gray, cv::COLOR_BGR2GRAY);
+		}
+		if (gray.empty()) {
+			return true;
+		}
+		cv::resize(gray, gateThumb, cv::Size(CAM_GATE_W, CAM_GATE_H), 0, 0, cv::INTER_AREA);
+	} catch (const cv::Exception& exc) {
+		std::cout << "Error: " << exc.what() << std::endl;
+		return true;
+	}
+	bool first = gateRef.empty();
+	uint32_t s = first ? 0 : sad(gateRef.ptr<uint8_t>(), gateThumb.ptr<uint8_t>(), CAM_GATE_W * CAM_GATE_H);
+	bool changed = changeGate.update(first, s, ts_ns);
+	if (changed) {
+		cv::swap(gateRef, gateThumb);
+	}
+	return changed;
+}
+
+TxtCameraLatencyStats TxtCamera::getLatencyStats() {
+	TxtCameraLatencyStats st;
+	st.frames = latencyFrames;
+	st.late = latencyLate;
+	st.sum_us = latencySum_us;
+	st.max_us = latencyMax_us;
+	return st;
+}
+
+std::string TxtCamera::getDataString() {
+	return getDataString(ring.get());
+}
+
+std::string TxtCamera::getDataString(const TxtCameraFramePtr& f) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "getDataString");
+	TxtCameraArtifactPtr s = getArtifact(f, CAM_ENC_BASE64);
+	return s ? *s : std::string();
+}
+
+bool TxtCamera::getJpeg(std::string& data, TxtCameraFrameInfo& info) {
+	return getJpeg(ring.get(), data, info);
+}
+
+bool TxtCamera::getJpeg(const TxtCameraFramePtr& f, std::string& data, TxtCameraFrameInfo& info) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "getJpeg");
+	if (f && !f->jpg.empty()) {
+		info = f->info;
+		data.append((const char*)f->jpg.ptr(), f->jpg.total());
+		return true;
+	}
+	TxtCameraArtifactPtr jpg = getArtifact(f, CAM_ENC_JPEG);
+	if (!jpg) {
+		return false;
+	}
+	info = f->info;
+	data.append(*jpg);
+	return true;
 }
 
 bool TxtCamera::writeFile(const std::string& filename) {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "writeFile filename:{}", filename.c_str());
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock writeFile");
-	pthread_mutex_lock(&m_mutex);
-	bool ret = cv::imwrite(filename, frame);
-	pthread_mutex_unlock(&m_mutex);
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock writeFile");
-	return ret;
+	TxtCameraFramePtr f = snapshot(TIMEOUT_SNAPSHOT_MS);
+	if (!f) {
+		return false;
+	}
+	cv::Mat m;
+	if (!getPixels(f, m)) {
+		return false;
+	}
+	return cv::imwrite(filename, m);
 }
 
 
@@ -0,0 +1,152 @@
+/*
+ * TxtCameraFrameRing.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtCameraFrameRing.h"
+
+#include "spdlog/spdlog.h"
+
+
+namespace ft {
+
+
+TxtCameraFrameRing::TxtCameraFrameRing(size_t size)
+	: slots(new Slot_t[size]), size(size), latest(0), seq(0),
+	  captured(0), dropped(0), skipped(0), m_mutex()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtCameraFrameRing size:{}", size);
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_mutex, &attr);
+	for (size_t i = 0; i < size; i++) {
+		slots[i].frame.info.ts_ns = 0;
+		slots[i].frame.info.seq = 0;
+		slots[i].frame.info.width = 0;
+		slots[i].frame.info.height = 0;
+		slots[i].frame.changed = true;
+		slots[i].refs = 0;
+		slots[i].writing = false;
+		slots[i].read = true;
+	}
+}
+
+TxtCameraFrameRing::~TxtCameraFrameRing()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtCameraFrameRing");
+	pthread_mutex_destroy(&m_mutex);
+}
+
+TxtCameraFrameRing::Slot_t* TxtCameraFrameRing::find(TxtCameraFrame* f)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (&slots[i].frame == f) return &slots[i];
+	}
+	return 0;
+}
+
+TxtCameraFrame* TxtCameraFrameRing::claim()
+{
+	pthread_mutex_lock(&m_mutex);
+	//oldest buffer without handles
+	Slot_t* s = 0;
+	for (size_t i = 0; i < size; i++) {
+		Slot_t* c = &slots[i];
+		if ((c == latest) || c->writing || (c->refs > 0)) continue;
+		if (!s || (c->frame.info.seq < s->frame.info.seq)) s = c;
+	}
+	if (!s) {
+		dropped++;
+		pthread_mutex_unlock(&m_mutex);
+		return 0;
+	}
+	if (!s->read) {
+		skipped++;
+	}
+	s->writing = true;
+	s->read = true;
+	pthread_mutex_unlock(&m_mutex);
+	return &s->frame;
+}
+
+void TxtCameraFrameRing::publish(TxtCameraFrame* f, int64_t ts_ns)
+{
+	pthread_mutex_lock(&m_mutex);
+	Slot_t* s = find(f);
+	if (s) {
+		s->frame.info.ts_ns = ts_ns;
+		s->frame.info.seq = ++seq;
+		if (!s->frame.mat.empty()) {
+			s->frame.info.width = (uint16_t)s->frame.mat.cols;
+			s->frame.info.height = (uint16_t)s->frame.mat.rows;
+		}
+		s->writing = false;
+		s->read = false;
+		latest = s;
+		captured++;
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtCameraFrameRing::abandon(TxtCameraFrame* f)
+{
+	pthread_mutex_lock(&m_mutex);
+	Slot_t* s = find(f);
+	if (s) {
+		s->frame.info.seq = 0;
+		s->writing = false;
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+TxtCameraFramePtr TxtCameraFrameRing::get()
+{
+	pthread_mutex_lock(&m_mutex);
+	Slot_t* s = latest;
+	if (!s) {
+		pthread_mutex_unlock(&m_mutex);
+		return TxtCameraFramePtr();
+	}
+	s->refs++;
+	s->read = true;
+	pthread_mutex_unlock(&m_mutex);
+	//the last handle releases the buffer, the ring is not locked for this
+	return TxtCameraFramePtr(&s->frame, [s](const TxtCameraFrame*) { s->refs--; });
+}
+
+void TxtCameraFrameRing::clear()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "clear");
+	pthread_mutex_lock(&m_mutex);
+	latest = 0;
+	for (size_t i = 0; i < size; i++) {
+		if (!slots[i].writing && (slots[i].refs == 0)) {
+			slots[i].frame.mat.release();
+			slots[i].frame.jpg.release();
+			slots[i].frame.info.seq = 0;
+			slots[i].read = true;
+		}
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+TxtCameraFrameRingStats TxtCameraFrameRing::getStats()
+{
+	TxtCameraFrameRingStats st;
+	pthread_mutex_lock(&m_mutex);
+	st.captured = captured;
+	st.dropped = dropped;
+	st.skipped = skipped;
+	st.referenced = 0;
+	for (size_t i = 0; i < size; i++) {
+		if (slots[i].refs > 0) st.referenced++;
+	}
+	st.seq = seq;
+	pthread_mutex_unlock(&m_mutex);
+	return st;
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,63 @@
+/*
+ * TxtCameraGate.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtCameraGate.h"
+
+#include <math.h>
+
+
+namespace ft {
+
+
+//single writer: a load and a store instead of a locked increment
+static inline void increment(std::atomic<uint64_t>& c)
+{
+	c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
+TxtCameraGate::TxtCameraGate(double thresh, double keepalive_s)
+	: threshSad(0), keepalive_ns(0), tsLast_ns(0), changed(0), keepalives(0), unchanged(0)
+{
+	set(thresh, keepalive_s);
+}
+
+void TxtCameraGate::set(double thresh, double keepalive_s)
+{
+	//sad >= thresh * pixels, sad is an integer
+	threshSad.store((thresh > 0.) ? (uint32_t)ceil(thresh * CAM_GATE_W * CAM_GATE_H) : 0, std::memory_order_relaxed);
+	keepalive_ns.store((int64_t)(keepalive_s * 1e9), std::memory_order_relaxed);
+}
+
+TxtCameraGateStats TxtCameraGate::getStats() const
+{
+	TxtCameraGateStats st;
+	st.changed = changed.load(std::memory_order_relaxed);
+	st.keepalive = keepalives.load(std::memory_order_relaxed);
+	st.unchanged = unchanged.load(std::memory_order_relaxed);
+	return st;
+}
+
+bool TxtCameraGate::update(bool first, uint32_t sad, int64_t ts_ns)
+{
+	uint32_t th = threshSad.load(std::memory_order_relaxed);
+	bool c = first || (th == 0) || (sad >= th);
+	if (c) {
+		increment(changed);
+	} else if ((ts_ns - tsLast_ns) >= keepalive_ns.load(std::memory_order_relaxed)) {
+		increment(keepalives);
+		c = true;
+	} else {
+		increment(unchanged);
+	}
+	if (c) {
+		tsLast_ns = ts_ns;
+	}
+	return c;
+}
+
+
+} /* namespace ft */
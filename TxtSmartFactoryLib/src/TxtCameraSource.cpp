@@ -0,0 +1,612 @@
+/*
+ * TxtCameraSource.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtCameraSource.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <chrono>
+
+#include "spdlog/spdlog.h"
+
+//#define USE_YUYV
+
+
+namespace ft {
+
+
+TxtCameraSource* TxtCameraSource::create(const std::string& uri, double speed, bool loop, int buffers)
+{
+	const std::string dev = "/dev/video";
+	const std::string v4l2 = CAM_SOURCE_V4L2;
+	if (uri.empty()) {
+		return new TxtCameraDeviceSource(0);
+	}
+	if (uri.compare(0, v4l2.size(), v4l2) == 0) {
+		std::string device = uri.substr(v4l2.size());
+		spdlog::get("console")->info("camera source: V4L2 device {} buffers:{}", device, buffers);
+		return new TxtCameraV4l2Source(device.empty() ? dev + "0" : device, buffers);
+	}
+	if (uri.compare(0, dev.size(), dev) == 0) {
+		return new TxtCameraDeviceSource(atoi(uri.c_str() + dev.size()));
+	}
+	struct stat st;
+	if ((stat(uri.c_str(), &st) == 0) && S_ISDIR(st.st_mode)) {
+		spdlog::get("console")->info("camera source: JPEG directory {} speed:{} loop:{}", uri, speed, loop);
+		return new TxtCameraDirSource(uri, speed, loop);
+	}
+	spdlog::get("console")->info("camera source: video file {} speed:{} loop:{}", uri, speed, loop);
+	return new TxtCameraFileSource(uri, speed, loop);
+}
+
+
+bool TxtCameraDeviceSource::open(double w, double h, bool pt, double fps)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "open index:{}", index);
+	passthrough = pt;
+	bool ret = cap.open(index);
+	if (!ret) {
+        std::cout << "error cap.open(" << index << ")" << std::endl;
+	}
+#ifndef USE_YUYV
+    bool r = cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'));
+    if (!r) {
+        std::cout << "error cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'))" << std::endl;
+    	return false;
+    }
+#else
+    bool r = cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y','U','Y','V'));
+    if (!r) {
+        std::cout << "error cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y','U','Y','V'))" << std::endl;
+    	return false;
+    }
+#endif
+    //cap.set(cv::CAP_PROP_FPS, 15);
+    //cap.set(cv::CAP_PROP_AUTO_EXPOSURE, 3);
+    r = cap.set(cv::CAP_PROP_FRAME_WIDTH, w);//640);
+    if (!r) {
+        std::cout << "error cap.set(cv::CAP_PROP_FRAME_WIDTH, w)" << std::endl;
+    	return false;
+    }
+    r = cap.set(cv::CAP_PROP_FRAME_HEIGHT, h);//480);
+    if (!r) {
+        std::cout << "error cap.set(cv::CAP_PROP_FRAME_HEIGHT, h)" << std::endl;
+    	return false;
+    }
+#ifndef USE_YUYV
+    if (passthrough) {
+        r = cap.set(cv::CAP_PROP_CONVERT_RGB, 0);
+        if (!r) {
+            std::cout << "error cap.set(cv::CAP_PROP_CONVERT_RGB, 0): MJPEG passthrough off" << std::endl;
+            passthrough = false;
+        }
+    }
+#else
+    passthrough = false;
+#endif
+    frameW = (uint16_t)cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_WIDTH);
+    frameH = (uint16_t)cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_HEIGHT);
+    std::cout << "init frame " << cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_WIDTH);
+    std::cout << "x" << cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_HEIGHT);
+    std::cout << " Format: " << cap.get(cv::VideoCaptureProperties::CAP_PROP_FORMAT);
+    std::cout << " passthrough: " << passthrough << std::endl;
+    return cap.isOpened();
+}
+
+bool TxtCameraDeviceSource::read(TxtCameraFrame* f)
+{
+#ifdef USE_YUYV
+	cap >> yuyv;
+	if (yuyv.empty()) {
+		return false;
+	}
+	cv::cvtColor(yuyv, f->mat, cv::COLOR_YUV2BGR_YUYV);
+	f->jpg.release();
+	return true;
+#else
+	if (passthrough) {
+		cap >> f->jpg;
+		if ((f->jpg.rows == 1) && (f->jpg.type() == CV_8UC1)) {
+			f->mat.release();
+			f->info.width = frameW;
+			f->info.height = frameH;
+			return true;
+		} else if (!f->jpg.empty()) {
+			//the capture backend ignores CAP_PROP_CONVERT_RGB
+			spdlog::get("console")->warn("camera frames are decoded by the driver: MJPEG passthrough off");
+			passthrough = false;
+			f->mat = f->jpg;
+			f->jpg.release();
+			return true;
+		}
+		return false;
+	}
+	cap >> f->mat;
+	f->jpg.release();
+	return !f->mat.empty();
+#endif
+}
+
+
+static int xioctl(int fd, unsigned long request, void* arg)
+{
+	int r;
+	do {
+		r = ioctl(fd, request, arg);
+	} while ((r == -1) && (errno == EINTR));
+	return r;
+}
+
+TxtCameraV4l2Source::TxtCameraV4l2Source(const std::string& device, int buffers)
+	: device(device), buffers(buffers), fd(-1), streaming(false), bufs(), pixfmt(0), stride(0), passthrough(false),
+	  frameW(0), frameH(0), bytesused(0), tsDriver_ns(0), frames(0), stale(0)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtCameraV4l2Source device:{} buffers:{}", device, buffers);
+}
+
+TxtCameraV4l2Source::~TxtCameraV4l2Source()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtCameraV4l2Source");
+	close();
+}
+
+void TxtCameraV4l2Source::close()
+{
+	if (fd < 0) {
+		return;
+	}
+	spdlog::get("console")->info("v4l2 {} frames:{} stale:{}", device, frames, stale);
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	xioctl(fd, VIDIOC_STREAMOFF, &type);
+	for (size_t i = 0; i < bufs.size(); i++) {
+		munmap(bufs[i].start, bufs[i].length);
+	}
+	bufs.clear();
+	struct v4l2_requestbuffers req;
+	memset(&req, 0, sizeof(req));
+	req.count = 0;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	xioctl(fd, VIDIOC_REQBUFS, &req);
+	::close(fd);
+	fd = -1;
+	streaming = false;
+}
+
+void TxtCameraV4l2Source::setStreaming(bool on)
+{
+	if ((fd < 0) || (on == streaming)) {
+		return;
+	}
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (!on) {
+		//the driver returns all buffers
+		if (xioctl(fd, VIDIOC_STREAMOFF, &type) < 0) {
+			std::cout << "Error: VIDIOC_STREAMOFF " << device << ": " << strerror(errno) << std::endl;
+		}
+		streaming = false;
+		return;
+	}
+	for (size_t i = 0; i < bufs.size(); i++) {
+		queue((int)i);
+	}
+	if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+		std::cout << "Error: VIDIOC_STREAMON " << device << ": " << strerror(errno) << std::endl;
+		close();
+		return;
+	}
+	streaming = true;
+}
+
+bool TxtCameraV4l2Source::open(double w, double h, bool pt, double fps)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "open device:{}", device);
+	close();
+	fd = ::open(device.c_str(), O_RDWR | O_NONBLOCK);
+	if (fd < 0) {
+		std::cout << "Error: open " << device << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	struct v4l2_capability cap;
+	memset(&cap, 0, sizeof(cap));
+	if (xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0) {
+		std::cout << "Error: VIDIOC_QUERYCAP " << device << ": " << strerror(errno) << std::endl;
+		close();
+		return false;
+	}
+	uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+	if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+		std::cout << "Error: " << device << " is no streaming capture device" << std::endl;
+		close();
+		return false;
+	}
+
+	//MJPEG, YUYV if the camera does not compress
+	struct v4l2_format fmt;
+	const uint32_t formats[] = { V4L2_PIX_FMT_MJPEG, V4L2_PIX_FMT_YUYV };
+	pixfmt = 0;
+	for (size_t i = 0; (i < 2) && !pixfmt; i++) {
+		memset(&fmt, 0, sizeof(fmt));
+		fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		fmt.fmt.pix.width = (uint32_t)w;
+		fmt.fmt.pix.height = (uint32_t)h;
+		fmt.fmt.pix.pixelformat = formats[i];
+		fmt.fmt.pix.field = V4L2_FIELD_ANY;
+		if ((xioctl(fd, VIDIOC_S_FMT, &fmt) == 0) && (fmt.fmt.pix.pixelformat == formats[i])) {
+			pixfmt = formats[i];
+		}
+	}
+	if (!pixfmt) {
+		std::cout << "Error: " << device << " supports neither MJPEG nor YUYV" << std::endl;
+		close();
+		return false;
+	}
+	frameW = (uint16_t)fmt.fmt.pix.width;
+	frameH = (uint16_t)fmt.fmt.pix.height;
+	stride = fmt.fmt.pix.bytesperline;
+	passthrough = pt && (pixfmt == V4L2_PIX_FMT_MJPEG);
+
+	//frame rate of the driver, the camera paces the reads
+	if (fps > 0.) {
+		struct v4l2_streamparm parm;
+		memset(&parm, 0, sizeof(parm));
+		parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		parm.parm.capture.timeperframe.numerator = 1000;
+		parm.parm.capture.timeperframe.denominator = (uint32_t)(fps * 1000.);
+		if (xioctl(fd, VIDIOC_S_PARM, &parm) < 0) {
+			spdlog::get("console")->warn("VIDIOC_S_PARM {}: {}", device, strerror(errno));
+		}
+	}
+
+	struct v4l2_requestbuffers req;
+	memset(&req, 0, sizeof(req));
+	req.count = (uint32_t)buffers;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	if ((xioctl(fd, VIDIOC_REQBUFS, &req) < 0) || (req.count < 2)) {
+		std::cout << "Error: VIDIOC_REQBUFS " << device << ": " << strerror(errno) << std::endl;
+		close();
+		return false;
+	}
+	for (uint32_t i = 0; i < req.count; i++) {
+		struct v4l2_buffer b;
+		memset(&b, 0, sizeof(b));
+		b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		b.memory = V4L2_MEMORY_MMAP;
+		b.index = i;
+		if (xioctl(fd, VIDIOC_QUERYBUF, &b) < 0) {
+			std::cout << "Error: VIDIOC_QUERYBUF " << device << ": " << strerror(errno) << std::endl;
+			close();
+			return false;
+		}
+		Buffer_t buf;
+		buf.length = b.length;
+		buf.start = mmap(NULL, b.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, b.m.offset);
+		if (buf.start == MAP_FAILED) {
+			std::cout << "Error: mmap " << device << ": " << strerror(errno) << std::endl;
+			close();
+			return false;
+		}
+		bufs.push_back(buf);
+		if (!queue(i)) {
+			close();
+			return false;
+		}
+	}
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+		std::cout << "Error: VIDIOC_STREAMON " << device << ": " << strerror(errno) << std::endl;
+		close();
+		return false;
+	}
+	streaming = true;
+	frames = 0;
+	stale = 0;
+	std::cout << "init v4l2 " << device << " " << frameW << "x" << frameH
+		<< " format: " << ((pixfmt == V4L2_PIX_FMT_MJPEG) ? "MJPEG" : "YUYV")
+		<< " buffers: " << bufs.size() << " passthrough: " << passthrough << std::endl;
+	return true;
+}
+
+bool TxtCameraV4l2Source::queue(int index)
+{
+	struct v4l2_buffer b;
+	memset(&b, 0, sizeof(b));
+	b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	b.memory = V4L2_MEMORY_MMAP;
+	b.index = (uint32_t)index;
+	if (xioctl(fd, VIDIOC_QBUF, &b) < 0) {
+		std::cout << "Error: VIDIOC_QBUF " << device << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int TxtCameraV4l2Source::dequeue(bool wait)
+{
+	if (fd < 0) {
+		return -1;
+	}
+	if (wait) {
+		struct pollfd p;
+		p.fd = fd;
+		p.events = POLLIN;
+		p.revents = 0;
+		int r = poll(&p, 1, CAM_V4L2_TIMEOUT_MS);
+		if (r == 0) {
+			spdlog::get("console")->warn("v4l2 {}: no frame for {} ms", device, CAM_V4L2_TIMEOUT_MS);
+			return -1;
+		} else if (r < 0) {
+			if (errno != EINTR) {
+				std::cout << "Error: poll " << device << ": " << strerror(errno) << std::endl;
+			}
+			return -1;
+		}
+	}
+	//all filled buffers, the newest is used
+	int index = -1;
+	for (;;) {
+		struct v4l2_buffer b;
+		memset(&b, 0, sizeof(b));
+		b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		b.memory = V4L2_MEMORY_MMAP;
+		if (xioctl(fd, VIDIOC_DQBUF, &b) < 0) {
+			if (errno != EAGAIN) {
+				std::cout << "Error: VIDIOC_DQBUF " << device << ": " << strerror(errno) << std::endl;
+				if (errno == ENODEV) {
+					//unplugged, the camera opens the device again
+					if (index >= 0) queue(index);
+					close();
+					return -1;
+				}
+			}
+			break;
+		}
+		frames++;
+		if (b.flags & V4L2_BUF_FLAG_ERROR) {
+			//the good buffer held so far stays the newest frame
+			queue(b.index);
+			continue;
+		}
+		if (index >= 0) {
+			queue(index);
+			stale++;
+		}
+		index = (int)b.index;
+		bytesused = b.bytesused;
+		tsDriver_ns = 0;
+		if ((b.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+			//driver time is CLOCK_MONOTONIC, the frames carry CLOCK_REALTIME
+			struct timespec mono, real;
+			clock_gettime(CLOCK_MONOTONIC, &mono);
+			clock_gettime(CLOCK_REALTIME, &real);
+			int64_t age_ns = ((int64_t)mono.tv_sec * 1000000000LL + mono.tv_nsec)
+					- ((int64_t)b.timestamp.tv_sec * 1000000000LL + (int64_t)b.timestamp.tv_usec * 1000);
+			tsDriver_ns = (int64_t)real.tv_sec * 1000000000LL + real.tv_nsec - age_ns;
+		}
+	}
+	return index;
+}
+
+bool TxtCameraV4l2Source::read(TxtCameraFrame* f)
+{
+	int index = dequeue(true);
+	if (index < 0) {
+		return false;
+	}
+	bool ok = false;
+	try {
+		if (pixfmt == V4L2_PIX_FMT_MJPEG) {
+			cv::Mat raw(1, (int)bytesused, CV_8UC1, bufs[index].start);
+			if (passthrough) {
+				raw.copyTo(f->jpg);
+				f->mat.release();
+				f->info.width = frameW;
+				f->info.height = frameH;
+				ok = true;
+			} else {
+				f->mat = cv::imdecode(raw, cv::IMREAD_COLOR);
+				f->jpg.release();
+				ok = !f->mat.empty();
+			}
+		} else {
+			cv::Mat yuyv(frameH, frameW, CV_8UC2, bufs[index].start, stride);
+			cv::cvtColor(yuyv, f->mat, cv::COLOR_YUV2BGR_YUYV);
+			f->jpg.release();
+			ok = true;
+		}
+	} catch (const cv::Exception& exc) {
+		std::cout << "Error: " << exc.what() << std::endl;
+	}
+	f->info.ts_ns = tsDriver_ns;
+	queue(index);
+	return ok;
+}
+
+void TxtCameraV4l2Source::grab()
+{
+	int index = dequeue(false);
+	if (index >= 0) {
+		queue(index);
+	}
+}
+
+
+void TxtCameraReplaySource::pace()
+{
+	frames++;
+	if ((speed <= 0.) || (period_ns <= 0)) {
+		return;
+	}
+	int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	int64_t step = (int64_t)(period_ns / speed);
+	if ((tsNext_ns == 0) || (now - tsNext_ns > step)) {
+		//first frame or the capture was stopped: no burst to catch up
+		tsNext_ns = now;
+	} else if (tsNext_ns > now) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(tsNext_ns - now));
+	}
+	tsNext_ns += step;
+}
+
+
+bool TxtCameraFileSource::open(double w, double h, bool passthrough, double fps)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "open filename:{}", filename);
+	if (!cap.open(filename)) {
+		std::cout << "Error: cannot open video file " << filename << std::endl;
+		return false;
+	}
+	double ffps = cap.get(cv::CAP_PROP_FPS);
+	if (ffps <= 0.) {
+		ffps = fps;
+	}
+	period_ns = (ffps > 0.) ? (int64_t)(1e9 / ffps) : 0;
+	ended = false;
+	std::cout << "init video file " << filename << " " << cap.get(cv::CAP_PROP_FRAME_WIDTH)
+		<< "x" << cap.get(cv::CAP_PROP_FRAME_HEIGHT) << " fps: " << ffps
+		<< " frames: " << cap.get(cv::CAP_PROP_FRAME_COUNT) << std::endl;
+	return true;
+}
+
+bool TxtCameraFileSource::read(TxtCameraFrame* f)
+{
+	if (ended) {
+		return false;
+	}
+	pace();
+	f->jpg.release();
+	cap >> f->mat;
+	if (f->mat.empty() && loop) {
+		cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+		cap >> f->mat;
+	}
+	if (f->mat.empty()) {
+		spdlog::get("console")->info("camera source {} ended after {} frames", filename, frames - 1);
+		ended = true;
+		return false;
+	}
+	return true;
+}
+
+void TxtCameraFileSource::grab()
+{
+	pace();
+	if (!cap.grab() && loop) {
+		cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+	}
+}
+
+
+bool TxtCameraDirSource::open(double w, double h, bool pt, double fps)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "open dir:{}", dir);
+	files.clear();
+	std::vector<cv::String> jpeg;
+	try {
+		cv::glob(dir + "/*.jpg", files, false);
+		cv::glob(dir + "/*.jpeg", jpeg, false);
+	} catch (const cv::Exception& exc) {
+		std::cout << "Error: " << exc.what() << std::endl;
+	}
+	files.insert(files.end(), jpeg.begin(), jpeg.end());
+	std::sort(files.begin(), files.end());
+	if (files.empty()) {
+		std::cout << "Error: no JPEG files in " << dir << std::endl;
+		return false;
+	}
+	cv::Mat first = cv::imread(files[0], cv::IMREAD_COLOR);
+	if (first.empty()) {
+		std::cout << "Error: cannot read " << files[0] << std::endl;
+		files.clear();
+		return false;
+	}
+	frameW = (uint16_t)first.cols;
+	frameH = (uint16_t)first.rows;
+	passthrough = pt;
+	period_ns = (fps > 0.) ? (int64_t)(1e9 / fps) : 0;
+	next = 0;
+	ended = false;
+	std::cout << "init JPEG directory " << dir << " " << frameW << "x" << frameH
+		<< " files: " << files.size() << " passthrough: " << passthrough << std::endl;
+	return true;
+}
+
+bool TxtCameraDirSource::advance()
+{
+	if (ended) {
+		return false;
+	}
+	if (next >= files.size()) {
+		if (!loop) {
+			spdlog::get("console")->info("camera source {} ended after {} frames", dir, frames - 1);
+			ended = true;
+			return false;
+		}
+		next = 0;
+	}
+	return true;
+}
+
+bool TxtCameraDirSource::read(TxtCameraFrame* f)
+{
+	pace();
+	if (!advance()) {
+		return false;
+	}
+	const cv::String& file = files[next++];
+	if (passthrough) {
+		//the file is the JPEG
+		std::ifstream ifs(file.c_str(), std::ios::binary | std::ios::ate);
+		std::streamoff n = ifs.tellg();
+		if (!ifs || (n <= 0)) {
+			std::cout << "Error: cannot read " << file << std::endl;
+			return false;
+		}
+		ifs.seekg(0);
+		f->jpg.create(1, (int)n, CV_8UC1);
+		ifs.read((char*)f->jpg.data, n);
+		if (!ifs) {
+			std::cout << "Error: cannot read " << file << std::endl;
+			return false;
+		}
+		f->mat.release();
+		f->info.width = frameW;
+		f->info.height = frameH;
+		return true;
+	}
+	f->mat = cv::imread(file, cv::IMREAD_COLOR);
+	f->jpg.release();
+	if (f->mat.empty()) {
+		std::cout << "Error: cannot read " << file << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void TxtCameraDirSource::grab()
+{
+	pace();
+	if (advance()) {
+		next++;
+	}
+}
+
+
+} /* namespace ft */
@@ -402,6 +402,7 @@ void TxtHighBayWarehouse::run()
 
 	assert(mqttclient);
 	mqttclient->publishHBW_Ack(HBW_EXIT, 0, TIMEOUT_MS_PUBLISH);
+	mqttclient->flush(TIMEOUT_MS_PUBLISH);
 }
 
 
@@ -0,0 +1,204 @@
+/*
+ * TxtImageKernels.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtImageKernels.h"
+
+#include <vector>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#endif
+
+
+namespace ft {
+
+
+void boxBlur(const cv::Mat& src, cv::Mat& dst, int r)
+{
+	CV_Assert((src.type() == CV_8UC1) && (r >= 0) && (r < 64));
+	const int w = src.cols;
+	const int h = src.rows;
+	const int k = 2*r + 1;
+	//sum/k as (sum*mul + 0.5) >> 16, the sum of a window is at most 255*k
+	const uint32_t mul = ((1u << 16) + k/2) / k;
+	std::vector<uint8_t> tmp((size_t)w * h);
+
+	//horizontal pass, running sum of the window
+	for (int y = 0; y < h; y++) {
+		const uint8_t* s = src.ptr<uint8_t>(y);
+		uint8_t* t = &tmp[(size_t)y * w];
+		uint32_t sum = s[0] * (r + 1);
+		for (int i = 1; i <= r; i++) {
+			sum += s[std::min(i, w - 1)];
+		}
+		for (int x = 0; x < w; x++) {
+			t[x] = (uint8_t)((sum * mul + 0x8000) >> 16);
+			sum += s[std::min(x + r + 1, w - 1)];
+			sum -= s[std::max(x - r, 0)];
+		}
+	}
+
+	//vertical pass, running sums of all columns
+	dst.create(h, w, CV_8UC1);
+	std::vector<uint32_t> sum(w);
+	for (int x = 0; x < w; x++) {
+		sum[x] = tmp[x] * (r + 1);
+	}
+	for (int i = 1; i <= r; i++) {
+		const uint8_t* t = &tmp[(size_t)std::min(i, h - 1) * w];
+		for (int x = 0; x < w; x++) sum[x] += t[x];
+	}
+	for (int y = 0; y < h; y++) {
+		uint8_t* d = dst.ptr<uint8_t>(y);
+		const uint8_t* tin = &tmp[(size_t)std::min(y + r + 1, h - 1) * w];
+		const uint8_t* tout = &tmp[(size_t)std::max(y - r, 0) * w];
+		for (int x = 0; x < w; x++) {
+			d[x] = (uint8_t)((sum[x] * mul + 0x8000) >> 16);
+			sum[x] += tin[x];
+			sum[x] -= tout[x];
+		}
+	}
+}
+
+uint32_t sad(const uint8_t* a, const uint8_t* b, size_t n)
+{
+	uint32_t sum = 0;
+	size_t i = 0;
+#ifdef USE_NEON
+	uint32x4_t total = vdupq_n_u32(0);
+	while (i + 16 <= n) {
+		//16 bit lanes hold 128 blocks of 2*255
+		size_t blocks = std::min((n - i) / 16, (size_t)128);
+		uint16x8_t acc = vdupq_n_u16(0);
+		for (size_t j = 0; j < blocks; j++, i += 16) {
+			acc = vpadalq_u8(acc, vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+		}
+		total = vpadalq_u16(total, acc);
+	}
+	sum = vgetq_lane_u32(total, 0) + vgetq_lane_u32(total, 1)
+			+ vgetq_lane_u32(total, 2) + vgetq_lane_u32(total, 3);
+#endif
+	for (; i < n; i++) {
+		sum += (a[i] > b[i]) ? (a[i] - b[i]) : (b[i] - a[i]);
+	}
+	return sum;
+}
+
+#ifdef USE_NEON
+//x/256 rounded toward zero like the C division of the scalar version
+static inline int32x4_t div256(int32x4_t x)
+{
+	return vshrq_n_s32(vaddq_s32(x, vandq_s32(vshrq_n_s32(x, 31), vdupq_n_s32(255))), 8);
+}
+
+//b + (d*alpha)/256 of 4 lanes
+static inline uint16x4_t blend(uint16x4_t b, int32x4_t d, int32_t alpha)
+{
+	int32x4_t r = vaddq_s32(vreinterpretq_s32_u32(vmovl_u16(b)), div256(vmulq_n_s32(d, alpha)));
+	return vmovn_u32(vreinterpretq_u32_s32(r));
+}
+
+static inline int32x4_t sub32(uint16x4_t a, uint16x4_t b)
+{
+	return vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(a)), vreinterpretq_s32_u32(vmovl_u16(b)));
+}
+#endif
+
+uint32_t backgroundDiff(const uint8_t* g, uint16_t* bg, uint16_t* var, uint8_t* mask, size_t n,
+		uint8_t thresh, uint16_t alpha, uint8_t k)
+{
+	uint32_t count = 0;
+	const uint32_t k2 = (uint32_t)k * k;
+	size_t i = 0;
+#ifdef USE_NEON
+	const uint8x8_t t = vdup_n_u8(thresh);
+	const uint16x4_t k2v = vdup_n_u16((uint16_t)k2);
+	uint32x4_t total = vdupq_n_u32(0);
+	while (i + 8 <= n) {
+		//16 bit lane counters, drained before they overflow
+		size_t blocks = std::min((n - i) / 8, (size_t)4096);
+		uint16x8_t cnt = vdupq_n_u16(0);
+		for (size_t j = 0; j < blocks; j++, i += 8) {
+			uint16x8_t g16 = vshll_n_u8(vld1_u8(g + i), 8);
+			uint16x8_t b16 = vld1q_u16(bg + i);
+			uint8x8_t ad = vshrn_n_u16(vabdq_u16(g16, b16), 8);
+			uint8x8_t fg = vcgt_u8(ad, t);
+			if (var) {
+				//ad*ad fits 16 bit, k2*var needs 32 bit
+				uint16x8_t d2 = vmull_u8(ad, ad);
+				uint16x8_t v16 = vld1q_u16(var + i);
+				uint32x4_t lo = vcgtq_u32(vmovl_u16(vget_low_u16(d2)), vmull_u16(vget_low_u16(v16), k2v));
+				uint32x4_t hi = vcgtq_u32(vmovl_u16(vget_high_u16(d2)), vmull_u16(vget_high_u16(v16), k2v));
+				fg = vand_u8(fg, vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi))));
+				vst1q_u16(var + i, vcombine_u16(
+						blend(vget_low_u16(v16), sub32(vget_low_u16(d2), vget_low_u16(v16)), alpha),
+						blend(vget_high_u16(v16), sub32(vget_high_u16(d2), vget_high_u16(v16)), alpha)));
+			}
+			vst1q_u16(bg + i, vcombine_u16(
+					blend(vget_low_u16(b16), sub32(vget_low_u16(g16), vget_low_u16(b16)), alpha),
+					blend(vget_high_u16(b16), sub32(vget_high_u16(g16), vget_high_u16(b16)), alpha)));
+			vst1_u8(mask + i, fg);
+			cnt = vaddw_u8(cnt, vshr_n_u8(fg, 7));
+		}
+		total = vpadalq_u16(total, cnt);
+	}
+	count = vgetq_lane_u32(total, 0) + vgetq_lane_u32(total, 1)
+			+ vgetq_lane_u32(total, 2) + vgetq_lane_u32(total, 3);
+#endif
+	for (; i < n; i++) {
+		int32_t b = bg[i];
+		int32_t d = ((int32_t)g[i] << 8) - b;
+		uint32_t ad = (uint32_t)(d < 0 ? -d : d) >> 8;
+		bool fg = ad > thresh;
+		if (var) {
+			uint32_t d2 = std::min(ad * ad, (uint32_t)0xffff);
+			int32_t v = var[i];
+			fg = fg && (d2 > k2 * (uint32_t)v);
+			var[i] = (uint16_t)(v + (((int32_t)d2 - v) * alpha) / 256);
+		}
+		bg[i] = (uint16_t)(b + (d * alpha) / 256);
+		mask[i] = fg ? 255 : 0;
+		count += fg;
+	}
+	return count;
+}
+
+
+cv::Rect maskBounds(const cv::Mat& mask)
+{
+	CV_Assert(mask.type() == CV_8UC1);
+	const int w = mask.cols;
+	int x0 = w, x1 = -1, y0 = -1, y1 = -1;
+	for (int y = 0; y < mask.rows; y++) {
+		const uint8_t* m = mask.ptr<uint8_t>(y);
+		//the columns left and right of the box found so far, the box only for the rows
+		int x = 0;
+		while ((x < x0) && !m[x]) x++;
+		bool set = (x < x0);
+		if (set) x0 = x;
+		if (x0 == w) continue;
+		x = w - 1;
+		while ((x > x1) && !m[x]) x--;
+		if (x > x1) {
+			x1 = x;
+			set = true;
+		}
+		if (!set) {
+			x = x0;
+			while ((x <= x1) && !m[x]) x++;
+			if (x > x1) continue;
+		}
+		if (y0 < 0) y0 = y;
+		y1 = y;
+	}
+	if (y0 < 0) return cv::Rect();
+	return cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,448 @@
+/*
+ * TxtJsonReader.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtJsonReader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+
+#define JSON_READER_MAX_DEPTH 32
+
+
+namespace ft {
+
+
+static void appendUtf8(std::string& out, unsigned int cp)
+{
+	if (cp < 0x80) {
+		out += (char)cp;
+	} else if (cp < 0x800) {
+		out += (char)(0xC0 | (cp >> 6));
+		out += (char)(0x80 | (cp & 0x3F));
+	} else if (cp < 0x10000) {
+		out += (char)(0xE0 | (cp >> 12));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	} else {
+		out += (char)(0xF0 | (cp >> 18));
+		out += (char)(0x80 | ((cp >> 12) & 0x3F));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+}
+
+static int hexValue(char c)
+{
+	if ((c >= '0') && (c <= '9')) return c - '0';
+	if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+	if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+	return -1;
+}
+
+static unsigned int readHex4(const char* s)
+{
+	unsigned int cp = 0;
+	for (int i = 0; i < 4; i++) {
+		cp = (cp << 4) | (unsigned int)hexValue(s[i]);
+	}
+	return cp;
+}
+
+
+TxtJsonReader::TxtJsonReader(const char* data, size_t size)
+	: p(data), end(data + size), begin(data), error(false), errorOffset(0), depth(0), first(false)
+{}
+
+bool TxtJsonReader::fail()
+{
+	if (!error) {
+		error = true;
+		errorOffset = p - begin;
+	}
+	return false;
+}
+
+void TxtJsonReader::skipWs()
+{
+	while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r'))) {
+		p++;
+	}
+}
+
+bool TxtJsonReader::expect(char c)
+{
+	skipWs();
+	if ((p < end) && (*p == c)) {
+		p++;
+		return true;
+	}
+	return fail();
+}
+
+bool TxtJsonReader::isObject()
+{
+	skipWs();
+	return !error && (p < end) && (*p == '{');
+}
+
+bool TxtJsonReader::beginObject()
+{
+	if (error) return false;
+	if (depth >= JSON_READER_MAX_DEPTH) return fail();
+	if (!expect('{')) return false;
+	depth++;
+	first = true;
+	return true;
+}
+
+bool TxtJsonReader::nextMember(const char*& key, size_t& len)
+{
+	if (error || (depth == 0)) return false;
+	skipWs();
+	if ((p < end) && (*p == '}')) {
+		p++;
+		depth--;
+		first = false; // the enclosing object has at least this member
+		return false;
+	}
+	if (!first && !expect(',')) return false;
+	first = false;
+	skipWs();
+	bool escaped;
+	if (!scanString(key, len, escaped)) return false;
+	//keys of the mqtt payloads are plain ascii, an escaped key never matches
+	if (escaped) len = 0;
+	return expect(':');
+}
+
+bool TxtJsonReader::scanString(const char*& s, size_t& len, bool& escaped)
+{
+	if ((p >= end) || (*p != '"')) return fail();
+	p++;
+	s = p;
+	escaped = false;
+	while (p < end) {
+		char c = *p;
+		if (c == '"') {
+			len = p - s;
+			p++;
+			return true;
+		}
+		if (c == '\\') {
+			escaped = true;
+			p++;
+			if (p >= end) break;
+			if (*p == 'u') {
+				if ((end - p < 5) || (hexValue(p[1]) < 0) || (hexValue(p[2]) < 0)
+						|| (hexValue(p[3]) < 0) || (hexValue(p[4]) < 0)) {
+					return fail();
+				}
+				p += 4;
+			} else if (!strchr("\"\\/bfnrt", *p)) {
+				return fail();
+			}
+		}
+		p++;
+	}
+	return fail();
+}
+
+void TxtJsonReader::unescape(const char* s, size_t len, std::string& out)
+{
+	const char* e = s + len;
+	out.clear();
+	out.reserve(len);
+	while (s < e) {
+		const char* q = (const char*)memchr(s, '\\', e - s);
+		if (!q) {
+			out.append(s, e - s);
+			break;
+		}
+		out.append(s, q - s);
+		s = q + 1;
+		switch (*s++) {
+		case '"': out += '"'; break;
+		case '\\': out += '\\'; break;
+		case '/': out += '/'; break;
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u':
+		{
+			unsigned int cp = readHex4(s);
+			s += 4;
+			if ((cp >= 0xD800) && (cp <= 0xDBFF) && (e - s >= 6) && (s[0] == '\\') && (s[1] == 'u')) {
+				unsigned int lo = readHex4(s + 2);
+				if ((lo >= 0xDC00) && (lo <= 0xDFFF)) {
+					cp = 0x10000 + ((cp & 0x3FF) << 10) + (lo & 0x3FF);
+					s += 6;
+				}
+			}
+			appendUtf8(out, cp);
+			break;
+		}
+		}
+	}
+}
+
+bool TxtJsonReader::scanNumber(const char*& s, size_t& len)
+{
+	s = p;
+	if ((p < end) && (*p == '-')) p++;
+	const char* d = p;
+	while ((p < end) && (*p >= '0') && (*p <= '9')) p++;
+	if (p == d) return fail();
+	if ((p < end) && (*p == '.')) {
+		p++;
+		d = p;
+		while ((p < end) && (*p >= '0') && (*p <= '9')) p++;
+		if (p == d) return fail();
+	}
+	if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+		p++;
+		if ((p < end) && ((*p == '+') || (*p == '-'))) p++;
+		d = p;
+		while ((p < end) && (*p >= '0') && (*p <= '9')) p++;
+		if (p == d) return fail();
+	}
+	len = p - s;
+	return true;
+}
+
+bool TxtJsonReader::scanLiteral(const char* lit, size_t len)
+{
+	if (((size_t)(end - p) >= len) && (memcmp(p, lit, len) == 0)) {
+		p += len;
+		return true;
+	}
+	return fail();
+}
+
+bool TxtJsonReader::readNull()
+{
+	if (error) return false;
+	skipWs();
+	if ((p < end) && (*p == 'n')) {
+		return scanLiteral("null", 4);
+	}
+	return false;
+}
+
+bool TxtJsonReader::readStringRef(const char*& s, size_t& len)
+{
+	if (error) return false;
+	skipWs();
+	bool escaped;
+	if (!scanString(s, len, escaped)) return false;
+	return !escaped;
+}
+
+bool TxtJsonReader::readString(std::string& s)
+{
+	if (error) return false;
+	skipWs();
+	if (p >= end) return fail();
+	const char* v;
+	size_t len;
+	switch (*p) {
+	case '"':
+	{
+		bool escaped;
+		if (!scanString(v, len, escaped)) return false;
+		if (escaped) {
+			unescape(v, len, s);
+		} else {
+			s.assign(v, len);
+		}
+		return true;
+	}
+	case 'n':
+		s.clear();
+		return scanLiteral("null", 4);
+	case 't':
+		s.assign("true", 4);
+		return scanLiteral("true", 4);
+	case 'f':
+		s.assign("false", 5);
+		return scanLiteral("false", 5);
+	default:
+		if (!scanNumber(v, len)) return false;
+		s.assign(v, len);
+		return true;
+	}
+}
+
+bool TxtJsonReader::readDouble(double& d)
+{
+	if (error) return false;
+	skipWs();
+	if (p >= end) return fail();
+	switch (*p) {
+	case 'n': d = 0.0; return scanLiteral("null", 4);
+	case 't': d = 1.0; return scanLiteral("true", 4);
+	case 'f': d = 0.0; return scanLiteral("false", 5);
+	default:
+	{
+		const char* v;
+		size_t len;
+		if (!scanNumber(v, len)) return false;
+		char tmp[64];
+		if (len >= sizeof(tmp)) return fail();
+		memcpy(tmp, v, len);
+		tmp[len] = 0;
+		d = strtod(tmp, NULL);
+		return true;
+	}
+	}
+}
+
+bool TxtJsonReader::readInt(int& i)
+{
+	if (error) return false;
+	skipWs();
+	if (p >= end) return fail();
+	const char* v = p;
+	size_t len = 0;
+	if ((*p == '-') || ((*p >= '0') && (*p <= '9'))) {
+		if (!scanNumber(v, len)) return false;
+		//fast path: plain integer
+		bool neg = (*v == '-');
+		const char* q = neg ? v + 1 : v;
+		const char* e = v + len;
+		if ((e - q) < 10) {
+			int r = 0;
+			while ((q < e) && (*q >= '0') && (*q <= '9')) {
+				r = r * 10 + (*q++ - '0');
+			}
+			if (q == e) {
+				i = neg ? -r : r;
+				return true;
+			}
+		}
+		p = v; // not a short integer, use strtod
+	}
+	double d;
+	if (!readDouble(d)) return false;
+	if ((d < INT_MIN) || (d > INT_MAX)) return fail();
+	i = (int)d;
+	return true;
+}
+
+bool TxtJsonReader::readBool(bool& b)
+{
+	double d;
+	if (!readDouble(d)) return false;
+	b = (d != 0.0);
+	return true;
+}
+
+bool TxtJsonReader::readWPType(TxtWPType_t& t)
+{
+	if (readNull()) {
+		t = WP_TYPE_NONE;
+		return true;
+	}
+	const char* s;
+	size_t len;
+	if (!readStringRef(s, len)) return false;
+	t = WP_TYPE_NONE;
+	switch (len) {
+	case 3: if (memcmp(s, "RED", 3) == 0) t = WP_TYPE_RED; break;
+	case 4: if (memcmp(s, "BLUE", 4) == 0) t = WP_TYPE_BLUE; break;
+	case 5: if (memcmp(s, "WHITE", 5) == 0) t = WP_TYPE_WHITE; break;
+	default: break;
+	}
+	return true;
+}
+
+bool TxtJsonReader::readWPState(TxtWPState_t& st)
+{
+	if (readNull()) return true;
+	const char* s;
+	size_t len;
+	if (!readStringRef(s, len)) return false;
+	//unknown values keep the state, as before
+	switch (len) {
+	case 3: if (memcmp(s, "RAW", 3) == 0) st = WP_STATE_RAW; break;
+	case 8: if (memcmp(s, "REJECTED", 8) == 0) st = WP_STATE_REJECTED; break;
+	case 9: if (memcmp(s, "PROCESSED", 9) == 0) st = WP_STATE_PROCESSED; break;
+	default: break;
+	}
+	return true;
+}
+
+bool TxtJsonReader::readWorkpiece(TxtWorkpiece& wp)
+{
+	if (!beginObject()) return false;
+	const char* key;
+	size_t len;
+	while (nextMember(key, len)) {
+		bool r;
+		if ((len == 2) && (memcmp(key, "id", 2) == 0)) {
+			r = readString(wp.tag_uid);
+		} else if ((len == 4) && (memcmp(key, "type", 4) == 0)) {
+			r = readWPType(wp.type);
+		} else if ((len == 5) && (memcmp(key, "state", 5) == 0)) {
+			r = readWPState(wp.state);
+		} else {
+			r = skipValue();
+		}
+		if (!r) return false;
+	}
+	return ok();
+}
+
+bool TxtJsonReader::skipValue()
+{
+	if (error) return false;
+	skipWs();
+	if (p >= end) return fail();
+	const char* s;
+	size_t len;
+	bool escaped;
+	switch (*p) {
+	case '"':
+		return scanString(s, len, escaped);
+	case 'n': return scanLiteral("null", 4);
+	case 't': return scanLiteral("true", 4);
+	case 'f': return scanLiteral("false", 5);
+	case '{':
+	{
+		if (!beginObject()) return false;
+		const char* key;
+		while (nextMember(key, len)) {
+			if (!skipValue()) return false;
+		}
+		return ok();
+	}
+	case '[':
+	{
+		if (depth >= JSON_READER_MAX_DEPTH) return fail();
+		p++;
+		skipWs();
+		if ((p < end) && (*p == ']')) {
+			p++;
+			return true;
+		}
+		depth++;
+		do {
+			if (!skipValue()) return false;
+			skipWs();
+		} while ((p < end) && (*p == ',') && ++p);
+		depth--;
+		return expect(']');
+	}
+	default:
+		return scanNumber(s, len);
+	}
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,301 @@
+/*
+ * TxtJsonWriter.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtJsonWriter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <assert.h>
+
+
+namespace ft {
+
+
+// same as jsoncpp utf8ToCodepoint, invalid sequences give U+FFFD
+static unsigned int utf8ToCodepoint(const char*& s, const char* e)
+{
+	const unsigned int REPLACEMENT_CHARACTER = 0xFFFD;
+	unsigned int firstByte = static_cast<unsigned char>(*s);
+	if (firstByte < 0x80)
+		return firstByte;
+	if (firstByte < 0xE0) {
+		if (e - s < 2)
+			return REPLACEMENT_CHARACTER;
+		unsigned int calculated = ((firstByte & 0x1F) << 6)
+				| (static_cast<unsigned int>(s[1]) & 0x3F);
+		s += 1;
+		return calculated < 0x80 ? REPLACEMENT_CHARACTER : calculated;
+	}
+	if (firstByte < 0xF0) {
+		if (e - s < 3)
+			return REPLACEMENT_CHARACTER;
+		unsigned int calculated = ((firstByte & 0x0F) << 12)
+				| ((static_cast<unsigned int>(s[1]) & 0x3F) << 6)
+				| (static_cast<unsigned int>(s[2]) & 0x3F);
+		s += 2;
+		if (calculated >= 0xD800 && calculated <= 0xDFFF)
+			return REPLACEMENT_CHARACTER;
+		return calculated < 0x800 ? REPLACEMENT_CHARACTER : calculated;
+	}
+	if (firstByte < 0xF8) {
+		if (e - s < 4)
+			return REPLACEMENT_CHARACTER;
+		unsigned int calculated = ((firstByte & 0x07) << 18)
+				| ((static_cast<unsigned int>(s[1]) & 0x3F) << 12)
+				| ((static_cast<unsigned int>(s[2]) & 0x3F) << 6)
+				| (static_cast<unsigned int>(s[3]) & 0x3F);
+		s += 3;
+		return calculated < 0x10000 ? REPLACEMENT_CHARACTER : calculated;
+	}
+	return REPLACEMENT_CHARACTER;
+}
+
+static void appendHex16(std::string& buf, unsigned int x)
+{
+	static const char hex[] = "0123456789abcdef";
+	char h[6] = { '\\', 'u', hex[(x >> 12) & 0xF], hex[(x >> 8) & 0xF], hex[(x >> 4) & 0xF], hex[x & 0xF] };
+	buf.append(h, 6);
+}
+
+
+TxtJsonWriter::TxtJsonWriter() : buf(), depth(0), indented(true)
+{
+	buf.reserve(JSON_WRITER_RESERVE);
+	memset(level, 0, sizeof(level));
+}
+
+TxtJsonWriter& TxtJsonWriter::local()
+{
+	static thread_local TxtJsonWriter w;
+	w.clear();
+	return w;
+}
+
+void TxtJsonWriter::clear()
+{
+	buf.clear(); //keeps capacity
+	depth = 0;
+	indented = true;
+}
+
+void TxtJsonWriter::writeIndent(int n)
+{
+	buf += '\n';
+	buf.append(n, '\t');
+}
+
+void TxtJsonWriter::writeWithIndent(int n, char c)
+{
+	if (!indented) writeIndent(n);
+	buf += c;
+	indented = false;
+}
+
+void TxtJsonWriter::open(int i)
+{
+	//opening bracket is written with the first child, empty containers are "{}" and "[]"
+	writeWithIndent(i, level[i].isArray ? '[' : '{');
+	level[i].opened = true;
+}
+
+void TxtJsonWriter::beginValue()
+{
+	if (depth == 0) return;
+	Level_t& l = level[depth-1];
+	if (l.isArray)
+	{
+		if (!l.opened) open(depth-1);
+		if (l.count > 0) buf += ',';
+		if (!indented) writeIndent(depth);
+		indented = true;
+		l.count++;
+	}
+}
+
+void TxtJsonWriter::endValue()
+{
+	if ((depth > 0) && level[depth-1].isArray)
+	{
+		indented = false;
+	}
+}
+
+TxtJsonWriter& TxtJsonWriter::key(const char* k, size_t n)
+{
+	assert(depth > 0);
+	Level_t& l = level[depth-1];
+	assert(!l.isArray);
+	assert(!l.lastKey || (strcmp(l.lastKey, k) < 0)); //jsoncpp order
+	if (!l.opened) open(depth-1);
+	if (l.count > 0) buf += ',';
+	if (!indented) writeIndent(depth);
+	writeQuoted(k, n);
+	indented = false;
+	buf.append(" : ", 3);
+	l.count++;
+	l.lastKey = k;
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::beginObject()
+{
+	beginValue();
+	assert(depth < JSON_WRITER_MAX_DEPTH);
+	Level_t& l = level[depth++];
+	l.isArray = false;
+	l.opened = false;
+	l.count = 0;
+	l.lastKey = 0;
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::endObject()
+{
+	assert((depth > 0) && !level[depth-1].isArray);
+	if (level[depth-1].count == 0) {
+		buf.append("{}", 2);
+	} else {
+		writeWithIndent(depth-1, '}');
+	}
+	depth--;
+	endValue();
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::beginArray()
+{
+	beginValue();
+	assert(depth < JSON_WRITER_MAX_DEPTH);
+	Level_t& l = level[depth++];
+	l.isArray = true;
+	l.opened = false;
+	l.count = 0;
+	l.lastKey = 0;
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::endArray()
+{
+	assert((depth > 0) && level[depth-1].isArray);
+	if (level[depth-1].count == 0) {
+		buf.append("[]", 2);
+	} else {
+		writeWithIndent(depth-1, ']');
+	}
+	depth--;
+	endValue();
+	return *this;
+}
+
+void TxtJsonWriter::writeQuoted(const char* s, size_t n)
+{
+	const char* end = s + n;
+	buf += '"';
+	for (const char* c = s; c < end; ++c)
+	{
+		switch (*c)
+		{
+		case '\"': buf.append("\\\"", 2); break;
+		case '\\': buf.append("\\\\", 2); break;
+		case '\b': buf.append("\\b", 2); break;
+		case '\f': buf.append("\\f", 2); break;
+		case '\n': buf.append("\\n", 2); break;
+		case '\r': buf.append("\\r", 2); break;
+		case '\t': buf.append("\\t", 2); break;
+		default:
+		{
+			unsigned int cp = utf8ToCodepoint(c, end);
+			if ((cp < 0x80) && (cp >= 0x20)) {
+				buf += static_cast<char>(cp);
+			} else if (cp < 0x10000) {
+				appendHex16(buf, cp);
+			} else {
+				cp -= 0x10000;
+				appendHex16(buf, (cp >> 10) + 0xD800);
+				appendHex16(buf, (cp & 0x3FF) + 0xDC00);
+			}
+			break;
+		}
+		}
+	}
+	buf += '"';
+}
+
+TxtJsonWriter& TxtJsonWriter::valueString(const char* s, size_t n)
+{
+	beginValue();
+	writeQuoted(s, n);
+	endValue();
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::valueString(const char* s)
+{
+	return valueString(s, strlen(s));
+}
+
+TxtJsonWriter& TxtJsonWriter::valueInt(int64_t i)
+{
+	beginValue();
+	char tmp[24];
+	char* p = tmp + sizeof(tmp);
+	uint64_t u = (i < 0) ? (uint64_t)0 - (uint64_t)i : (uint64_t)i;
+	do {
+		*--p = (char)('0' + (u % 10));
+		u /= 10;
+	} while (u != 0);
+	if (i < 0) *--p = '-';
+	buf.append(p, tmp + sizeof(tmp) - p);
+	endValue();
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::valueBool(bool b)
+{
+	beginValue();
+	if (b) {
+		buf.append("true", 4);
+	} else {
+		buf.append("false", 5);
+	}
+	endValue();
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::valueDouble(double d)
+{
+	beginValue();
+	char tmp[36];
+	int len;
+	if (std::isfinite(d)) {
+		len = snprintf(tmp, sizeof(tmp), "%.17g", d);
+		buf.append(tmp, len);
+		//keep the fact that this is a double, like jsoncpp
+		if (!memchr(tmp, '.', len) && !memchr(tmp, 'e', len)) {
+			buf.append(".0", 2);
+		}
+	} else if (d != d) {
+		buf.append("null", 4);
+	} else if (d < 0) {
+		buf.append("-1e+9999", 8);
+	} else {
+		buf.append("1e+9999", 7);
+	}
+	endValue();
+	return *this;
+}
+
+TxtJsonWriter& TxtJsonWriter::valueNull()
+{
+	beginValue();
+	buf.append("null", 4);
+	endValue();
+	return *this;
+}
+
+
+} /* namespace ft */
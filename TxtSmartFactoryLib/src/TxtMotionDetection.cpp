@@ -6,13 +6,17 @@
  */
 
 #include "TxtMotionDetection.h"
+#include "TxtImageKernels.h"
+
+#include <algorithm>
 
 
 namespace ft {
 
 
 TxtMotionDetection::TxtMotionDetection(ft::TxtCamera* cam, double max_limit_Area)
-	: cam(cam), tsLastDetected(), max_limit_Area(max_limit_Area),
+	: cam(cam), seqLast(0), bg(), var(), mask(), grayLast(),
+	  alpha(MOTION_LEARN_RATE * 256), thresh(MOTION_THRESH), useVariance(false), useOpenCV(false), enabled(false), tsLastDetected(), max_limit_Area(max_limit_Area),
 	  m_stoprequested(false), m_running(false), m_mutex(), m_thread()
 {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "max_limit_Area:{}", max_limit_Area);
@@ -20,6 +24,7 @@ TxtMotionDetection::TxtMotionDetection(ft::TxtCamera* cam, double max_limit_Area
 	pthread_mutexattr_init(&attr);
 	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 	pthread_mutex_init(&m_mutex, &attr);
+	resetStats();
 }
 
 TxtMotionDetection::~TxtMotionDetection()
@@ -66,7 +71,9 @@ bool TxtMotionDetection::stopThread() {
     assert(m_running == true);
     m_running = false;
     m_stoprequested = true;
-    return pthread_join(m_thread, 0) == 0;
+    bool ret = pthread_join(m_thread, 0) == 0;
+    logStats();
+    return ret;
 }
 
 std::string TxtMotionDetection::getDataString() {
@@ -75,70 +82,217 @@ std::string TxtMotionDetection::getDataString() {
 	return cam->getDataString();
 }
 
+TxtMotionDetectionStats TxtMotionDetection::getStats() {
+	pthread_mutex_lock(&m_mutex);
+	TxtMotionDetectionStats st = stats;
+	pthread_mutex_unlock(&m_mutex);
+	return st;
+}
+
+void TxtMotionDetection::logStats() {
+	TxtMotionDetectionStats st = getStats();
+	spdlog::get("console")->info("motion detection{} frames:{} early exits:{} contours:{} global changes:{} detections:{} triggers:{} avg:{:.2f}ms max:{:.2f}ms",
+			useOpenCV ? " opencv" : "", st.frames, st.earlyExits, st.contourRuns, st.globalChanges, st.detections, st.triggers,
+			st.frames ? st.sum_ms/st.frames : 0., st.max_ms);
+}
+
+void TxtMotionDetection::setLearningRate(double rate) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setLearningRate rate:{}", rate);
+	pthread_mutex_lock(&m_mutex);
+	alpha = (uint16_t)std::max(1., std::min(256., rate * 256. + 0.5));
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMotionDetection::setThreshold(int t) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setThreshold t:{}", t);
+	pthread_mutex_lock(&m_mutex);
+	thresh = (uint8_t)std::max(1, std::min(254, t));
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMotionDetection::setVariance(bool v) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setVariance v:{}", v);
+	pthread_mutex_lock(&m_mutex);
+	if (v && !useVariance) {
+		var.release(); //learned again from the next frame
+	}
+	useVariance = v;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMotionDetection::setOpenCV(bool o) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setOpenCV o:{}", o);
+	pthread_mutex_lock(&m_mutex);
+	if (o != useOpenCV) {
+		logStats();
+		bg.release();
+		var.release();
+		grayLast.release();
+		resetStats();
+	}
+	useOpenCV = o;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMotionDetection::setEnabled(bool e, double fps) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setEnabled e:{} fps:{}", e, fps);
+	pthread_mutex_lock(&m_mutex);
+	if (e && !enabled) {
+		cam->acquire("motion", fps);
+	} else if (e) {
+		cam->setFps("motion", fps);
+	} else if (enabled) {
+		cam->release("motion");
+	}
+	enabled = e;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+bool TxtMotionDetection::detect(const cv::Mat& gray) {
+	//m_mutex is locked by the caller
+	size_t n = gray.total();
+	if (bg.empty() || (bg.size() != gray.size())) {
+		//first frame: background is the frame
+		gray.convertTo(bg, CV_16UC1, 256.);
+		var.release();
+		return false;
+	}
+	if (useVariance && var.empty()) {
+		var = cv::Mat::zeros(gray.size(), CV_16UC1);
+	}
+	//changed pixels against the background, the kernel counts them and updates the model in the same pass
+	mask.create(gray.size(), CV_8UC1);
+	uint32_t changed = backgroundDiff(gray.ptr<uint8_t>(), bg.ptr<uint16_t>(),
+			useVariance ? var.ptr<uint16_t>() : 0, mask.ptr<uint8_t>(), n, thresh, alpha, MOTION_VAR_K);
+	//lighting or exposure change of the whole image: new background instead of an alert
+	if (changed * 100 > n * MOTION_GLOBAL_PCT) {
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "TxtMotionDetection global change:{}/{}", changed, n);
+		stats.globalChanges++;
+		gray.convertTo(bg, CV_16UC1, 256.);
+		var.release(); //variance of the old background would mask the new one
+		return false;
+	}
+	//early exit: the area of an external contour includes its holes, the changed pixels do not
+	//bound it. Every contour lies in the bounding box of the changed pixels grown by the dilation.
+	if (changed == 0) {
+		stats.earlyExits++;
+		return false;
+	}
+	cv::Rect bb = maskBounds(mask);
+	double bbArea = (double)(bb.width + 2*MOTION_DILATE) * (bb.height + 2*MOTION_DILATE) * MOTION_REDUCE * MOTION_REDUCE;
+	if (bbArea < max_limit_Area) {
+		stats.earlyExits++;
+		return false;
+	}
+	stats.contourRuns++;
+
+	cv::dilate(mask, mask, cv::Mat(), cv::Point(-1,-1), MOTION_DILATE);
+	std::vector<std::vector<cv::Point> > cnts;
+	cv::findContours(mask, cnts, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "TxtMotionDetection changed:{} findContours {}", changed, cnts.size());
+	for(unsigned int i = 0; i< cnts.size(); i++) {
+		double cArea = cv::contourArea(cnts[i]) * MOTION_REDUCE * MOTION_REDUCE; // full size pixels
+#ifdef DEBUG
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "---------- cnt.size:{} cArea:{}({})", cnts[i].size(), cArea, max_limit_Area);
+#endif
+		if(cArea >= max_limit_Area) { //default 500
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TxtMotionDetection::detectOpenCV(cv::Mat& gray) {
+	//m_mutex is locked by the caller
+	cv::GaussianBlur(gray, gray, cv::Size(21, 21), 0);
+	if (grayLast.empty() || (grayLast.size() != gray.size())) {
+		grayLast = gray;
+		return false;
+	}
+	cv::absdiff(grayLast, gray, mask);
+	grayLast = gray;
+	cv::threshold(mask, mask, thresh, 255, cv::THRESH_BINARY);
+	stats.contourRuns++;
+
+	cv::dilate(mask, mask, cv::Mat(), cv::Point(-1,-1), MOTION_DILATE);
+	std::vector<std::vector<cv::Point> > cnts;
+	cv::findContours(mask, cnts, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "TxtMotionDetection OpenCV findContours {}", cnts.size());
+	for(unsigned int i = 0; i< cnts.size(); i++) {
+		if(cv::contourArea(cnts[i]) >= max_limit_Area) { //default 500
+			return true;
+		}
+	}
+	return false;
+}
+
+void TxtMotionDetection::resetStats() {
+	//m_mutex is locked by the caller
+	stats.frames = 0;
+	stats.earlyExits = 0;
+	stats.contourRuns = 0;
+	stats.globalChanges = 0;
+	stats.detections = 0;
+	stats.triggers = 0;
+	stats.sum_ms = 0.;
+	stats.max_ms = 0.;
+}
+
 void TxtMotionDetection::run() {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "");
     while (!m_stoprequested)
     {
-		//pthread_mutex_lock(&m_mutex);
-
-		cv::Mat frame;
 		assert(cam);
-		cam->getFrame().copyTo(frame);
-
-		if (!frame.empty()) {
-
-			//convert to grayscale
-			cv::Mat gray;
-			cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-			cv::GaussianBlur(gray, gray, cv::Size(21, 21), 0);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "TxtMotionDetection cvtColor");
-
-			if (!gray_last.empty()) {
-				//compute difference between first frame and current frame
-				cv::Mat frameDelta;
-				cv::absdiff(gray_last, gray, frameDelta);
-				cv::Mat thresh;
-				cv::threshold(frameDelta, thresh, 25, 255, cv::THRESH_BINARY);
-
-				cv::dilate(thresh, thresh, cv::Mat(), cv::Point(-1,-1), 2);
-				std::vector<std::vector<cv::Point> > cnts;
-				cv::findContours(thresh, cnts, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "TxtMotionDetection findContours {}", cnts.size());
-				for(unsigned int i = 0; i< cnts.size(); i++) {
-					std::vector<cv::Point> cnt = cnts[i];
-					double cArea = contourArea(cnts[i]);
-#ifdef DEBUG
-					cv::Rect rectcnt = cv::boundingRect(cnt);
-					// tl() directly equals to the desired min. values
-					//cv::Point minVal = rectcnt.tl();
-					// br() is exclusive so we need to subtract 1 to get the max. values
-					//cv::Point maxVal = rectcnt.br() - cv::Point(1, 1);
-					//SPDLOG_LOGGER_DEBUG(spdlog::get("console"), ".......... cnt size:{} min:{} {} max:{} {}", cnt.size(), minVal.x, minVal.y, maxVal.x, maxVal.y);
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "---------- cnt.size:{} cArea:{}({})", cnt.size(), cArea, max_limit_Area);
-#endif
-					if(cArea < max_limit_Area) { //default 500
-						continue;
-					}
-					//cv::putText(frame, "Motion Detected", cv::Point(10, 20), cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0,0,255),2);
-
-					auto tsDetected = std::chrono::system_clock::now();
-					auto dur = tsDetected-tsLastDetected;
-					auto secs = std::chrono::duration_cast< std::chrono::duration<float> >(dur);
-					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "========== elapsed_seconds:{} ({})", secs.count(), TIMEWAIT_S_MAX);
-					if (secs.count() > TIMEWAIT_S_MAX) {
-						SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "XXXXXXXXXX TRIGGER");
-						tsLastDetected = tsDetected;
-						Notify(); //motion detectionl
-					}
+		TxtCameraFramePtr frame = cam->getFrame();
+
+		pthread_mutex_lock(&m_mutex);
+		bool opencv = useOpenCV;
+		pthread_mutex_unlock(&m_mutex);
+
+		//each frame once, gray at reduced size, the buffer is released after the conversion
+		cv::Mat gray;
+		if (frame && (frame->info.seq != seqLast)) {
+			seqLast = frame->info.seq;
+			TxtCamera::getPixels(frame, gray, opencv ? 1 : MOTION_REDUCE, true);
+		}
+		frame.reset();
+
+		if (!gray.empty()) {
+			auto tsStart = std::chrono::steady_clock::now();
+			if (!opencv) {
+				//two box blurs approximate the GaussianBlur 21x21 of the full size frame
+				boxBlur(gray, gray, MOTION_BLUR_R);
+				boxBlur(gray, gray, MOTION_BLUR_R);
+			}
+
+			pthread_mutex_lock(&m_mutex);
+			if (opencv ? detectOpenCV(gray) : detect(gray)) {
+				stats.detections++;
+				auto tsDetected = std::chrono::system_clock::now();
+				auto dur = tsDetected-tsLastDetected;
+				auto secs = std::chrono::duration_cast< std::chrono::duration<float> >(dur);
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "========== elapsed_seconds:{} ({})", secs.count(), TIMEWAIT_S_MAX);
+				if (secs.count() > TIMEWAIT_S_MAX) {
+					SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "XXXXXXXXXX TRIGGER");
+					tsLastDetected = tsDetected;
+					stats.triggers++;
+					pthread_mutex_unlock(&m_mutex);
+					Notify(); //motion detection
+					pthread_mutex_lock(&m_mutex);
 				}
 			}
 
-			gray_last = gray;
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tsStart).count();
+			stats.frames++;
+			stats.sum_ms += ms;
+			if (ms > stats.max_ms) stats.max_ms = ms;
+			pthread_mutex_unlock(&m_mutex);
 		}
-		std::this_thread::sleep_for(std::chrono::milliseconds((int64_t)cam->getPeriod()));
-
-		//pthread_mutex_unlock(&m_mutex);
+		//no consumer of the camera: no new frames
+		int64_t wait_ms = (cam->getConsumers() > 0) ? (int64_t)cam->getPeriod() : MOTION_IDLE_MS;
+		std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
 	}
 }
 
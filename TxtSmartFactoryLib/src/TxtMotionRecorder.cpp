@@ -0,0 +1,393 @@
+/*
+ * TxtMotionRecorder.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMotionRecorder.h"
+
+#include "Utils.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <fstream>
+#include <json/json.h>
+
+
+namespace ft {
+
+
+TxtMotionRecorder::TxtMotionRecorder(TxtCamera* cam, const std::string& dir, double pre_s, double post_s)
+	: cam(cam), dir(dir), pre_ns((int64_t)(pre_s * 1e9)), post_ns((int64_t)(post_s * 1e9)),
+	  ring(), tsLast_ns(0), recording(false), tsEnd_ns(0), clip(), queue(),
+	  m_mutex(), m_stoprequested(false), m_running(false), m_thread()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMotionRecorder dir:{} pre_s:{} post_s:{}", dir, pre_s, post_s);
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_mutex, &attr);
+	sem_init(&m_semQueue, 0, 0);
+	stats.clips = 0;
+	stats.frames = 0;
+	stats.bytes = 0;
+	stats.dropped = 0;
+	stats.failed = 0;
+	assert(cam);
+	cam->Attach(this);
+}
+
+TxtMotionRecorder::~TxtMotionRecorder()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtMotionRecorder");
+	cam->Detach(this);
+	if (m_running) {
+		stopThread();
+	}
+	sem_destroy(&m_semQueue);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+bool TxtMotionRecorder::startThread() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "startThread");
+	if (m_running) return true; //already running
+	//go
+	assert(m_running == false);
+	m_running = true;
+	m_stoprequested = false;
+	return pthread_create(&m_thread, 0, start_thread, this) == 0;
+}
+
+bool TxtMotionRecorder::stopThread() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "stopThread");
+	if (!m_running) return true; //already stopped
+	//the running clip is written with the frames so far
+	pthread_mutex_lock(&m_mutex);
+	if (recording) {
+		finish();
+	}
+	pthread_mutex_unlock(&m_mutex);
+	//stop
+	assert(m_running == true);
+	m_running = false;
+	m_stoprequested = true;
+	sem_post(&m_semQueue);
+	bool ret = pthread_join(m_thread, 0) == 0;
+	TxtMotionRecorderStats st = getStats();
+	spdlog::get("console")->info("motion clips written:{} frames:{} bytes:{} dropped:{} failed:{}",
+			st.clips, st.frames, st.bytes, st.dropped, st.failed);
+	return ret;
+}
+
+TxtMotionRecorderStats TxtMotionRecorder::getStats() {
+	pthread_mutex_lock(&m_mutex);
+	TxtMotionRecorderStats st = stats;
+	pthread_mutex_unlock(&m_mutex);
+	return st;
+}
+
+void TxtMotionRecorder::Update(SubjectObserver* theChangedSubject) {
+	if (theChangedSubject != cam) return;
+	TxtCameraFramePtr f = cam->getFrame();
+	if (!f) return;
+	int64_t ts = f->info.ts_ns;
+	//clips at CLIP_FPS at most, the frames in between are not taken
+	if ((tsLast_ns != 0) && (ts - tsLast_ns < (int64_t)(1e9 / CLIP_FPS))) return;
+	tsLast_ns = ts;
+	Frame_t fr;
+	fr.ts_ns = ts;
+	fr.width = f->info.width;
+	fr.height = f->info.height;
+	//capture thread: no encode here
+	if (!f->jpg.empty()) {
+		fr.jpg = std::make_shared<const std::string>((const char*)f->jpg.ptr(), f->jpg.total());
+	} else {
+		fr.jpg = cam->getArtifact(f, CAM_ENC_JPEG, true);
+		if (!fr.jpg) {
+			f->mat.copyTo(fr.mat);
+		}
+	}
+	if (!fr.jpg && fr.mat.empty()) return;
+
+	pthread_mutex_lock(&m_mutex);
+	if (recording) {
+		clip.frames.push_back(fr);
+		if ((ts >= tsEnd_ns) || (clip.frames.size() >= CLIP_FRAMES_MAX)) {
+			finish();
+		}
+	} else {
+		ring.push_back(fr);
+		while (!ring.empty() && ((ts - ring.front().ts_ns > pre_ns) || (ring.size() > CLIP_FRAMES_MAX/2))) {
+			ring.pop_front();
+		}
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+std::string TxtMotionRecorder::trigger() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "trigger");
+	int64_t now = getnowtimestamp_ns();
+	pthread_mutex_lock(&m_mutex);
+	if (!recording) {
+		time_t t = (time_t)(now / 1000000000);
+		struct tm tm;
+		localtime_r(&t, &tm);
+		char id[32];
+		strftime(id, sizeof(id), "cam-%Y%m%d-%H%M%S", &tm);
+		clip.id = id;
+		clip.tsTrigger_ns = now;
+		clip.frames.assign(ring.begin(), ring.end());
+		ring.clear();
+		recording = true;
+	}
+	tsEnd_ns = now + post_ns;
+	std::string ret = clip.id;
+	pthread_mutex_unlock(&m_mutex);
+	return ret;
+}
+
+void TxtMotionRecorder::finish() {
+	//m_mutex is locked by the caller
+	recording = false;
+	if (queue.size() >= CLIP_QUEUE_MAX) {
+		spdlog::get("console")->warn("motion clip {} dropped: writer busy", clip.id);
+		stats.dropped++;
+	} else if (!clip.frames.empty()) {
+		queue.push_back(Clip_t());
+		std::swap(queue.back(), clip);
+		sem_post(&m_semQueue);
+	}
+	clip.frames.clear();
+}
+
+void TxtMotionRecorder::run() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "run");
+	while (true)
+	{
+		sem_wait(&m_semQueue);
+		pthread_mutex_lock(&m_mutex);
+		if (queue.empty()) {
+			pthread_mutex_unlock(&m_mutex);
+			if (m_stoprequested) break;
+			continue;
+		}
+		Clip_t c;
+		std::swap(c, queue.front());
+		queue.pop_front();
+		pthread_mutex_unlock(&m_mutex);
+		//no lock while writing: the camera keeps adding frames
+		write(c);
+		if (m_stoprequested) {
+			//write the remaining clips before the end
+			sem_post(&m_semQueue);
+		}
+	}
+}
+
+void TxtMotionRecorder::encode(Clip_t& c) {
+	//writer thread only
+	std::vector<int> params;
+	params.push_back(cv::IMWRITE_JPEG_QUALITY);
+	params.push_back(cam->getJpegQuality());
+	size_t k = 0;
+	for (size_t i = 0; i < c.frames.size(); i++) {
+		Frame_t& fr = c.frames[i];
+		if (!fr.jpg) {
+			std::vector<uchar> buf;
+			try {
+				if (cv::imencode(".jpg", fr.mat, buf, params) && !buf.empty()) {
+					fr.jpg = std::make_shared<const std::string>((const char*)buf.data(), buf.size());
+				}
+			} catch (const cv::Exception& exc) {
+				std::cout << "Error: " << exc.what() << std::endl;
+			}
+			fr.mat.release();
+		}
+		if (fr.jpg) {
+			if (k != i) c.frames[k] = fr;
+			k++;
+		}
+	}
+	c.frames.resize(k);
+}
+
+bool TxtMotionRecorder::write(Clip_t& c) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "write {} frames:{}", c.id, c.frames.size());
+	encode(c);
+	std::string file = c.id + ".avi";
+	size_t bytes = 0;
+	bool ret = !c.frames.empty() && writeAvi(dir + file, c, bytes);
+	pthread_mutex_lock(&m_mutex);
+	if (ret) {
+		stats.clips++;
+		stats.frames += c.frames.size();
+		stats.bytes += bytes;
+	} else {
+		stats.failed++;
+	}
+	pthread_mutex_unlock(&m_mutex);
+	if (!ret) {
+		spdlog::get("file_logger")->error("motion clip {}: cannot write {}", c.id, dir + file);
+		return false;
+	}
+	writeIndex(c, file, bytes);
+	std::cout << "motion clip " << file << " frames:" << c.frames.size() << " bytes:" << bytes << std::endl;
+	return true;
+}
+
+static void put32(std::ostream& os, uint32_t v) {
+	char b[4] = { (char)(v & 0xff), (char)((v >> 8) & 0xff), (char)((v >> 16) & 0xff), (char)((v >> 24) & 0xff) };
+	os.write(b, 4);
+}
+
+static void put16(std::ostream& os, uint16_t v) {
+	char b[2] = { (char)(v & 0xff), (char)((v >> 8) & 0xff) };
+	os.write(b, 2);
+}
+
+static void putFourcc(std::ostream& os, const char* cc) {
+	os.write(cc, 4);
+}
+
+bool TxtMotionRecorder::writeAvi(const std::string& filename, const Clip_t& c, size_t& bytes) {
+	//RIFF AVI with one MJPEG stream: hdrl, movi with a 00dc chunk per frame, idx1
+	const uint32_t n = (uint32_t)c.frames.size();
+	const uint16_t width = c.frames.front().width;
+	const uint16_t height = c.frames.front().height;
+	int64_t dur_ns = (n > 1) ? (c.frames.back().ts_ns - c.frames.front().ts_ns) : 0;
+	uint32_t usPerFrame = (n > 1) ? (uint32_t)(dur_ns / 1000 / (n - 1)) : (uint32_t)(1e6 / CLIP_FPS);
+	if (usPerFrame == 0) usPerFrame = (uint32_t)(1e6 / CLIP_FPS);
+	uint32_t maxFrame = 0;
+	uint32_t moviSize = 4;
+	for (auto const& fr : c.frames) {
+		uint32_t s = (uint32_t)fr.jpg->size();
+		if (s > maxFrame) maxFrame = s;
+		moviSize += 8 + s + (s & 1);
+	}
+	const uint32_t strlSize = 4 + (8 + 56) + (8 + 40);
+	const uint32_t hdrlSize = 4 + (8 + 56) + (8 + strlSize);
+	const uint32_t idx1Size = 16 * n;
+	const uint32_t riffSize = 4 + (8 + hdrlSize) + (8 + moviSize) + (8 + idx1Size);
+
+	std::ofstream os(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!os) {
+		return false;
+	}
+	putFourcc(os, "RIFF"); put32(os, riffSize); putFourcc(os, "AVI ");
+	putFourcc(os, "LIST"); put32(os, hdrlSize); putFourcc(os, "hdrl");
+	//avih
+	putFourcc(os, "avih"); put32(os, 56);
+	put32(os, usPerFrame);
+	put32(os, (uint32_t)((uint64_t)maxFrame * 1000000 / usPerFrame)); // max bytes per s
+	put32(os, 0);           // padding granularity
+	put32(os, 0x10);        // AVIF_HASINDEX
+	put32(os, n);           // total frames
+	put32(os, 0);           // initial frames
+	put32(os, 1);           // streams
+	put32(os, maxFrame);    // suggested buffer size
+	put32(os, width);
+	put32(os, height);
+	for (int i = 0; i < 4; i++) put32(os, 0);
+	putFourcc(os, "LIST"); put32(os, strlSize); putFourcc(os, "strl");
+	//strh
+	putFourcc(os, "strh"); put32(os, 56);
+	putFourcc(os, "vids"); putFourcc(os, "MJPG");
+	put32(os, 0);           // flags
+	put16(os, 0); put16(os, 0); // priority, language
+	put32(os, 0);           // initial frames
+	put32(os, usPerFrame);  // scale
+	put32(os, 1000000);     // rate: rate/scale = fps
+	put32(os, 0);           // start
+	put32(os, n);           // length
+	put32(os, maxFrame);    // suggested buffer size
+	put32(os, 0xffffffff);  // quality
+	put32(os, 0);           // sample size
+	put16(os, 0); put16(os, 0); put16(os, width); put16(os, height);
+	//strf: BITMAPINFOHEADER
+	putFourcc(os, "strf"); put32(os, 40);
+	put32(os, 40);
+	put32(os, width);
+	put32(os, height);
+	put16(os, 1);           // planes
+	put16(os, 24);          // bit count
+	putFourcc(os, "MJPG");
+	put32(os, (uint32_t)width * height * 3);
+	put32(os, 0); put32(os, 0); put32(os, 0); put32(os, 0);
+	//movi
+	putFourcc(os, "LIST"); put32(os, moviSize); putFourcc(os, "movi");
+	for (auto const& fr : c.frames) {
+		uint32_t s = (uint32_t)fr.jpg->size();
+		putFourcc(os, "00dc"); put32(os, s);
+		os.write(fr.jpg->data(), s);
+		if (s & 1) os.put(0);
+	}
+	//idx1: offsets from the "movi" fourcc
+	putFourcc(os, "idx1"); put32(os, idx1Size);
+	uint32_t offset = 4;
+	for (auto const& fr : c.frames) {
+		uint32_t s = (uint32_t)fr.jpg->size();
+		putFourcc(os, "00dc");
+		put32(os, 0x10);        // AVIIF_KEYFRAME
+		put32(os, offset);
+		put32(os, s);
+		offset += 8 + s + (s & 1);
+	}
+	os.close();
+	bytes = 8 + riffSize;
+	return !os.fail();
+}
+
+void TxtMotionRecorder::writeIndex(const Clip_t& c, const std::string& file, size_t bytes) {
+	//writer thread only
+	std::string filename = dir + CLIP_INDEX;
+	Json::Value root(Json::arrayValue);
+	std::ifstream is(filename.c_str());
+	if (is) {
+		Json::CharReaderBuilder builder;
+		std::string errs;
+		if (!Json::parseFromStream(builder, is, &root, &errs) || !root.isArray()) {
+			std::cout << "Error: " << filename << " " << errs << std::endl;
+			root = Json::Value(Json::arrayValue);
+		}
+		is.close();
+	}
+	char sts[25];
+	getnowstr(sts);
+	Json::Value e(Json::objectValue);
+	e["id"] = c.id;
+	e["file"] = file;
+	e["ts"] = sts;
+	e["frames"] = (Json::UInt)c.frames.size();
+	e["bytes"] = (Json::UInt64)bytes;
+	e["width"] = c.frames.empty() ? 0 : c.frames.front().width;
+	e["height"] = c.frames.empty() ? 0 : c.frames.front().height;
+	e["pre_s"] = c.frames.empty() ? 0. : (c.tsTrigger_ns - c.frames.front().ts_ns) / 1e9;
+	e["duration_s"] = c.frames.empty() ? 0. : (c.frames.back().ts_ns - c.frames.front().ts_ns) / 1e9;
+	root.append(e);
+	//oldest clips are deleted
+	Json::Value keep(Json::arrayValue);
+	Json::ArrayIndex drop = (root.size() > CLIP_FILES_MAX) ? root.size() - CLIP_FILES_MAX : 0;
+	for (Json::ArrayIndex i = 0; i < root.size(); i++) {
+		if (i < drop) {
+			std::string old = dir + root[i].get("file", "").asString();
+			if (::remove(old.c_str()) != 0) {
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "cannot remove {}", old);
+			}
+		} else {
+			keep.append(root[i]);
+		}
+	}
+	std::ofstream os(filename.c_str(), std::ios::trunc);
+	if (!os) {
+		spdlog::get("file_logger")->error("motion clip index: cannot write {}", filename);
+		return;
+	}
+	Json::StreamWriterBuilder wbuilder;
+	wbuilder["indentation"] = "\t";
+	std::unique_ptr<Json::StreamWriter> writer(wbuilder.newStreamWriter());
+	writer->write(keep, &os);
+	os << std::endl;
+}
+
+
+} /* namespace ft */
@@ -19,17 +19,18 @@
 #include <string>
 #include <time.h>
 #include <iomanip>
+#include <algorithm>
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <net/if.h>
 #include <TxtMqttFactoryClient.h>
+#include "TxtJsonWriter.h"
+#include "TxtJsonReader.h"
 
 #include "spdlog/spdlog.h"
 
-#define FORCE_EXIT_ON_TIMEOUT
-
 extern char TxtAppVer[32];
 
 
@@ -66,25 +67,14 @@ std::string getMQTTReasonCodeString(int rc) {
 
 TxtMqttFactoryClient::TxtMqttFactoryClient(std::string clientname, std::string clientNamePrefix, std::string host, std::string port,
 		std::string mqtt_user, mqtt::binary_ref mqtt_pass, bool bretained, int iqos)
-	: clientname(clientname), host(host), port(port), mqtt_user(mqtt_user), mqtt_pass(mqtt_pass),
+	: clientname(clientname), station(), host(host), port(port), mqtt_user(mqtt_user), mqtt_pass(mqtt_pass),
 	  bretained(bretained), iqos(iqos),
-	cli("tcp://" + host + ":" + port, clientNamePrefix+clientname+"V"+std::string(TxtAppVer)), aListSub(), aListPub()
+	transport(TxtMqttTransport::create(host, port, clientNamePrefix+clientname+"V"+std::string(TxtAppVer), mqtt_user, mqtt_pass)),
+	policy(iqos, bretained), outbox("Data/Outbox." + clientname + ".bin"), pubQueue(*transport), router(), m_mutexConnect(), ready(false), tsLost(), tsSubscribe(), connStats(),
+	m_mutexCorr(), corrSession((uint32_t)(getnowtimestamp_ns() / 1000000)), corrNext(0), cidReceived(), corrRttSum_ms(0.0), corrRttCount(0)
 	//client name exist only once!
 {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttFactoryClient clientname:{} host:{} port:{} mqtt_user:{}", clientNamePrefix+clientname, host, port, mqtt_user);
-	connOpts.set_connect_timeout(90);
-	connOpts.set_keep_alive_interval(60);
-	connOpts.set_clean_session(true);
-	connOpts.set_automatic_reconnect(true);
-	//connOpts.set_max_inflight(20);
-	connOpts.set_mqtt_version(MQTTVERSION_3_1_1);
-	connOpts.set_user_name(mqtt_user);
-	connOpts.set_password(mqtt_pass);
-	/*for(unsigned int i = 0; i < mqtt_pass.size(); i++ ) {
-		printf("%02X ", mqtt_pass[i]);
-	}
-	std::cout << std::endl;*/
-
 	if (clientname == "TxtFactoryMain")
 	{
 		char sts[25];
@@ -99,8 +89,7 @@ TxtMqttFactoryClient::TxtMqttFactoryClient(std::string clientname, std::string c
 			try {
 				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_PTUPOS);
 				mqtt::message willmsg_pos(TOPIC_INPUT_PTUPOS, sout_pos.str(), 1, true);
-				mqtt::will_options will_pos(willmsg_pos);
-				connOpts.set_will(will_pos);
+				transport->setWill(willmsg_pos);
 				spdlog::get("console")->info("willmsg_ptupos: ", sout_pos.str());
 			} catch (const mqtt::exception& exc) {
 				std::cout << "publishPtuPos: " << exc.what() << " "
@@ -115,22 +104,43 @@ TxtMqttFactoryClient::TxtMqttFactoryClient(std::string clientname, std::string c
 	pthread_mutexattr_init(&attr);
 	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 	pthread_mutex_init(&m_mutex, &attr);
+	pthread_mutex_init(&m_mutexConnect, &attr);
+	pthread_mutex_init(&m_mutexCorr, &attr);
+	memset(&corrStats, 0, sizeof(corrStats));
+	for (int i = 0; i < CORR_HISTORY; i++) {
+		corrSent[i].acked = true;
+	}
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_init",0);
+
+	pubQueue.setPolicy(&policy);
+	if (outbox.open()) {
+		pubQueue.setOutbox(&outbox);
+	} else {
+		spdlog::get("console")->warn("outbox not available, messages are lost on disconnect");
+	}
+	station = clientname.compare(0, 10, "TxtFactory") == 0 ? clientname.substr(10) : clientname;
+	std::transform(station.begin(), station.end(), station.begin(), ::tolower);
+	setMetricsPeriod(METRICS_PERIOD_MS);
+	pubQueue.startThread();
 }
 
 TxtMqttFactoryClient::~TxtMqttFactoryClient() {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtMqttFactoryClient",0);
 	disconnect(1000);
+	pubQueue.stopThread();
+	pthread_mutex_destroy(&m_mutexCorr);
+	pthread_mutex_destroy(&m_mutexConnect);
 	pthread_mutex_destroy(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_destroy",0);
 }
 
 bool TxtMqttFactoryClient::connect(long int timeout) {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "connect",0);
+	pthread_mutex_lock(&m_mutexConnect);
+	tsLost = std::chrono::steady_clock::now();
+	pthread_mutex_unlock(&m_mutexConnect);
 	try {
-		mqtt::token_ptr conntok = cli.connect(connOpts);
-		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "conntok->wait_for {}", timeout);
-		return conntok->wait_for(timeout);
+		return transport->connect(timeout);
 	/*} catch (const mqtt::security_exception& exc) {
 		std::cout << "security_exception: " << exc.what() << std::endl;
 	} catch (const mqtt::persistence_exception& exc) {
@@ -142,83 +152,161 @@ bool TxtMqttFactoryClient::connect(long int timeout) {
 	return false;
 }
 
-void TxtMqttFactoryClient::unsubTopic(const std::string& topicFilter, long int timeout)
-{
-	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "topic: {}", topicFilter);
-	mqtt::token_ptr conntok = cli.unsubscribe(topicFilter);
-	bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-	if (!r) exit(1);
-#endif
+int TxtMqttFactoryClient::setMqttVersion(int version) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setMqttVersion {}", version);
+	int used = transport->setMqttVersion(version);
+	if (used != version) {
+		spdlog::get("console")->warn("mqtt version {} not supported, using 3.1.1", version);
+	}
+	return used;
+}
+
+bool TxtMqttFactoryClient::readCid(mqtt::const_message_ptr msg, std::string& cid, int& code) {
+	const std::string& payload = msg->get_payload();
+	TxtJsonReader r(payload.data(), payload.size());
+	if (!r.beginObject()) return false;
+	bool found = false;
+	const char* key;
+	size_t len;
+	while (r.nextMember(key, len)) {
+		if ((len == 3) && (memcmp(key, "cid", 3) == 0)) {
+			found = r.readString(cid);
+		} else if ((len == 4) && (memcmp(key, "code", 4) == 0)) {
+			r.readInt(code);
+		} else {
+			r.skipValue();
+		}
+	}
+	return found && r.ok();
+}
+
+static const char* getVgrDoStation(int code) {
+	switch (code) {
+	case VGR_HBW_FETCHCONTAINER:
+	case VGR_HBW_STORE_WP:
+	case VGR_HBW_FETCH_WP:
+	case VGR_HBW_STORECONTAINER:
+	case VGR_HBW_RESETSTORAGE:
+	case VGR_HBW_CALIB: return "hbw";
+	case VGR_MPO_PRODUCE: return "mpo";
+	case VGR_SLD_START:
+	case VGR_SLD_CALIB: return "sld";
+	default: return ""; // VGR_EXIT: all stations
+	}
+}
+
+bool TxtMqttFactoryClient::dispatch(mqtt::const_message_ptr msg) {
+	switch (TxtMqttTopicRouter::lookup(msg->get_topic())) {
+	case TOPIC_ID_LOCAL_VGR_DO:
+	{
+		std::string cid;
+		int code = -1;
+		readCid(msg, cid, code);
+		const char* target = getVgrDoStation(code);
+		if ((target[0] == 0) || (station == target)) {
+			pthread_mutex_lock(&m_mutexCorr);
+			cidReceived = cid;
+			pthread_mutex_unlock(&m_mutexCorr);
+		}
+		break;
+	}
+	case TOPIC_ID_LOCAL_MPO_ACK:
+	case TOPIC_ID_LOCAL_HBW_ACK:
+	case TOPIC_ID_LOCAL_HBW_FAULT:
+	case TOPIC_ID_LOCAL_SLD_ACK:
+		correlate(msg);
+		break;
+	default:
+		break;
+	}
+	return router.dispatch(msg);
+}
+
+void TxtMqttFactoryClient::correlate(mqtt::const_message_ptr msg) {
+	std::string cid;
+	int code = -1;
+	bool hasCid = readCid(msg, cid, code);
+	auto now = std::chrono::steady_clock::now();
+	pthread_mutex_lock(&m_mutexCorr);
+	if (!hasCid || cid.empty()) {
+		corrStats.legacy++;
+	} else {
+		int i = 0;
+		for (; i < CORR_HISTORY; i++) {
+			if (corrSent[i].cid == cid) break;
+		}
+		if (i == CORR_HISTORY) {
+			corrStats.unmatched++;
+			spdlog::get("console")->warn("{}: ack code {} of unknown request {}", msg->get_topic(), code, cid);
+		} else {
+			corrStats.acks++;
+			if (!corrSent[i].acked) {
+				//several acks per request (calibration), the first one counts
+				corrSent[i].acked = true;
+				double dt_ms = std::chrono::duration<double, std::milli>(now - corrSent[i].tsSent).count();
+				corrRttSum_ms += dt_ms;
+				corrRttCount++;
+				if (dt_ms > corrStats.rttMax_ms) corrStats.rttMax_ms = dt_ms;
+				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "{} {} code {}: {}ms", msg->get_topic(), cid, code, dt_ms);
+			}
+		}
+	}
+	pthread_mutex_unlock(&m_mutexCorr);
+}
+
+std::string TxtMqttFactoryClient::getAckCid() {
+	pthread_mutex_lock(&m_mutexCorr);
+	std::string cid = cidReceived;
+	pthread_mutex_unlock(&m_mutexCorr);
+	return cid;
+}
+
+TxtMqttCorrelationStats TxtMqttFactoryClient::getCorrelationStats() {
+	pthread_mutex_lock(&m_mutexCorr);
+	TxtMqttCorrelationStats s = corrStats;
+	s.rttAvg_ms = (corrRttCount > 0) ? corrRttSum_ms / corrRttCount : 0.0;
+	pthread_mutex_unlock(&m_mutexCorr);
+	return s;
+}
+
+void TxtMqttFactoryClient::setMinIntervals(const Json::Value& js) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setMinIntervals",0);
+	if (!js.isObject()) return;
+	for (auto const& topic : js.getMemberNames()) {
+		long interval_ms = js[topic].asInt();
+		std::cout << "min interval " << topic << ": " << interval_ms << "ms" << std::endl;
+		pubQueue.setMinInterval(topic, interval_ms);
+	}
 }
 
 void TxtMqttFactoryClient::disconnect(long int timeout) {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "disconnect",0);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock disconnect",0);
+	if (!pubQueue.flush(timeout)) {
+		spdlog::get("console")->warn("disconnect: publish queue not empty");
+	}
+	router.printStats();
+	TxtMqttConnectStats cs = getConnectStats();
+	spdlog::get("console")->info("mqtt connects:{} subscribed:{} failed:{} ready avg:{}ms max:{}ms",
+			cs.connects, cs.subscribed, cs.failed, cs.readyAvg_ms, cs.readyMax_ms);
+	TxtMqttPublishStats ps = pubQueue.getStats();
+	spdlog::get("console")->info("outbox depth:{} max:{} overflow:{} parked:{} late:{} replays:{} replayed:{} replay last:{}ms max:{}ms",
+			ps.outbox.depth, ps.outbox.depthMax, ps.outbox.overflow, ps.parked, ps.late, ps.replays, ps.replayed, ps.replay_ms, ps.replayMax_ms);
+	TxtMqttCorrelationStats rs = getCorrelationStats();
+	if ((rs.requests > 0) || (rs.acks + rs.unmatched + rs.legacy > 0)) {
+		spdlog::get("console")->info("fl/vgr/do requests:{} acks:{} unmatched:{} legacy:{} rtt avg:{}ms max:{}ms",
+				rs.requests, rs.acks, rs.unmatched, rs.legacy, rs.rttAvg_ms, rs.rttMax_ms);
+	}
 	try {
 		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "unsubscribe",0);
 
-		if (clientname == "TxtFactoryMain")
-		{
-			//remote
-			unsubTopic(TOPIC_CONFIG_LINK, timeout);
-			unsubTopic(TOPIC_CONFIG_BME680, timeout);
-			unsubTopic(TOPIC_CONFIG_LDR, timeout);
-			unsubTopic(TOPIC_CONFIG_CAM, timeout);
-			unsubTopic(TOPIC_OUTPUT_PTU, timeout);
-			//local
-			unsubTopic(TOPIC_LOCAL_BROADCAST, timeout);
-			unsubTopic(TOPIC_INPUT_STATE_VGR, timeout);
-			unsubTopic(TOPIC_INPUT_STATE_HBW, timeout);
-			unsubTopic(TOPIC_INPUT_STATE_MPO, timeout);
-			unsubTopic(TOPIC_INPUT_STATE_SLD, timeout);
-			unsubTopic(TOPIC_INPUT_STATE_DSI, timeout);
-			unsubTopic(TOPIC_INPUT_STATE_DSO, timeout);
-		}
-		else if (clientname == "TxtFactoryMPO")
-		{
-			//remote
-			unsubTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			//local
-			unsubTopic(TOPIC_LOCAL_VGR_DO, timeout);
-		}
-		else if (clientname == "TxtFactoryHBW")
-		{
-			//remote
-			unsubTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			//local
-			unsubTopic(TOPIC_LOCAL_VGR_DO, timeout);
-			unsubTopic(TOPIC_LOCAL_SSC_JOY, timeout);
-		}
-		else if (clientname == "TxtFactoryVGR")
-		{
-			//remote
-			unsubTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			unsubTopic(TOPIC_OUTPUT_ORDER, timeout);
-			unsubTopic(TOPIC_OUTPUT_PICKUP, timeout);
-			unsubTopic(TOPIC_OUTPUT_STORE, timeout);
-			unsubTopic(TOPIC_OUTPUT_NFC_DS, timeout);
-			//local
-			unsubTopic(TOPIC_LOCAL_SSC_JOY, timeout);
-			unsubTopic(TOPIC_LOCAL_MPO_ACK, timeout);
-			unsubTopic(TOPIC_LOCAL_HBW_ACK, timeout);
-			unsubTopic(TOPIC_LOCAL_HBW_FAULT, timeout);
-			unsubTopic(TOPIC_LOCAL_SLD_ACK, timeout);
-		}
-		else if (clientname == "TxtFactorySLD")
-		{
-			//remote
-			unsubTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			//local
-			unsubTopic(TOPIC_LOCAL_SSC_JOY, timeout);
-			unsubTopic(TOPIC_LOCAL_MPO_ACK, timeout);
-			unsubTopic(TOPIC_LOCAL_VGR_DO, timeout);
-	}
-		else
-		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "Error: unknown name: {}",clientname);
-			exit(1);
+		ready = false;
+		std::vector<std::string> topics = router.getTopics();
+		if (!topics.empty()) {
+			if (!transport->unsubscribe(topics, timeout)) {
+				spdlog::get("console")->warn("disconnect: timeout unsubscribe {} topics", topics.size());
+			}
 		}
 
 		//stop_consuming
@@ -226,11 +314,9 @@ void TxtMqttFactoryClient::disconnect(long int timeout) {
 		//cli.stop_consuming();
 
 		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "disconnect",0);
-		mqtt::token_ptr conntok = cli.disconnect();
-		bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-		if (!r) exit(1);
-#endif
+		if (!transport->disconnect(timeout)) {
+			spdlog::get("console")->warn("disconnect: timeout");
+		}
 
 	} catch (const mqtt::exception& exc) {
 		std::cout << "disconnect main: " << exc.what() << " "
@@ -240,16 +326,6 @@ void TxtMqttFactoryClient::disconnect(long int timeout) {
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock disconnect",0);
 }
 
-void TxtMqttFactoryClient::subTopic(const std::string& topicFilter, long int timeout)
-{
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", topicFilter);
-	mqtt::token_ptr conntok_link = cli.subscribe(topicFilter, 1, nullptr, aListSub);
-	/*bool rc_link = conntok_link->wait_for(timeout);
-	if (!rc_link) {
-		std::cout << "Timeout: " << std::endl;
-	}*/
-}
-
 bool TxtMqttFactoryClient::start_consume(long int timeout) {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "start_consume",0);
 	pthread_mutex_lock(&m_mutex);
@@ -265,67 +341,21 @@ bool TxtMqttFactoryClient::start_consume(long int timeout) {
 		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "subscribe",0);
 		//cli.subscribe("#", 1, nullptr, aListSub);
 
-		if (clientname == "TxtFactoryMain")
-		{
-			//remote
-			subTopic(TOPIC_CONFIG_LINK, timeout);
-			subTopic(TOPIC_CONFIG_BME680, timeout);
-			subTopic(TOPIC_CONFIG_LDR, timeout);
-			subTopic(TOPIC_CONFIG_CAM, timeout);
-			subTopic(TOPIC_OUTPUT_PTU, timeout);
-			//local
-			subTopic(TOPIC_LOCAL_BROADCAST, timeout);
-			subTopic(TOPIC_INPUT_STATE_VGR, timeout);
-			subTopic(TOPIC_INPUT_STATE_HBW, timeout);
-			subTopic(TOPIC_INPUT_STATE_MPO, timeout);
-			subTopic(TOPIC_INPUT_STATE_SLD, timeout);
-			subTopic(TOPIC_INPUT_STATE_DSI, timeout);
-			subTopic(TOPIC_INPUT_STATE_DSO, timeout);
-		}
-		else if (clientname == "TxtFactoryMPO")
-		{
-			//remote
-			subTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			//local
-			subTopic(TOPIC_LOCAL_VGR_DO, timeout);
-		}
-		else if (clientname == "TxtFactoryHBW")
-		{
-			//remote
-			subTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			//local
-			subTopic(TOPIC_LOCAL_VGR_DO, timeout);
-			subTopic(TOPIC_LOCAL_SSC_JOY, timeout);
-		}
-		else if (clientname == "TxtFactoryVGR")
-		{
-			//remote
-			subTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			subTopic(TOPIC_OUTPUT_ORDER, timeout);
-			subTopic(TOPIC_OUTPUT_PICKUP, timeout);
-			subTopic(TOPIC_OUTPUT_STORE, timeout);
-			subTopic(TOPIC_OUTPUT_NFC_DS, timeout);
-			//local
-			subTopic(TOPIC_LOCAL_SSC_JOY, timeout);
-			subTopic(TOPIC_LOCAL_MPO_ACK, timeout);
-			subTopic(TOPIC_LOCAL_HBW_ACK, timeout);
-			subTopic(TOPIC_LOCAL_HBW_FAULT, timeout);
-			subTopic(TOPIC_LOCAL_SLD_ACK, timeout);
-		}
-		else if (clientname == "TxtFactorySLD")
-		{
-			//remote
-			subTopic(TOPIC_OUTPUT_STATE_ACK, timeout);
-			//local
-			subTopic(TOPIC_LOCAL_SSC_JOY, timeout);
-			subTopic(TOPIC_LOCAL_MPO_ACK, timeout);
-			subTopic(TOPIC_LOCAL_VGR_DO, timeout);
-		}
-		else
-		{
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "Error: unknown name: {}",clientname);
-			exit(1);
+		std::vector<std::string> topics = router.getTopics();
+		pthread_mutex_lock(&m_mutexConnect);
+		ready = false;
+		connStats.connects++;
+		tsSubscribe = std::chrono::steady_clock::now();
+		pthread_mutex_unlock(&m_mutexConnect);
+		if (topics.empty()) {
+			spdlog::get("console")->warn("start_consume: no topic handlers registered for {}", clientname);
+			subscribed(true);
+		} else {
+			//all topics in one SUBSCRIBE, do not wait here: this is called from the paho callback thread
+			transport->subscribe(topics, 1, [this](bool ok) { subscribed(ok); });
 		}
+		//messages not acknowledged before the disconnect or the last shutdown
+		pubQueue.replay();
 
 		ret = true;
 	} catch (const mqtt::exception& exc) {
@@ -337,6 +367,44 @@ bool TxtMqttFactoryClient::start_consume(long int timeout) {
 	return ret;
 }
 
+void TxtMqttFactoryClient::connection_lost(const std::string& cause) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "connection_lost: {}", cause);
+	pthread_mutex_lock(&m_mutexConnect);
+	ready = false;
+	tsLost = std::chrono::steady_clock::now();
+	pthread_mutex_unlock(&m_mutexConnect);
+}
+
+void TxtMqttFactoryClient::subscribed(bool ok) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "subscribed ok:{}", ok);
+	auto now = std::chrono::steady_clock::now();
+	pthread_mutex_lock(&m_mutexConnect);
+	if (ok) {
+		double suback_ms = std::chrono::duration<double, std::milli>(now - tsSubscribe).count();
+		double ready_ms = std::chrono::duration<double, std::milli>(now - tsLost).count();
+		connStats.subscribed++;
+		connStats.suback_ms = suback_ms;
+		connStats.ready_ms = ready_ms;
+		connStats.readyAvg_ms += (ready_ms - connStats.readyAvg_ms) / connStats.subscribed;
+		if (ready_ms > connStats.readyMax_ms) connStats.readyMax_ms = ready_ms;
+		ready = true;
+		pthread_mutex_unlock(&m_mutexConnect);
+		spdlog::get("console")->info("mqtt ready: {} ms (SUBACK {} ms)", ready_ms, suback_ms);
+	} else {
+		connStats.failed++;
+		pthread_mutex_unlock(&m_mutexConnect);
+		spdlog::get("console")->warn("mqtt subscribe failed");
+		spdlog::get("file_logger")->error("mqtt subscribe failed",0);
+	}
+}
+
+TxtMqttConnectStats TxtMqttFactoryClient::getConnectStats() {
+	pthread_mutex_lock(&m_mutexConnect);
+	TxtMqttConnectStats st = connStats;
+	pthread_mutex_unlock(&m_mutexConnect);
+	return st;
+}
+
 void TxtMqttFactoryClient::publishLDR(double timestamp_s, int16_t ldr, long timeout) {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishLDR ldr:{} timeout:{}", ldr, timeout);
 	pthread_mutex_lock(&m_mutex);
@@ -346,35 +414,30 @@ void TxtMqttFactoryClient::publishLDR(double timestamp_s, int16_t ldr, long time
 	}
 	char sts[25];
 	ft::gettimestampstr(timestamp_s*1000000000., sts);
-	Json::Value js_ldr;
-	Json::Value js_br100;
-	std::ostringstream sout_ldr;
+	float br = (15000 - ldr)/150.f;
+	char sbr[32];
+	int nbr = ftoa(br, 1, sbr, sizeof(sbr));
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("br").valueString(sbr, nbr);
+	jw.key("ldr").valueInt(ldr);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_sldr;
 	try {
-		js_ldr["ts"] = sts;
-		js_ldr["ldr"] = ldr;
-		float br = (15000 - ldr)/150.f;
-		js_ldr["br"] = ftos(br, 1);
-		sout_ldr << js_ldr;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_LDR);
-			auto msg_sldr = mqtt::make_message(TOPIC_INPUT_LDR, sout_ldr.str());//sldr.c_str());
-			msg_sldr->set_qos(iqos);
-			msg_sldr->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish ldr: {} ldr:{} br:{}", sts, ldr, br);
-			mqtt::token_ptr conntok = cli.publish(msg_sldr, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishLDR: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_LDR);
+		msg_sldr = mqtt::make_message(TOPIC_INPUT_LDR, jw.str());
+		policy.apply(msg_sldr);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish ldr: {} ldr:{} br:{}", sts, ldr, br);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishLDR: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishLDR",0);
+	if (msg_sldr) {
+		pubQueue.push(msg_sldr, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishPtuPos(float pan, float tilt, long timeout) {
@@ -383,67 +446,78 @@ void TxtMqttFactoryClient::publishPtuPos(float pan, float tilt, long timeout) {
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishPtuPos",0);
 	char sts[25];
 	ft::getnowstr(sts);
-	Json::Value js_pos;
-	std::ostringstream sout_pos;
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("pan").valueDouble(pan);
+	jw.key("tilt").valueDouble(tilt);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_spos;
 	try {
-		js_pos["ts"] = sts;
-		js_pos["pan"] = pan;
-		js_pos["tilt"] = tilt;
-		sout_pos << js_pos;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_PTUPOS);
-			auto msg_spos = mqtt::make_message(TOPIC_INPUT_PTUPOS, sout_pos.str());//spos.c_str());
-			msg_spos->set_qos(iqos);
-			msg_spos->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish PTU pos: {} {} {}", sts, pan, tilt);
-			mqtt::token_ptr conntok = cli.publish(msg_spos, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishPtuPos: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_PTUPOS);
+		msg_spos = mqtt::make_message(TOPIC_INPUT_PTUPOS, jw.str());
+		policy.apply(msg_spos);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish PTU pos: {} {} {}", sts, pan, tilt);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishPtuPos: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishPtuPos",0);
+	if (msg_spos) {
+		pubQueue.push(msg_spos, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishCam(const std::string sdata, long timeout) {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishCam timeout:{}",timeout);
-	pthread_mutex_lock(&m_mutex);
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishCam",0);
+	//no m_mutex: image data is large, do not hold up the other publishers
 	char sts[25];
 	ft::getnowstr(sts);
-	Json::Value js_cam;
-	std::ostringstream sout_cam;
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("data").valueString(sdata);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
 	try {
-		js_cam["ts"] = sts;
-		js_cam["data"] = sdata;
-		sout_cam << js_cam;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_CAM);
-			auto msg_im = mqtt::make_message(TOPIC_INPUT_CAM, sout_cam.str());//sim.c_str());
-			msg_im->set_qos(0);
-			msg_im->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Cam: {}", sts);
-			mqtt::token_ptr conntok = cli.publish(msg_im, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishCam: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_CAM);
+		auto msg_im = mqtt::make_message(TOPIC_INPUT_CAM, jw.str());
+		policy.apply(msg_im);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Cam: {}", sts);
+		pubQueue.push(msg_im, timeout);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishCam: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
+	}
+}
+
+void TxtMqttFactoryClient::publishCamJpg(int64_t ts_ns, uint32_t seq, uint16_t width, uint16_t height, std::string&& data, long timeout) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishCamJpg seq:{} size:{} timeout:{}", seq, data.size(), timeout);
+	//no m_mutex: image data is large, do not hold up the other publishers
+	if (data.size() < CAM_JPG_HEADER_SIZE) {
+		spdlog::get("console")->warn("publishCamJpg: missing header, size:{}", data.size());
+		return;
+	}
+	char* p = &data[0];
+	for (int i = 0; i < 8; i++) {
+		p[i] = (char)((uint64_t)ts_ns >> (8*i));
+	}
+	for (int i = 0; i < 4; i++) {
+		p[8+i] = (char)(seq >> (8*i));
+	}
+	p[12] = (char)(width & 0xFF);
+	p[13] = (char)(width >> 8);
+	p[14] = (char)(height & 0xFF);
+	p[15] = (char)(height >> 8);
+	try {
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_CAM_JPG);
+		auto msg_jpg = mqtt::make_message(TOPIC_INPUT_CAM_JPG, mqtt::binary_ref(std::move(data)));
+		policy.apply(msg_jpg);
+		pubQueue.push(msg_jpg, timeout);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishCamJpg: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
-	pthread_mutex_unlock(&m_mutex);
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishCam",0);
 }
 
 void TxtMqttFactoryClient::publishBme680(int64_t timestamp, float iaq, uint8_t iaq_accuracy, float temperature, float humidity,
@@ -456,85 +530,104 @@ void TxtMqttFactoryClient::publishBme680(int64_t timestamp, float iaq, uint8_t i
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishBme680",0);
 	char sts[25];
 	ft::gettimestampstr(timestamp, sts);
-	Json::Value js_bme680;
-	std::ostringstream sout_bme680;
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("aq").valueInt(iaq_accuracy);
+	jw.key("gr").valueDouble(ft::ftod(gas, 0));
+	jw.key("h").valueDouble(ft::ftod(humidity, 1));
+	jw.key("iaq").valueDouble(ft::ftod(iaq, 0));
+	jw.key("p").valueDouble(ft::ftod(pressure/100, 1));
+	jw.key("rh").valueDouble(ft::ftod(raw_humidity, 2));
+	jw.key("rt").valueDouble(ft::ftod(raw_temperature, 2));
+	jw.key("t").valueDouble(ft::ftod(temperature, 1));
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_bme680;
 	try {
-		js_bme680["ts"] = sts;
-		js_bme680["t"] = fromString<double>(ft::ftos(temperature, 1));
-		js_bme680["rt"] = fromString<double>(ft::ftos(raw_temperature, 2));
-		js_bme680["h"] = fromString<double>(ft::ftos(humidity, 1));
-		js_bme680["rh"] = fromString<double>(ft::ftos(raw_humidity, 2));
-		js_bme680["p"] = fromString<double>(ft::ftos(pressure/100, 1));
-		js_bme680["iaq"] = fromString<double>(ft::ftos(iaq, 0));
-		js_bme680["aq"] = iaq_accuracy;
-		js_bme680["gr"] = fromString<double>(ft::ftos(gas, 0));
-		sout_bme680 << js_bme680;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_BME680);
-			auto msg_bme680 = mqtt::make_message(TOPIC_INPUT_BME680, sout_bme680.str());//sbme680);
-			msg_bme680->set_qos(iqos);
-			msg_bme680->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish BME680: {} {} {} {} {} {} {} {} {}",
-					sts, ft::ftos(temperature, 1), ft::ftos(raw_temperature, 2),
-					ft::ftos(humidity, 1), ft::ftos(raw_humidity, 2),
-					ft::ftos(pressure/100, 1), ft::ftos(iaq, 0),
-					iaq_accuracy, ft::ftos(gas, 0));
-			mqtt::token_ptr conntok = cli.publish(msg_bme680, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishBme680: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_BME680);
+		msg_bme680 = mqtt::make_message(TOPIC_INPUT_BME680, jw.str());
+		policy.apply(msg_bme680);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish BME680: {} {} {} {} {} {} {} {} {}",
+				sts, ft::ftos(temperature, 1), ft::ftos(raw_temperature, 2),
+				ft::ftos(humidity, 1), ft::ftos(raw_humidity, 2),
+				ft::ftos(pressure/100, 1), ft::ftos(iaq, 0),
+				iaq_accuracy, ft::ftos(gas, 0));
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishBme680: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishBme680",0);
+	if (msg_bme680) {
+		pubQueue.push(msg_bme680, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishAlert(bool st, const std::string id, const std::string sdata, int code, long timeout)
 {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishAlert {} {} timeout:{}",
 			id,code,timeout);
-	pthread_mutex_lock(&m_mutex);
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishAlert",0);
-	Json::Value js_alert;
-	std::ostringstream sout_alert;
+	//no m_mutex: image data is large, do not hold up the other publishers
 	char sts[25];
 	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("code").valueInt(code);
+	if (st) {
+		jw.key("data").valueString(sdata);
+	} else {
+		jw.key("data").valueDouble(fromString<double>(sdata));
+	}
+	jw.key("id").valueString(id);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
 	try {
-		js_alert["ts"] = sts;
-		js_alert["id"] = id;
-		if (st) {
-			js_alert["data"] = sdata;
-		} else {
-			js_alert["data"] = fromString<double>(sdata);
-		}
-		js_alert["code"] = code;
-		sout_alert << js_alert;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_ALERT);
-			auto msg_alert = mqtt::make_message(TOPIC_INPUT_ALERT, sout_alert.str());
-			msg_alert->set_qos(iqos);
-			msg_alert->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Alert: {} {} {}", sts, id, code);
-			mqtt::token_ptr conntok = cli.publish(msg_alert, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishAlert: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_ALERT);
+		auto msg_alert = mqtt::make_message(TOPIC_INPUT_ALERT, jw.str());
+		policy.apply(msg_alert);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Alert: {} {} {}", sts, id, code);
+		pubQueue.push(msg_alert, timeout, st ? LANE_BULK : LANE_STATE);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishAlert: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
+	}
+}
+
+void TxtMqttFactoryClient::publishAlertClip(const std::string id, const std::string clip, int code, long timeout)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishAlertClip {} {} {} timeout:{}",
+			id,clip,code,timeout);
+	char sts[25];
+	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("clip").valueString(clip);
+	jw.key("code").valueInt(code);
+	jw.key("id").valueString(id);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	try {
+		auto msg_alert = mqtt::make_message(TOPIC_INPUT_ALERT, jw.str());
+		policy.apply(msg_alert);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Alert: {} {} {} clip:{}", sts, id, code, clip);
+		pubQueue.push(msg_alert, timeout, LANE_STATE);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishAlertClip: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
+	}
+}
+
+static void writeWorkpiece(TxtJsonWriter& jw, const TxtWorkpiece* wp)
+{
+	if (wp) {
+		jw.beginObject();
+		jw.key("id").valueString(wp->tag_uid);
+		jw.key("state").valueString(toString(wp->state));
+		jw.key("type").valueString(toString(wp->type));
+		jw.endObject();
+	} else {
+		jw.valueNull();
 	}
-	pthread_mutex_unlock(&m_mutex);
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishAlert",0);
 }
 
 std::string getMAC(const char* sdev)
@@ -560,41 +653,35 @@ void TxtMqttFactoryClient::publishBroadcast(double timestamp_s, const std::strin
 			timestamp_s,ver,message, timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishBroadcast",0);
-	Json::Value js_broadcast;
-	std::ostringstream sout_broadcast;
 	char sts[25];
 	ft::gettimestampstr(timestamp_s*1000000000., sts);
+	// read device MAC id
+	std::string macWlan0 = getMAC("wlan0"); //MAC
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("hardwareId").valueString(macWlan0);
+	jw.key("hardwareModel").valueString("TXT");
+	jw.key("message").valueString(message);
+	jw.key("softwareName").valueString(sw);
+	jw.key("softwareVersion").valueString(ver);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "str: {}",jw.str());
+	mqtt::message_ptr msg_broadcast;
 	try {
-		js_broadcast["ts"] = sts;
-	    // read device MAC id
-	    std::string macWlan0 = getMAC("wlan0"); //MAC
-		js_broadcast["hardwareId"] = macWlan0;
-		js_broadcast["hardwareModel"] = "TXT";
-		js_broadcast["softwareName"] = sw;
-		js_broadcast["softwareVersion"] = ver;
-		js_broadcast["message"] = message;
-		sout_broadcast << js_broadcast;
-		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "str: {}",sout_broadcast.str());
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_BROADCAST);
-			auto msg_broadcast = mqtt::make_message(TOPIC_INPUT_BROADCAST, sout_broadcast.str());
-			msg_broadcast->set_qos(iqos);
-			msg_broadcast->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Broadcast: {}", sts);
-			mqtt::token_ptr conntok = cli.publish(msg_broadcast, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishBroascast: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_BROADCAST);
+		msg_broadcast = mqtt::make_message(TOPIC_INPUT_BROADCAST, jw.str());
+		policy.apply(msg_broadcast);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Broadcast: {}", sts);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishBroascast: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishBroadcast",0);
+	if (msg_broadcast) {
+		pubQueue.push(msg_broadcast, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishStateStation(const std::string station, TxtLEDSCode_t code, const std::string desc, long timeout, int active, const std::string target)
@@ -602,47 +689,44 @@ void TxtMqttFactoryClient::publishStateStation(const std::string station, TxtLED
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishStateStation station:{} code:{} desc:{} timeout:{} active:{} target:{}", station, (int)code, desc, timeout, active, target);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishStateStation",0);
-	Json::Value js_stateStation;
-	std::ostringstream sout_stateStation;
 	char sts[25];
 	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("active").valueInt(active);
+	jw.key("code").valueInt((int)code);
+	jw.key("description").valueString(desc);
+	jw.key("station").valueString(station);
+	if (station=="vgr")
+	{
+		jw.key("target").valueString(target);
+	}
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_stateStation;
+	std::string key;
 	try {
-		js_stateStation["ts"] = sts;
-		js_stateStation["station"] = station;
-		js_stateStation["code"] = (int)code;
-		js_stateStation["description"] = desc;
-		js_stateStation["active"] = active;
-		if (station=="vgr")
+		//HBW, VGR, MPO, SLD; DSI, DSO
+		if ((station=="hbw")||(station=="vgr")||(station=="mpo")||(station=="sld")||
+				(station=="dsi")||(station=="dso"))
 		{
-			js_stateStation["target"] = target;
+			mqtt::string topic = TOPIC_INPUT_STATE_ + station;
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", topic);
+			msg_stateStation = mqtt::make_message(topic, jw.str());
+			policy.apply(msg_stateStation);
+			key = target.empty() ? topic : topic + "/" + target;
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state station: {} {} {} {} {} {}", sts, station, (int)code, desc, active, target);
 		}
-		sout_stateStation << js_stateStation;
-		try {
-			//HBW, VGR, MPO, SLD; DSI, DSO
-			if ((station=="hbw")||(station=="vgr")||(station=="mpo")||(station=="sld")||
-					(station=="dsi")||(station=="dso"))
-			{
-				mqtt::string topic = TOPIC_INPUT_STATE_ + station;
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", topic);
-				auto msg_stateStation = mqtt::make_message(topic, sout_stateStation.str());
-				msg_stateStation->set_qos(iqos);
-				msg_stateStation->set_retained(bretained);
-				SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state station: {} {} {} {} {} {}", sts, station, (int)code, desc, active, target);
-				mqtt::token_ptr conntok = cli.publish(msg_stateStation, nullptr, aListPub);
-				bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-				if (!r) exit(1);
-#endif
-			}
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishStateStation: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishStateStation: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishStateStation",0);
+	if (msg_stateStation) {
+		//latest state wins, vgr publishes one state per target
+		pubQueue.pushLatest(msg_stateStation, timeout, key);
+	}
 }
 
 void TxtMqttFactoryClient::publishStock(Stock_map_t map_wps, long timeout)
@@ -650,59 +734,38 @@ void TxtMqttFactoryClient::publishStock(Stock_map_t map_wps, long timeout)
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishStock timeout:{}", timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishStock",0);
-	Json::Value js_stock;
-	std::ostringstream sout_stock;
 	char sts[25];
 	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("stockItems").beginArray();
+	for (Stock_map_t::const_iterator it=map_wps.begin(); it!=map_wps.end(); ++it)
+	{
+		TxtWorkpiece* wp = it->second;
+		jw.beginObject();
+		jw.key("location").valueString(it->first);
+		jw.key("workpiece");
+		writeWorkpiece(jw, wp);
+		jw.endObject();
+	}
+	jw.endArray();
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_stock;
 	try {
-		js_stock["ts"] = sts;
-		Json::Value jsonArray;
-		if (map_wps.size() > 0)
-		{
-		    for (Stock_map_t::const_iterator it=map_wps.begin(); it!=map_wps.end(); ++it)
-		    {
-		    	std::string loc(it->first);
-		    	TxtWorkpiece* wp = it->second;
-		    	Json::Value js_wpRoot;
-				js_wpRoot["location"] = loc;
-		    	if (wp) {
-			    	Json::Value js_wp;
-			    	js_wp["id"] = wp->tag_uid;
-			    	js_wp["type"] = toString(wp->type);
-			    	js_wp["state"] = toString(wp->state);
-			    	js_wpRoot["workpiece"] = js_wp;
-		    	} else {
-			    	js_wpRoot["workpiece"] = Json::Value::null;
-		    	}
-				jsonArray.append(js_wpRoot);
-		    }
-		} else {
-			jsonArray.append(Json::Value::null);
-			jsonArray.clear();
-		}
-		js_stock["stockItems"] = jsonArray;
-		sout_stock << js_stock;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STOCK);
-			auto msg_stock = mqtt::make_message(TOPIC_INPUT_STOCK, sout_stock.str());
-			//printf("%s", sout_stock.str().c_str());
-			msg_stock->set_qos(iqos);
-			msg_stock->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish stock: {} {}", sts, jsonArray.size());
-			mqtt::token_ptr conntok = cli.publish(msg_stock, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishStock: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STOCK);
+		msg_stock = mqtt::make_message(TOPIC_INPUT_STOCK, jw.str());
+		policy.apply(msg_stock);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish stock: {} {}", sts, map_wps.size());
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishStock: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishStock",0);
+	if (msg_stock) {
+		pubQueue.pushLatest(msg_stock, timeout, TOPIC_INPUT_STOCK);
+	}
 }
 
 void TxtMqttFactoryClient::publishStateOrder(TxtOrderState ord_state, long timeout)
@@ -710,35 +773,29 @@ void TxtMqttFactoryClient::publishStateOrder(TxtOrderState ord_state, long timeo
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishOrder timeout:{}", timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishOrder",0);
-	Json::Value js_order;
-	std::ostringstream sout_order;
 	char sts[25];
 	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("state").valueString(toString(ord_state.state));
+	jw.key("ts").valueString(sts);
+	jw.key("type").valueString(toString(ord_state.type));
+	jw.endObject();
+	mqtt::message_ptr msg_order;
 	try {
-		js_order["ts"] = sts;
-		js_order["state"] = toString(ord_state.state);
-		js_order["type"] = toString(ord_state.type);
-		sout_order << js_order;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STATE_ORDER);
-			auto msg_order = mqtt::make_message(TOPIC_INPUT_STATE_ORDER, sout_order.str());
-			msg_order->set_qos(iqos);
-			msg_order->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state order: {} {} {}", sts, toString(ord_state.state), toString(ord_state.type));
-			mqtt::token_ptr conntok = cli.publish(msg_order, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishStateOrder: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STATE_ORDER);
+		msg_order = mqtt::make_message(TOPIC_INPUT_STATE_ORDER, jw.str());
+		policy.apply(msg_order);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state order: {} {} {}", sts, toString(ord_state.state), toString(ord_state.type));
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishStateOrder: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishOrder",0);
+	if (msg_order) {
+		pubQueue.push(msg_order, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishStatePickup(TxtOrderState ord_state, long timeout)
@@ -746,36 +803,30 @@ void TxtMqttFactoryClient::publishStatePickup(TxtOrderState ord_state, long time
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishOrder timeout:{}", timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishOrder",0);
-	Json::Value js_order;
-	std::ostringstream sout_order;
 	char sts[25];
 	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("id").valueString(ord_state.tag_uid);
+	jw.key("state").valueString(toString(ord_state.state));
+	jw.key("ts").valueString(sts);
+	jw.key("type").valueString(toString(ord_state.type));
+	jw.endObject();
+	mqtt::message_ptr msg_order;
 	try {
-		js_order["ts"] = sts;
-		js_order["id"] = ord_state.tag_uid;
-		js_order["state"] = toString(ord_state.state);
-		js_order["type"] = toString(ord_state.type);
-		sout_order << js_order;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STATE_PICKUP);
-			auto msg_order = mqtt::make_message(TOPIC_INPUT_STATE_PICKUP, sout_order.str());
-			msg_order->set_qos(iqos);
-			msg_order->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state pickup: {} {} {} {}", sts, ord_state.tag_uid, toString(ord_state.state), toString(ord_state.type));
-			mqtt::token_ptr conntok = cli.publish(msg_order, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishStatePickup: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STATE_PICKUP);
+		msg_order = mqtt::make_message(TOPIC_INPUT_STATE_PICKUP, jw.str());
+		policy.apply(msg_order);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state pickup: {} {} {} {}", sts, ord_state.tag_uid, toString(ord_state.state), toString(ord_state.type));
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishStatePickup: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishPickup",0);
+	if (msg_order) {
+		pubQueue.push(msg_order, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishStateStore(TxtOrderState ord_state, long timeout)
@@ -783,33 +834,27 @@ void TxtMqttFactoryClient::publishStateStore(TxtOrderState ord_state, long timeo
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishStore timeout:{}", timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishOrder",0);
-	Json::Value js_order;
-	std::ostringstream sout_order;
 	char sts[25];
 	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_order;
 	try {
-		js_order["ts"] = sts;
-		sout_order << js_order;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STATE_STORE);
-			auto msg_order = mqtt::make_message(TOPIC_INPUT_STATE_STORE, sout_order.str());
-			msg_order->set_qos(iqos);
-			msg_order->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state store: {}", sts);
-			mqtt::token_ptr conntok = cli.publish(msg_order, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishStateStore: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_STATE_STORE);
+		msg_order = mqtt::make_message(TOPIC_INPUT_STATE_STORE, jw.str());
+		policy.apply(msg_order);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish state store: {}", sts);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishStateStore: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishStore",0);
+	if (msg_order) {
+		pubQueue.push(msg_order, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishNfcDS(TxtWorkpiece wp, History_map_t map_hist, long timeout)
@@ -817,54 +862,103 @@ void TxtMqttFactoryClient::publishNfcDS(TxtWorkpiece wp, History_map_t map_hist,
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishNfcDS timeout:{}", timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishNfcDS",0);
-	Json::Value js_nfcDS;
-	std::ostringstream sout_nfcDS;
 	char sts[25];
 	ft::getnowstr(sts);
-	try {
-		js_nfcDS["ts"] = sts;
-
-		Json::Value js_wp;
-    	js_wp["id"] = wp.tag_uid;
-    	js_wp["type"] = toString(wp.type);
-    	js_wp["state"] = toString(wp.state);
-		js_nfcDS["workpiece"] = js_wp;
-
-		Json::Value jsonArray;
-	    for (History_map_t::const_iterator it=map_hist.begin(); it!=map_hist.end(); ++it)
-	    {
-	    	TxtHistoryCode_t hcode = it->first;
-	    	int64_t hts = it->second;
-			Json::Value js_elem;
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("history");
+	if (map_hist.empty()) {
+		jw.valueNull();
+	} else {
+		jw.beginArray();
+		for (History_map_t::const_iterator it=map_hist.begin(); it!=map_hist.end(); ++it)
+		{
 			char hsts[25];
-			ft::gettimestampstr(hts, hsts);
-	    	js_elem["ts"] = hsts;
-	    	js_elem["code"] = hcode;
-		    jsonArray.append(js_elem);
-	    }
-		js_nfcDS["history"] = jsonArray;
-
-		sout_nfcDS << js_nfcDS;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_NFC_DS);
-			auto msg_nfcDS = mqtt::make_message(TOPIC_INPUT_NFC_DS, sout_nfcDS.str());
-			msg_nfcDS->set_qos(iqos);
-			msg_nfcDS->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish NFC DS: {}", sts);
-			mqtt::token_ptr conntok = cli.publish(msg_nfcDS, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishnfcDS: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
+			ft::gettimestampstr(it->second, hsts);
+			jw.beginObject();
+			jw.key("code").valueInt(it->first);
+			jw.key("ts").valueString(hsts);
+			jw.endObject();
 		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		jw.endArray();
+	}
+	jw.key("ts").valueString(sts);
+	jw.key("workpiece");
+	writeWorkpiece(jw, &wp);
+	jw.endObject();
+	mqtt::message_ptr msg_nfcDS;
+	try {
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_INPUT_NFC_DS);
+		msg_nfcDS = mqtt::make_message(TOPIC_INPUT_NFC_DS, jw.str());
+		policy.apply(msg_nfcDS);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish NFC DS: {}", sts);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishnfcDS: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishNfcDS",0);
+	if (msg_nfcDS) {
+		pubQueue.push(msg_nfcDS, timeout);
+	}
+}
+
+static void writeHistogram(TxtJsonWriter& jw, const uint64_t* hist) {
+	//trailing empty buckets are omitted
+	int n = METRICS_HIST_BUCKETS;
+	while ((n > 0) && (hist[n-1] == 0)) n--;
+	jw.beginArray();
+	for (int b = 0; b < n; b++) {
+		jw.valueInt(hist[b]);
+	}
+	jw.endArray();
+}
+
+void TxtMqttFactoryClient::publishMetrics(long timeout)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishMetrics timeout:{}", timeout);
+	//no m_mutex: called by the publish queue thread, the snapshot is lock-free
+	std::vector<TxtMqttTopicMetrics> vm;
+	pubQueue.getMetrics().getSnapshot(vm);
+	char sts[25];
+	ft::getnowstr(sts);
+	TxtJsonWriter jw;
+	jw.beginObject();
+	jw.key("station").valueString(station);
+	jw.key("topics");
+	jw.beginArray();
+	for (auto const& m : vm) {
+		jw.beginObject();
+		jw.key("ack_max_us").valueInt(m.ackMax_us);
+		jw.key("ack_us");
+		writeHistogram(jw, m.ack_us);
+		jw.key("acked").valueInt(m.acked);
+		jw.key("bytes").valueInt(m.bytes);
+		jw.key("enqueued").valueInt(m.enqueued);
+		jw.key("failed").valueInt(m.failed);
+		jw.key("queue_max_us").valueInt(m.queueMax_us);
+		jw.key("queue_us");
+		writeHistogram(jw, m.queue_us);
+		jw.key("sent").valueInt(m.sent);
+		jw.key("size");
+		writeHistogram(jw, m.size);
+		jw.key("slow").valueInt(m.slow);
+		jw.key("topic").valueString(m.topic);
+		jw.endObject();
+	}
+	jw.endArray();
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	try {
+		std::string topic = TOPIC_INPUT_METRICS_ + station;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", topic);
+		auto msg_metrics = mqtt::make_message(topic, jw.str());
+		policy.apply(msg_metrics);
+		pubQueue.push(msg_metrics, timeout);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishMetrics: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
+	}
 }
 
 void TxtMqttFactoryClient::publishStationBroadcast(const std::string station, double timestamp_s, const std::string sw, const std::string ver, const std::string message, long timeout)
@@ -873,41 +967,35 @@ void TxtMqttFactoryClient::publishStationBroadcast(const std::string station, do
 			station, timestamp_s, ver, message, timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishStationBroadcast",0);
-	Json::Value js_broadcast;
-	std::ostringstream sout_broadcast;
 	char sts[25];
 	ft::gettimestampstr(timestamp_s*1000000000., sts);
+	// read device MAC id
+	std::string macWlan0 = getMAC("wlan0"); //MAC
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("hardwareId").valueString(macWlan0);
+	jw.key("message").valueString(message);
+	jw.key("softwareName").valueString(sw);
+	jw.key("softwareVersion").valueString(ver);
+	jw.key("station").valueString(station);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "str: {}",jw.str());
+	mqtt::message_ptr msg_broadcast;
 	try {
-		js_broadcast["ts"] = sts;
-		js_broadcast["station"] = station;
-	    // read device MAC id
-	    std::string macWlan0 = getMAC("wlan0"); //MAC
-		js_broadcast["hardwareId"] = macWlan0;
-		js_broadcast["softwareName"] = sw;
-		js_broadcast["softwareVersion"] = ver;
-		js_broadcast["message"] = message;
-		sout_broadcast << js_broadcast;
-		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "str: {}",sout_broadcast.str());
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_BROADCAST);
-			auto msg_broadcast = mqtt::make_message(TOPIC_LOCAL_BROADCAST, sout_broadcast.str());
-			msg_broadcast->set_qos(iqos);
-			msg_broadcast->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Broadcast: {}", sts);
-			mqtt::token_ptr conntok = cli.publish(msg_broadcast, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishStationBroadcast: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_BROADCAST);
+		msg_broadcast = mqtt::make_message(TOPIC_LOCAL_BROADCAST, jw.str());
+		policy.apply(msg_broadcast);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish Broadcast: {}", sts);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishStationBroadcast: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishStationBroadcast",0);
+	if (msg_broadcast) {
+		pubQueue.push(msg_broadcast, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishSSC_Joy(TxtJoysticksData jd, long timeout) {
@@ -916,37 +1004,31 @@ void TxtMqttFactoryClient::publishSSC_Joy(TxtJoysticksData jd, long timeout) {
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishSSC_Joy",0);
 	char sts[25];
 	ft::getnowstr(sts);
-	Json::Value js_pos;
-	std::ostringstream sout_pos;
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("aX1").valueInt(jd.aX1);
+	jw.key("aX2").valueInt(jd.aX2);
+	jw.key("aY1").valueInt(jd.aY1);
+	jw.key("aY2").valueInt(jd.aY2);
+	jw.key("b1").valueBool(jd.b1);
+	jw.key("b2").valueBool(jd.b2);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_spos;
 	try {
-		js_pos["ts"] = sts;
-		js_pos["aX1"] = jd.aX1;
-		js_pos["aY1"] = jd.aY1;
-		js_pos["b1"] = jd.b1;
-		js_pos["aX2"] = jd.aX2;
-		js_pos["aY2"] = jd.aY2;
-		js_pos["b2"] = jd.b2;
-		sout_pos << js_pos;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_SSC_JOY);
-			auto msg_spos = mqtt::make_message(TOPIC_LOCAL_SSC_JOY, sout_pos.str());
-			msg_spos->set_qos(iqos);
-			msg_spos->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish joysticks: {} {} {} {} {} {}", sts, jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
-			mqtt::token_ptr conntok = cli.publish(msg_spos, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishSSC_Joy: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_SSC_JOY);
+		msg_spos = mqtt::make_message(TOPIC_LOCAL_SSC_JOY, jw.str());
+		policy.apply(msg_spos);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish joysticks: {} {} {} {} {} {}", sts, jd.aX1, jd.aY1, jd.b1, jd.aX2, jd.aY2, jd.b2);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishSSC_Joy: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishSSC_Joy",0);
+	if (msg_spos) {
+		pubQueue.push(msg_spos, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishMPO_Ack(TxtMpoAckCode_t code, long timeout)
@@ -954,34 +1036,32 @@ void TxtMqttFactoryClient::publishMPO_Ack(TxtMpoAckCode_t code, long timeout)
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishMPO_Ack timeout:{}", timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishMPO_Ack",0);
-	Json::Value js_ack;
-	std::ostringstream sout_ack;
 	char sts[25];
 	ft::getnowstr(sts);
+	std::string cid = getAckCid();
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	if (!cid.empty()) {
+		jw.key("cid").valueString(cid);
+	}
+	jw.key("code").valueInt((int)code);
+	jw.key("ts").valueString(sts);
+	jw.endObject();
+	mqtt::message_ptr msg_ack;
 	try {
-		js_ack["ts"] = sts;
-		js_ack["code"] = (int)code;
-		sout_ack << js_ack;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_MPO_ACK);
-			auto msg_ack = mqtt::make_message(TOPIC_LOCAL_MPO_ACK, sout_ack.str());
-			msg_ack->set_qos(iqos);
-			msg_ack->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {}", sts, (int)code);
-			mqtt::token_ptr conntok = cli.publish(msg_ack, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishMPO_Ack: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_MPO_ACK);
+		msg_ack = mqtt::make_message(TOPIC_LOCAL_MPO_ACK, jw.str());
+		policy.apply(msg_ack);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {}", sts, (int)code);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishMPO_Ack: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishMPO_Ack",0);
+	if (msg_ack) {
+		pubQueue.push(msg_ack, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishVGR_Do(TxtVgrDoCode_t code, TxtWorkpiece* wp, long timeout)
@@ -989,46 +1069,41 @@ void TxtMqttFactoryClient::publishVGR_Do(TxtVgrDoCode_t code, TxtWorkpiece* wp,
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishVGR_Do code:{} timeout:{}", (int)code, timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishVGR_Do",0);
-	Json::Value js_ack;
-	std::ostringstream sout_ack;
 	char sts[25];
 	ft::getnowstr(sts);
+	char cid[24];
+	pthread_mutex_lock(&m_mutexCorr);
+	corrNext++;
+	snprintf(cid, sizeof(cid), "%08x-%u", corrSession, corrNext);
+	CorrRequest_t& req = corrSent[corrNext % CORR_HISTORY];
+	req.cid = cid;
+	req.tsSent = std::chrono::steady_clock::now();
+	req.acked = false;
+	corrStats.requests++;
+	pthread_mutex_unlock(&m_mutexCorr);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("cid").valueString(cid);
+	jw.key("code").valueInt((int)code);
+	jw.key("ts").valueString(sts);
+	jw.key("workpiece");
+	writeWorkpiece(jw, wp);
+	jw.endObject();
+	mqtt::message_ptr msg_ack;
 	try {
-		js_ack["ts"] = sts;
-		js_ack["code"] = (int)code;
-
-		if (wp)
-		{
-			Json::Value js_wp;
-	    	js_wp["id"] = wp->tag_uid;
-	    	js_wp["type"] = toString(wp->type);
-	    	js_wp["state"] = toString(wp->state);
-	    	js_ack["workpiece"] = js_wp;
-		} else {
-	    	js_ack["workpiece"] = Json::Value::null;
-		}
-
-		sout_ack << js_ack;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_VGR_DO);
-			auto msg_ack = mqtt::make_message(TOPIC_LOCAL_VGR_DO, sout_ack.str());
-			msg_ack->set_qos(iqos);
-			msg_ack->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {}", (int)code);
-			mqtt::token_ptr conntok = cli.publish(msg_ack, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishVGR_Do: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_VGR_DO);
+		msg_ack = mqtt::make_message(TOPIC_LOCAL_VGR_DO, jw.str());
+		policy.apply(msg_ack);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {}", (int)code);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishVGR_Do: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishVGR_Do",0);
+	if (msg_ack) {
+		pubQueue.push(msg_ack, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishVGR_Order(TxtWPType_t t, long timeout)
@@ -1036,35 +1111,28 @@ void TxtMqttFactoryClient::publishVGR_Order(TxtWPType_t t, long timeout)
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishVGR_Order  timeout:{}", toString(t), timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishVGR_Order",0);
-	Json::Value js_ack;
-	std::ostringstream sout_ack;
 	char sts[25];
 	ft::getnowstr(sts);
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	jw.key("ts").valueString(sts);
+	jw.key("type").valueString(toString(t));
+	jw.endObject();
+	mqtt::message_ptr msg_ack;
 	try {
-		js_ack["ts"] = sts;
-		js_ack["type"] = toString(t);
-
-		sout_ack << js_ack;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_OUTPUT_ORDER);
-			auto msg_ack = mqtt::make_message(TOPIC_OUTPUT_ORDER, sout_ack.str());
-			msg_ack->set_qos(iqos);
-			msg_ack->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {}", toString(t));
-			mqtt::token_ptr conntok = cli.publish(msg_ack, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishVGR_Order: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_OUTPUT_ORDER);
+		msg_ack = mqtt::make_message(TOPIC_OUTPUT_ORDER, jw.str());
+		policy.apply(msg_ack);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {}", toString(t));
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishVGR_Order: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishVGR_Order",0);
+	if (msg_ack) {
+		pubQueue.push(msg_ack, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishHBW_Ack(TxtHbwAckCode_t code, TxtWorkpiece* wp, long timeout)
@@ -1072,45 +1140,34 @@ void TxtMqttFactoryClient::publishHBW_Ack(TxtHbwAckCode_t code, TxtWorkpiece* wp
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishHBW_Ack code:{} timeout:{}", (int)code, timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishHBW_Ack",0);
-	Json::Value js_ack;
-	std::ostringstream sout_ack;
 	char sts[25];
 	ft::getnowstr(sts);
+	std::string cid = getAckCid();
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	if (!cid.empty()) {
+		jw.key("cid").valueString(cid);
+	}
+	jw.key("code").valueInt((int)code);
+	jw.key("ts").valueString(sts);
+	jw.key("workpiece");
+	writeWorkpiece(jw, wp);
+	jw.endObject();
+	mqtt::message_ptr msg_ack;
 	try {
-		js_ack["ts"] = sts;
-		js_ack["code"] = (int)code;
-
-		if (wp) {
-			Json::Value js_wp;
-			js_wp["id"] = wp->tag_uid;
-			js_wp["type"] = toString(wp->type);
-			js_wp["state"] = toString(wp->state);
-			js_ack["workpiece"] = js_wp;
-		} else {
-			js_ack["workpiece"] = Json::Value::null;
-		}
-
-		sout_ack << js_ack;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_HBW_ACK);
-			auto msg_ack = mqtt::make_message(TOPIC_LOCAL_HBW_ACK, sout_ack.str());
-			msg_ack->set_qos(iqos);
-			msg_ack->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {}", sts, (int)code);
-			mqtt::token_ptr conntok = cli.publish(msg_ack, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishHBW_Ack: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_HBW_ACK);
+		msg_ack = mqtt::make_message(TOPIC_LOCAL_HBW_ACK, jw.str());
+		policy.apply(msg_ack);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {}", sts, (int)code);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishHBW_Ack: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishHBW_Ack",0);
+	if (msg_ack) {
+		pubQueue.push(msg_ack, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishHBW_Fault(TxtHbwAckCode_t code, TxtWorkpiece* wp, long timeout)
@@ -1118,45 +1175,34 @@ void TxtMqttFactoryClient::publishHBW_Fault(TxtHbwAckCode_t code, TxtWorkpiece*
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishHBW_Fault code:{} timeout:{}", (int)code, timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishHBW_Fault",0);
-	Json::Value js_ack;
-	std::ostringstream sout_ack;
 	char sts[25];
 	ft::getnowstr(sts);
+	std::string cid = getAckCid();
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	if (!cid.empty()) {
+		jw.key("cid").valueString(cid);
+	}
+	jw.key("code").valueInt((int)code);
+	jw.key("ts").valueString(sts);
+	jw.key("workpiece");
+	writeWorkpiece(jw, wp);
+	jw.endObject();
+	mqtt::message_ptr msg_ack;
 	try {
-		js_ack["ts"] = sts;
-		js_ack["code"] = (int)code;
-
-		if (wp) {
-			Json::Value js_wp;
-			js_wp["id"] = wp->tag_uid;
-			js_wp["type"] = toString(wp->type);
-			js_wp["state"] = toString(wp->state);
-			js_ack["workpiece"] = js_wp;
-		} else {
-			js_ack["workpiece"] = Json::Value::null;
-		}
-
-		sout_ack << js_ack;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_HBW_FAULT);
-			auto msg_ack = mqtt::make_message(TOPIC_LOCAL_HBW_FAULT, sout_ack.str());
-			msg_ack->set_qos(iqos);
-			msg_ack->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {}", sts, (int)code);
-			mqtt::token_ptr conntok = cli.publish(msg_ack, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishHBW_Fault: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_HBW_FAULT);
+		msg_ack = mqtt::make_message(TOPIC_LOCAL_HBW_FAULT, jw.str());
+		policy.apply(msg_ack);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {}", sts, (int)code);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishHBW_Fault: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishHBW_Ack",0);
+	if (msg_ack) {
+		pubQueue.push(msg_ack, timeout);
+	}
 }
 
 void TxtMqttFactoryClient::publishSLD_Ack(TxtSldAckCode_t code, TxtWPType_t type, int value, long timeout)
@@ -1164,37 +1210,34 @@ void TxtMqttFactoryClient::publishSLD_Ack(TxtSldAckCode_t code, TxtWPType_t type
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "publishSLD_Ack code:{} type:{} value:{} timeout:{}", (int)code, (int)type, value, timeout);
 	pthread_mutex_lock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_lock publishSLD_Ack",0);
-	Json::Value js_ack;
-	std::ostringstream sout_ack;
 	char sts[25];
 	ft::getnowstr(sts);
+	std::string cid = getAckCid();
+	TxtJsonWriter& jw = TxtJsonWriter::local();
+	jw.beginObject();
+	if (!cid.empty()) {
+		jw.key("cid").valueString(cid);
+	}
+	jw.key("code").valueInt((int)code);
+	jw.key("colorValue").valueInt(value);
+	jw.key("ts").valueString(sts);
+	jw.key("type").valueString(toString(type));
+	jw.endObject();
+	mqtt::message_ptr msg_ack;
 	try {
-		js_ack["ts"] = sts;
-		js_ack["code"] = (int)code;
-
-		js_ack["type"] = toString(type);
-		js_ack["colorValue"] = value;
-		sout_ack << js_ack;
-		try {
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_SLD_ACK);
-			auto msg_ack = mqtt::make_message(TOPIC_LOCAL_SLD_ACK, sout_ack.str());
-			msg_ack->set_qos(iqos);
-			msg_ack->set_retained(bretained);
-			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {} {} {}", sts, (int)code, (int)type, value);
-			mqtt::token_ptr conntok = cli.publish(msg_ack, nullptr, aListPub);
-			bool r = conntok->wait_for(timeout);
-#ifdef FORCE_EXIT_ON_TIMEOUT
-			if (!r) exit(1);
-#endif
-		} catch (const mqtt::exception& exc) {
-			std::cout << "publishSLD_Ack: " << exc.what() << " "
-					<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
-		}
-	} catch (const Json::RuntimeError& exc) {
-		std::cout << "Error: " << exc.what() << std::endl;
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "topic: {}", TOPIC_LOCAL_SLD_ACK);
+		msg_ack = mqtt::make_message(TOPIC_LOCAL_SLD_ACK, jw.str());
+		policy.apply(msg_ack);
+		SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "publish: {} {} {} {}", sts, (int)code, (int)type, value);
+	} catch (const mqtt::exception& exc) {
+		std::cout << "publishSLD_Ack: " << exc.what() << " "
+				<< getMQTTReasonCodeString(exc.get_reason_code()) << std::endl;
 	}
 	pthread_mutex_unlock(&m_mutex);
 	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "pthread_mutex_unlock publishSLD_Ack",0);
+	if (msg_ack) {
+		pubQueue.push(msg_ack, timeout);
+	}
 }
 
 
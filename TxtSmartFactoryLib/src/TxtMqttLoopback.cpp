@@ -0,0 +1,404 @@
+/*
+ * TxtMqttLoopback.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMqttLoopback.h"
+
+#include <sys/time.h>
+#include <errno.h>
+#include <assert.h>
+
+
+namespace ft {
+
+
+class TxtMqttLoopbackDelivery : public TxtMqttDelivery
+{
+public:
+	TxtMqttLoopbackDelivery(int rc) : rc(rc) {}
+	bool isComplete() override { return true; }
+	int getReturnCode() override { return rc; }
+
+protected:
+	int rc;
+};
+
+
+TxtMqttLoopbackQueue::TxtMqttLoopbackQueue(size_t size)
+	: cells(new Cell_t[size]), mask(size - 1), head(0), tail(0)
+{
+	assert((size & (size - 1)) == 0);
+	for (size_t i = 0; i < size; i++) {
+		cells[i].seq.store(i, std::memory_order_relaxed);
+	}
+}
+
+bool TxtMqttLoopbackQueue::push(mqtt::const_message_ptr msg)
+{
+	size_t pos = head.load(std::memory_order_relaxed);
+	Cell_t* c;
+	for (;;) {
+		c = &cells[pos & mask];
+		size_t seq = c->seq.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		} else if (diff < 0) {
+			return false; //full
+		} else {
+			pos = head.load(std::memory_order_relaxed);
+		}
+	}
+	//the cell is ours until seq is published
+	c->msg = msg;
+	c->seq.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool TxtMqttLoopbackQueue::pop(mqtt::const_message_ptr& msg)
+{
+	size_t pos = tail.load(std::memory_order_relaxed);
+	Cell_t& c = cells[pos & mask];
+	size_t seq = c.seq.load(std::memory_order_acquire);
+	if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return false; //empty or not published yet
+	msg = std::move(c.msg);
+	c.msg.reset();
+	c.seq.store(pos + mask + 1, std::memory_order_release);
+	tail.store(pos + 1, std::memory_order_relaxed);
+	return true;
+}
+
+
+TxtMqttLoopbackBus& TxtMqttLoopbackBus::instance()
+{
+	static TxtMqttLoopbackBus bus;
+	return bus;
+}
+
+TxtMqttLoopbackBus::TxtMqttLoopbackBus()
+	: clients(), retained(), published(0), delivered(0), dropped(0), failed(0), m_lock()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttLoopbackBus", 0);
+	pthread_rwlock_init(&m_lock, 0);
+}
+
+TxtMqttLoopbackBus::~TxtMqttLoopbackBus()
+{
+	pthread_rwlock_destroy(&m_lock);
+}
+
+void TxtMqttLoopbackBus::attach(TxtMqttLoopback* cli)
+{
+	pthread_rwlock_wrlock(&m_lock);
+	clients.insert(cli);
+	cli->attached = true;
+	pthread_rwlock_unlock(&m_lock);
+}
+
+void TxtMqttLoopbackBus::detach(TxtMqttLoopback* cli)
+{
+	//clean session: the subscriptions end with the connection
+	pthread_rwlock_wrlock(&m_lock);
+	clients.erase(cli);
+	cli->subs.clear();
+	cli->attached = false;
+	pthread_rwlock_unlock(&m_lock);
+	//waiting publishers give up, deliveries started before are finished
+	pthread_mutex_lock(&cli->m_mutexSpace);
+	pthread_cond_broadcast(&cli->m_condSpace);
+	while (cli->pending.load() > 0) {
+		pthread_cond_wait(&cli->m_condSpace, &cli->m_mutexSpace);
+	}
+	pthread_mutex_unlock(&cli->m_mutexSpace);
+}
+
+void TxtMqttLoopbackBus::subscribe(TxtMqttLoopback* cli, const std::vector<std::string>& topics, int qos)
+{
+	Targets_t targets;
+	pthread_rwlock_wrlock(&m_lock);
+	for (auto const& filter : topics) {
+		cli->subs[filter] = qos;
+		for (auto const& r : retained) {
+			if (!TxtMqttTransport::matches(filter, r.first)) continue;
+			auto m = std::make_shared<mqtt::message>(*r.second);
+			if (m->get_qos() > qos) m->set_qos(qos);
+			m->set_retained(true);
+			addTarget(targets, cli, m);
+		}
+	}
+	pthread_rwlock_unlock(&m_lock);
+	deliver(targets);
+}
+
+void TxtMqttLoopbackBus::unsubscribe(TxtMqttLoopback* cli, const std::vector<std::string>& topics)
+{
+	pthread_rwlock_wrlock(&m_lock);
+	for (auto const& filter : topics) {
+		cli->subs.erase(filter);
+	}
+	pthread_rwlock_unlock(&m_lock);
+}
+
+bool TxtMqttLoopbackBus::publish(mqtt::const_message_ptr msg)
+{
+	published.fetch_add(1, std::memory_order_relaxed);
+	const std::string& topic = msg->get_topic();
+	bool isRetained = msg->is_retained();
+	if (isRetained) {
+		pthread_rwlock_wrlock(&m_lock);
+		if (msg->get_payload().empty()) {
+			retained.erase(topic);
+		} else {
+			retained[topic] = msg;
+		}
+	} else {
+		pthread_rwlock_rdlock(&m_lock);
+	}
+	Targets_t targets;
+	targets.reserve(clients.size());
+	for (auto cli : clients) {
+		int qos = -1;
+		for (auto const& s : cli->subs) {
+			if ((s.second > qos) && TxtMqttTransport::matches(s.first, topic)) qos = s.second;
+		}
+		if (qos < 0) continue;
+		if (qos > msg->get_qos()) qos = msg->get_qos();
+		//the retained flag is only set for messages sent on subscribe
+		if ((qos == msg->get_qos()) && !isRetained) {
+			addTarget(targets, cli, msg);
+		} else {
+			auto m = std::make_shared<mqtt::message>(*msg);
+			m->set_qos(qos);
+			m->set_retained(false);
+			addTarget(targets, cli, m);
+		}
+	}
+	pthread_rwlock_unlock(&m_lock);
+	return deliver(targets);
+}
+
+void TxtMqttLoopbackBus::addTarget(Targets_t& targets, TxtMqttLoopback* cli, mqtt::const_message_ptr msg)
+{
+	cli->pending.fetch_add(1);
+	targets.push_back(std::make_pair(cli, msg));
+}
+
+bool TxtMqttLoopbackBus::deliver(Targets_t& targets)
+{
+	bool ok = true;
+	for (auto const& t : targets) {
+		ok = deliver(t.first, t.second) && ok;
+		t.first->release();
+	}
+	return ok;
+}
+
+bool TxtMqttLoopbackBus::deliver(TxtMqttLoopback* cli, mqtt::const_message_ptr msg)
+{
+	if (!cli->inbox.push(msg)) {
+		if (msg->get_qos() == 0) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		if (!cli->waitPush(msg, LOOPBACK_BLOCK_MS)) {
+			failed.fetch_add(1, std::memory_order_relaxed);
+			spdlog::get("file_logger")->error("loopback queue full client:{} topic:{}", cli->clientId, msg->get_topic());
+			return false;
+		}
+	}
+	delivered.fetch_add(1, std::memory_order_relaxed);
+	sem_post(&cli->m_semInbox);
+	return true;
+}
+
+TxtMqttLoopbackStats TxtMqttLoopbackBus::getStats()
+{
+	TxtMqttLoopbackStats s;
+	s.published = published.load(std::memory_order_relaxed);
+	s.delivered = delivered.load(std::memory_order_relaxed);
+	s.dropped = dropped.load(std::memory_order_relaxed);
+	s.failed = failed.load(std::memory_order_relaxed);
+	pthread_rwlock_rdlock(&m_lock);
+	s.clients = clients.size();
+	s.retained = retained.size();
+	pthread_rwlock_unlock(&m_lock);
+	return s;
+}
+
+
+TxtMqttLoopback::TxtMqttLoopback(const std::string& clientId)
+	: clientId(clientId), callback(NULL), done(), subs(), inbox(), m_semInbox(), connectPending(false),
+	  attached(false), pending(0), waiters(0), m_mutexSpace(), m_condSpace(),
+	  m_stoprequested(false), m_running(false), m_thread()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttLoopback clientId:{}", clientId);
+	sem_init(&m_semInbox, 0, 0);
+	pthread_mutex_init(&m_mutexSpace, 0);
+	pthread_cond_init(&m_condSpace, 0);
+}
+
+TxtMqttLoopback::~TxtMqttLoopback()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtMqttLoopback");
+	TxtMqttLoopbackBus::instance().detach(this);
+	if (m_running) {
+		stopThread();
+	}
+	pthread_cond_destroy(&m_condSpace);
+	pthread_mutex_destroy(&m_mutexSpace);
+	sem_destroy(&m_semInbox);
+}
+
+bool TxtMqttLoopback::connect(long timeout)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "connect {}", clientId);
+	if (isConnected()) return true;
+	if (m_running) stopThread(); //disconnected from a callback
+	TxtMqttLoopbackBus::instance().attach(this);
+	connectPending = true;
+	if (!startThread()) {
+		TxtMqttLoopbackBus::instance().detach(this);
+		throw mqtt::exception(MQTTASYNC_FAILURE);
+	}
+	sem_post(&m_semInbox);
+	return true;
+}
+
+bool TxtMqttLoopback::disconnect(long timeout)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "disconnect {}", clientId);
+	TxtMqttLoopbackBus::instance().detach(this);
+	if (!m_running) return true;
+	if (pthread_equal(pthread_self(), m_thread)) {
+		//called from a callback, run() ends after it
+		m_stoprequested = true;
+		return true;
+	}
+	return stopThread();
+}
+
+void TxtMqttLoopback::subscribe(const std::vector<std::string>& topics, int qos, std::function<void(bool)> done)
+{
+	if (!isConnected()) throw mqtt::exception(MQTTASYNC_DISCONNECTED);
+	TxtMqttLoopbackBus::instance().subscribe(this, topics, qos);
+	if (done) done(true);
+}
+
+bool TxtMqttLoopback::unsubscribe(const std::vector<std::string>& topics, long timeout)
+{
+	if (!isConnected()) throw mqtt::exception(MQTTASYNC_DISCONNECTED);
+	TxtMqttLoopbackBus::instance().unsubscribe(this, topics);
+	return true;
+}
+
+bool TxtMqttLoopback::waitPush(mqtt::const_message_ptr msg, long timeout)
+{
+	struct timeval tv;
+	struct timespec ts;
+	gettimeofday(&tv, NULL);
+	long usec = tv.tv_usec + (timeout % 1000) * 1000;
+	ts.tv_sec = tv.tv_sec + timeout / 1000 + usec / 1000000;
+	ts.tv_nsec = (usec % 1000000) * 1000;
+	pthread_mutex_lock(&m_mutexSpace);
+	waiters.fetch_add(1);
+	//pairs with the fence in notifySpace(): a pop after this push fails sees the waiter
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	bool ok;
+	while (!(ok = inbox.push(msg)) && attached) {
+		if (pthread_cond_timedwait(&m_condSpace, &m_mutexSpace, &ts) == ETIMEDOUT) {
+			ok = inbox.push(msg);
+			break;
+		}
+	}
+	waiters.fetch_sub(1);
+	pthread_mutex_unlock(&m_mutexSpace);
+	return ok;
+}
+
+void TxtMqttLoopback::notifySpace()
+{
+	//the mutex is only taken if a publisher waits
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiters.load(std::memory_order_relaxed) > 0) {
+		pthread_mutex_lock(&m_mutexSpace);
+		pthread_cond_broadcast(&m_condSpace);
+		pthread_mutex_unlock(&m_mutexSpace);
+	}
+}
+
+void TxtMqttLoopback::release()
+{
+	if ((pending.fetch_sub(1) == 1) && !attached) {
+		pthread_mutex_lock(&m_mutexSpace);
+		pthread_cond_broadcast(&m_condSpace);
+		pthread_mutex_unlock(&m_mutexSpace);
+	}
+}
+
+TxtMqttDeliveryPtr TxtMqttLoopback::publish(mqtt::const_message_ptr msg)
+{
+	if (!isConnected()) throw mqtt::exception(MQTTASYNC_DISCONNECTED);
+	bool ok = TxtMqttLoopbackBus::instance().publish(msg);
+	TxtMqttDeliveryPtr d = std::make_shared<TxtMqttLoopbackDelivery>(ok ? 0 : MQTTASYNC_FAILURE);
+	if (done) done();
+	return d;
+}
+
+bool TxtMqttLoopback::startThread() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "startThread");
+	if (m_running) return true; //already running
+	//go
+	assert(m_running == false);
+	m_running = true;
+	m_stoprequested = false;
+	if (pthread_create(&m_thread, 0, start_thread, this) != 0) {
+		m_running = false;
+		return false;
+	}
+	return true;
+}
+
+bool TxtMqttLoopback::stopThread() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "stopThread");
+	if (!m_running) return true; //already stopped
+	assert(m_running == true);
+	m_stoprequested = true;
+	sem_post(&m_semInbox);
+	int ret = pthread_join(m_thread, 0);
+	m_running = false;
+	return ret == 0;
+}
+
+void TxtMqttLoopback::run() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "run");
+	while (!m_stoprequested)
+	{
+		if (connectPending.exchange(false) && callback)
+		{
+			callback->connected("");
+		}
+		mqtt::const_message_ptr msg;
+		while (!m_stoprequested && inbox.pop(msg))
+		{
+			notifySpace();
+			if (callback) callback->message_arrived(msg);
+			msg.reset();
+		}
+		struct timeval tv;
+		struct timespec ts;
+		gettimeofday(&tv, NULL);
+		ts.tv_sec = tv.tv_sec + 1;
+		ts.tv_nsec = tv.tv_usec * 1000;
+		//the count can be higher than the queue: a message may have been popped before its post
+		while ((sem_timedwait(&m_semInbox, &ts) != 0) && (errno == EINTR)) {}
+	}
+	//drop what is left, the messages of the next session start clean
+	mqtt::const_message_ptr msg;
+	while (inbox.pop(msg)) {}
+	notifySpace();
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,152 @@
+/*
+ * TxtMqttMetrics.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMqttMetrics.h"
+
+#include <string.h>
+
+
+namespace ft {
+
+
+TxtMqttMetrics::TxtMqttMetrics()
+{
+	for (int i = 0; i < METRICS_MAX_TOPICS; i++) {
+		slots[i].hash.store(0);
+		slots[i].ready.store(false);
+		slots[i].topic[0] = 0;
+	}
+	reset();
+}
+
+int TxtMqttMetrics::bucket(uint64_t v)
+{
+	int b = (v == 0) ? 0 : 64 - __builtin_clzll(v);
+	return (b < METRICS_HIST_BUCKETS) ? b : METRICS_HIST_BUCKETS - 1;
+}
+
+void TxtMqttMetrics::updateMax(std::atomic<uint64_t>& m, uint64_t v)
+{
+	uint64_t cur = m.load(std::memory_order_relaxed);
+	while ((v > cur) && !m.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+int TxtMqttMetrics::slot(const std::string& topic)
+{
+	size_t len = (topic.size() < METRICS_TOPIC_LEN) ? topic.size() : METRICS_TOPIC_LEN - 1;
+	//FNV-1a, 0 marks a free slot
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h = (h ^ (uint8_t)topic[i]) * 16777619u;
+	}
+	if (h == 0) h = 1;
+	for (int n = 0; n < METRICS_MAX_TOPICS; n++) {
+		int i = (int)((h + n) % METRICS_MAX_TOPICS);
+		Slot_t& s = slots[i];
+		uint32_t cur = s.hash.load(std::memory_order_acquire);
+		if (cur == 0) {
+			if (s.hash.compare_exchange_strong(cur, h, std::memory_order_acq_rel)) {
+				memcpy(s.topic, topic.data(), len);
+				s.topic[len] = 0;
+				s.ready.store(true, std::memory_order_release);
+				return i;
+			}
+			//claimed by another thread meanwhile, cur holds its hash
+		}
+		if (cur == h) {
+			while (!s.ready.load(std::memory_order_acquire)) {}
+			if ((strncmp(s.topic, topic.data(), len) == 0) && (s.topic[len] == 0)) {
+				return i;
+			}
+		}
+	}
+	return -1;
+}
+
+void TxtMqttMetrics::enqueued(int slot, size_t bytes)
+{
+	if (slot < 0) return;
+	Slot_t& s = slots[slot];
+	s.enqueued.fetch_add(1, std::memory_order_relaxed);
+	s.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	s.size[bucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void TxtMqttMetrics::sent(int slot, uint64_t queue_us)
+{
+	if (slot < 0) return;
+	Slot_t& s = slots[slot];
+	s.sent.fetch_add(1, std::memory_order_relaxed);
+	s.queue_us[bucket(queue_us)].fetch_add(1, std::memory_order_relaxed);
+	updateMax(s.queueMax_us, queue_us);
+}
+
+void TxtMqttMetrics::acked(int slot, uint64_t ack_us, long timeout_ms)
+{
+	if (slot < 0) return;
+	Slot_t& s = slots[slot];
+	s.acked.fetch_add(1, std::memory_order_relaxed);
+	s.ack_us[bucket(ack_us)].fetch_add(1, std::memory_order_relaxed);
+	updateMax(s.ackMax_us, ack_us);
+	if (ack_us * 4 > (uint64_t)timeout_ms * 3000) {
+		s.slow.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void TxtMqttMetrics::failed(int slot)
+{
+	if (slot < 0) return;
+	slots[slot].failed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TxtMqttMetrics::getSnapshot(std::vector<TxtMqttTopicMetrics>& out)
+{
+	out.clear();
+	for (int i = 0; i < METRICS_MAX_TOPICS; i++) {
+		Slot_t& s = slots[i];
+		if (!s.ready.load(std::memory_order_acquire)) continue;
+		TxtMqttTopicMetrics m;
+		m.topic = s.topic;
+		m.enqueued = s.enqueued.load(std::memory_order_relaxed);
+		m.sent = s.sent.load(std::memory_order_relaxed);
+		m.acked = s.acked.load(std::memory_order_relaxed);
+		m.failed = s.failed.load(std::memory_order_relaxed);
+		m.slow = s.slow.load(std::memory_order_relaxed);
+		m.bytes = s.bytes.load(std::memory_order_relaxed);
+		m.queueMax_us = s.queueMax_us.load(std::memory_order_relaxed);
+		m.ackMax_us = s.ackMax_us.load(std::memory_order_relaxed);
+		for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+			m.queue_us[b] = s.queue_us[b].load(std::memory_order_relaxed);
+			m.ack_us[b] = s.ack_us[b].load(std::memory_order_relaxed);
+			m.size[b] = s.size[b].load(std::memory_order_relaxed);
+		}
+		out.push_back(m);
+	}
+}
+
+void TxtMqttMetrics::reset()
+{
+	//topics keep their slots
+	for (int i = 0; i < METRICS_MAX_TOPICS; i++) {
+		Slot_t& s = slots[i];
+		s.enqueued.store(0);
+		s.sent.store(0);
+		s.acked.store(0);
+		s.failed.store(0);
+		s.slow.store(0);
+		s.bytes.store(0);
+		s.queueMax_us.store(0);
+		s.ackMax_us.store(0);
+		for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+			s.queue_us[b].store(0);
+			s.ack_us[b].store(0);
+			s.size[b].store(0);
+		}
+	}
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,314 @@
+/*
+ * TxtMqttOutbox.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMqttOutbox.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stddef.h>
+#include <iostream>
+
+#include "spdlog/spdlog.h"
+
+
+#define OUTBOX_MAGIC 0x424F5446 // "FTOB"
+#define OUTBOX_VERSION 1
+#define OUTBOX_CRC_OFFSET 12 // Record_t.payloadLen
+
+
+namespace ft {
+
+
+static uint32_t crcTable[256];
+
+static void initCrcTable()
+{
+	static bool init = false;
+	if (init) return;
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		}
+		crcTable[i] = c;
+	}
+	init = true;
+}
+
+
+TxtMqttOutbox::TxtMqttOutbox(const std::string& filename, size_t size)
+	: filename(filename), size(size), fd(-1), base(NULL), header(NULL), ring(NULL), index()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttOutbox filename:{} size:{}", filename, size);
+	memset(&stats, 0, sizeof(stats));
+	initCrcTable();
+}
+
+TxtMqttOutbox::~TxtMqttOutbox()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtMqttOutbox");
+	close();
+}
+
+bool TxtMqttOutbox::open()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "open {}", filename);
+	if (isOpen()) return true;
+	size_t fileSize = sizeof(Header_t) + size;
+	fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		std::cout << "Error: open outbox " << filename << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	struct stat st;
+	bool fresh = (fstat(fd, &st) != 0) || ((size_t)st.st_size != fileSize);
+	if (fresh && (ftruncate(fd, fileSize) != 0)) {
+		std::cout << "Error: ftruncate outbox " << filename << ": " << strerror(errno) << std::endl;
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	void* p = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		std::cout << "Error: mmap outbox " << filename << ": " << strerror(errno) << std::endl;
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	base = (uint8_t*)p;
+	header = (Header_t*)base;
+	ring = base + sizeof(Header_t);
+	if (fresh || (header->magic != OUTBOX_MAGIC) || (header->version != OUTBOX_VERSION)
+			|| (header->size != size) || (header->head < header->tail) || (header->head - header->tail > size)) {
+		if (!fresh) {
+			spdlog::get("console")->warn("outbox {}: invalid header, discarding content", filename);
+		}
+		memset(header, 0, sizeof(Header_t));
+		header->magic = OUTBOX_MAGIC;
+		header->version = OUTBOX_VERSION;
+		header->size = size;
+		header->nextSeq = 1;
+		sync();
+		return true;
+	}
+	if (!recover()) {
+		spdlog::get("console")->warn("outbox {}: torn record at {}, dropping the rest", filename, header->head);
+	}
+	advanceTail();
+	stats.recovered = stats.depthMax = stats.depth;
+	if (stats.depth > 0) {
+		spdlog::get("console")->info("outbox {}: {} messages not acknowledged", filename, stats.depth);
+	}
+	return true;
+}
+
+void TxtMqttOutbox::close()
+{
+	if (!isOpen()) return;
+	sync();
+	munmap(base, sizeof(Header_t) + size);
+	::close(fd);
+	fd = -1;
+	base = ring = NULL;
+	header = NULL;
+	index.clear();
+}
+
+void TxtMqttOutbox::sync()
+{
+	if (!isOpen()) return;
+	msync(base, sizeof(Header_t) + size, MS_ASYNC);
+}
+
+void TxtMqttOutbox::write(uint64_t offset, const void* data, size_t n)
+{
+	size_t pos = offset % size;
+	size_t n1 = (n < size - pos) ? n : size - pos;
+	memcpy(ring + pos, data, n1);
+	if (n1 < n) {
+		memcpy(ring, (const uint8_t*)data + n1, n - n1);
+	}
+}
+
+void TxtMqttOutbox::read(uint64_t offset, void* data, size_t n)
+{
+	size_t pos = offset % size;
+	size_t n1 = (n < size - pos) ? n : size - pos;
+	memcpy(data, ring + pos, n1);
+	if (n1 < n) {
+		memcpy((uint8_t*)data + n1, ring, n - n1);
+	}
+}
+
+uint32_t TxtMqttOutbox::crc(uint64_t offset, size_t n)
+{
+	uint32_t c = 0xFFFFFFFF;
+	size_t pos = offset % size;
+	for (size_t i = 0; i < n; i++) {
+		c = crcTable[(c ^ ring[pos]) & 0xFF] ^ (c >> 8);
+		if (++pos == size) pos = 0;
+	}
+	return c ^ 0xFFFFFFFF;
+}
+
+bool TxtMqttOutbox::recover()
+{
+	index.clear();
+	uint64_t off = header->tail;
+	uint64_t lastSeq = 0;
+	while (off < header->head) {
+		Record_t r;
+		if (header->head - off < sizeof(Record_t)) break;
+		read(off, &r, sizeof(r));
+		size_t dataLen = sizeof(Record_t) - OUTBOX_CRC_OFFSET + r.topicLen + r.payloadLen;
+		if ((r.len < sizeof(Record_t)) || (r.len % 8 != 0) || (r.len > header->head - off)
+				|| (dataLen + OUTBOX_CRC_OFFSET > r.len) || (r.seq <= lastSeq)
+				|| (crc(off + OUTBOX_CRC_OFFSET, dataLen) != r.crc)) {
+			break;
+		}
+		Index_t ix;
+		ix.seq = r.seq;
+		ix.offset = off;
+		ix.len = r.len;
+		ix.acked = (r.acked != 0);
+		index.push_back(ix);
+		if (!ix.acked) stats.depth++;
+		lastSeq = r.seq;
+		off += r.len;
+	}
+	if (lastSeq >= header->nextSeq) {
+		header->nextSeq = lastSeq + 1;
+	}
+	if (off != header->head) {
+		header->head = off;
+		return false;
+	}
+	return true;
+}
+
+uint64_t TxtMqttOutbox::append(mqtt::const_message_ptr msg)
+{
+	if (!isOpen()) return 0;
+	const std::string& topic = msg->get_topic();
+	const std::string& payload = msg->get_payload();
+	size_t dataLen = sizeof(Record_t) + topic.size() + payload.size();
+	uint32_t len = (uint32_t)((dataLen + 7) & ~(size_t)7);
+	if ((len > size / 2) || (topic.size() > 0xFFFF)) {
+		stats.rejected++;
+		return 0;
+	}
+	while (header->head + len - header->tail > size) {
+		dropOldest();
+	}
+	Record_t r;
+	memset(&r, 0, sizeof(r));
+	r.len = len;
+	r.seq = header->nextSeq++;
+	r.topicLen = (uint16_t)topic.size();
+	r.qos = (uint8_t)msg->get_qos();
+	r.retained = msg->is_retained() ? 1 : 0;
+	r.payloadLen = (uint32_t)payload.size();
+	uint64_t off = header->head;
+	write(off, &r, sizeof(r));
+	write(off + sizeof(r), topic.data(), topic.size());
+	write(off + sizeof(r) + topic.size(), payload.data(), payload.size());
+	r.crc = crc(off + OUTBOX_CRC_OFFSET, dataLen - OUTBOX_CRC_OFFSET);
+	write(off + offsetof(Record_t, crc), &r.crc, sizeof(r.crc));
+	//record complete, publish it
+	header->head = off + len;
+	Index_t ix;
+	ix.seq = r.seq;
+	ix.offset = off;
+	ix.len = len;
+	ix.acked = false;
+	index.push_back(ix);
+	stats.appended++;
+	stats.depth++;
+	if (stats.depth > stats.depthMax) stats.depthMax = stats.depth;
+	stats.bytes = header->head - header->tail;
+	sync();
+	return r.seq;
+}
+
+void TxtMqttOutbox::ack(uint64_t seq)
+{
+	if (!isOpen() || (seq == 0) || index.empty()) return;
+	if ((seq < index.front().seq) || (seq > index.back().seq)) return; //dropped by overflow
+	//seq numbers are increasing, index is sorted
+	size_t lo = 0, hi = index.size();
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (index[mid].seq < seq) lo = mid + 1; else hi = mid;
+	}
+	if ((lo < index.size()) && (index[lo].seq == seq) && !index[lo].acked) {
+		index[lo].acked = true;
+		uint32_t flag = 1;
+		write(index[lo].offset + offsetof(Record_t, acked), &flag, sizeof(flag));
+		stats.acked++;
+		stats.depth--;
+		advanceTail();
+	}
+}
+
+void TxtMqttOutbox::advanceTail()
+{
+	//PUBACKs can arrive out of order, the tail only moves over acked records
+	while (!index.empty() && index.front().acked) {
+		header->tail = index.front().offset + index.front().len;
+		index.pop_front();
+	}
+	if (index.empty()) {
+		header->tail = header->head;
+	}
+	stats.bytes = header->head - header->tail;
+}
+
+void TxtMqttOutbox::dropOldest()
+{
+	if (index.empty()) {
+		header->tail = header->head;
+		return;
+	}
+	if (!index.front().acked) {
+		stats.overflow++;
+		stats.depth--;
+		spdlog::get("file_logger")->error("outbox full, dropped seq:{}", index.front().seq);
+	}
+	header->tail = index.front().offset + index.front().len;
+	index.pop_front();
+	advanceTail();
+}
+
+void TxtMqttOutbox::getMessages(std::vector<std::pair<uint64_t, mqtt::const_message_ptr> >& msgs)
+{
+	msgs.clear();
+	if (!isOpen()) return;
+	for (auto const& ix : index) {
+		if (ix.acked) continue;
+		Record_t r;
+		read(ix.offset, &r, sizeof(r));
+		std::string topic(r.topicLen, '\0');
+		std::string payload(r.payloadLen, '\0');
+		if (r.topicLen > 0) read(ix.offset + sizeof(r), &topic[0], r.topicLen);
+		if (r.payloadLen > 0) read(ix.offset + sizeof(r) + r.topicLen, &payload[0], r.payloadLen);
+		auto msg = mqtt::make_message(topic, std::move(payload));
+		msg->set_qos(r.qos);
+		msg->set_retained(r.retained != 0);
+		msgs.push_back(std::make_pair(ix.seq, mqtt::const_message_ptr(msg)));
+	}
+}
+
+TxtMqttOutboxStats TxtMqttOutbox::getStats()
+{
+	return stats;
+}
+
+
+} /* namespace ft */
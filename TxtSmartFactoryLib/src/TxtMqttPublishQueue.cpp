@@ -0,0 +1,567 @@
+/*
+ * TxtMqttPublishQueue.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMqttPublishQueue.h"
+
+#include <sys/time.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+
+
+namespace ft {
+
+
+TxtMqttPublishQueue::TxtMqttPublishQueue(TxtMqttTransport& transport,
+		size_t capacity, size_t max_inflight) :
+	transport(transport), capacity(capacity), max_inflight(max_inflight),
+	inflight(), sending(0), coalesce(), minInterval(), npending(0),
+	outbox(NULL), policy(NULL), parked(), late(), replaying(), tsReplay(), tsRetry(),
+	periodic(), periodic_ms(0), tsPeriodic(std::chrono::steady_clock::now()), metrics(), pushSum_us(0.0),
+	m_stoprequested(false), m_running(false), m_mutex(), m_condWork(), m_condSpace(), m_condIdle(), m_thread()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttPublishQueue capacity:{} max_inflight:{}", capacity, max_inflight);
+	memset(&stats, 0, sizeof(stats));
+	memset(delaySum_us, 0, sizeof(delaySum_us));
+	memset(inflightLane, 0, sizeof(inflightLane));
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_mutex, &attr);
+	pthread_cond_init(&m_condWork, 0);
+	pthread_cond_init(&m_condSpace, 0);
+	pthread_cond_init(&m_condIdle, 0);
+	transport.setDeliveryDone([this]() { notify(); });
+}
+
+TxtMqttPublishQueue::~TxtMqttPublishQueue()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtMqttPublishQueue");
+	if (m_running) {
+		stopThread();
+	}
+	transport.setDeliveryDone(nullptr);
+	pthread_cond_destroy(&m_condIdle);
+	pthread_cond_destroy(&m_condSpace);
+	pthread_cond_destroy(&m_condWork);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+bool TxtMqttPublishQueue::startThread() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "startThread");
+	if (m_running) return true; //already running
+	//go
+	assert(m_running == false);
+	m_running = true;
+	m_stoprequested = false;
+	return pthread_create(&m_thread, 0, start_thread, this) == 0;
+}
+
+bool TxtMqttPublishQueue::stopThread() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "stopThread");
+	if (!m_running) return true; //already stopped
+	//stop
+	assert(m_running == true);
+	pthread_mutex_lock(&m_mutex);
+	m_running = false;
+	m_stoprequested = true;
+	pthread_cond_broadcast(&m_condWork);
+	pthread_cond_broadcast(&m_condSpace);
+	pthread_cond_broadcast(&m_condIdle);
+	pthread_mutex_unlock(&m_mutex);
+	return pthread_join(m_thread, 0) == 0;
+}
+
+void TxtMqttPublishQueue::timedwait(pthread_cond_t* cond, long timeout_ms) {
+	struct timespec ts;
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	long long ns = (long long)tv.tv_usec * 1000LL + (long long)timeout_ms * 1000000LL;
+	ts.tv_sec = tv.tv_sec + (time_t)(ns / 1000000000LL);
+	ts.tv_nsec = (long)(ns % 1000000000LL);
+	pthread_cond_timedwait(cond, &m_mutex, &ts);
+}
+
+TxtMqttLane_t TxtMqttPublishQueue::getLane(const std::string& topic) {
+	if (topic.compare(0, 3, "fl/") == 0) {
+		return LANE_CONTROL;
+	} else if ((topic == "i/cam") || (topic == "i/cam/jpg")) {
+		return LANE_BULK;
+	}
+	return LANE_STATE;
+}
+
+bool TxtMqttPublishQueue::isLossy(const std::string& topic) {
+	return (topic.compare(0, 5, "i/cam") == 0) || (topic == "i/ldr") || (topic.compare(0, 12, "f/i/metrics/") == 0);
+}
+
+void TxtMqttPublishQueue::setPeriodic(std::function<void()> fn, long period_ms) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setPeriodic period_ms:{}", period_ms);
+	pthread_mutex_lock(&m_mutex);
+	periodic = fn;
+	periodic_ms = period_ms;
+	tsPeriodic = std::chrono::steady_clock::now();
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttPublishQueue::setOutbox(TxtMqttOutbox* ob) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setOutbox");
+	pthread_mutex_lock(&m_mutex);
+	outbox = ob;
+	parked.clear();
+	if (outbox) {
+		std::vector<std::pair<uint64_t, mqtt::const_message_ptr> > msgs;
+		outbox->getMessages(msgs);
+		for (auto const& m : msgs) {
+			Entry_t e;
+			e.msg = m.second;
+			e.timeout = PUBLISH_REPLAY_TIMEOUT_MS;
+			e.lane = getLane(m.second->get_topic());
+			e.tsEnqueued = std::chrono::steady_clock::now();
+			e.seq = m.first;
+			e.tsExpiry = getExpiry(e.msg->get_topic(), e.tsEnqueued);
+			parked[e.seq] = e;
+		}
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttPublishQueue::replay() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "replay");
+	pthread_mutex_lock(&m_mutex);
+	if (!parked.empty()) {
+		spdlog::get("console")->info("publish queue: replay {} messages", parked.size());
+		//oldest first, in front of the messages queued meanwhile
+		for (auto it = parked.rbegin(); it != parked.rend(); ++it) {
+			it->second.tsEnqueued = std::chrono::steady_clock::now();
+			queue[it->second.lane].push_front(it->second);
+			replaying.insert(it->first);
+		}
+		stats.replays++;
+		stats.replayed += parked.size();
+		parked.clear();
+		tsReplay = std::chrono::steady_clock::now();
+		pthread_cond_signal(&m_condWork);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttPublishQueue::persist(Entry_t& e) {
+	e.seq = 0;
+	if (outbox && (e.msg->get_qos() >= 1) && !isLossy(e.msg->get_topic())) {
+		e.seq = outbox->append(e.msg);
+	}
+}
+
+void TxtMqttPublishQueue::park(Entry_t& e) {
+	//not stored: dropped as before, stored: kept for the next replay
+	if (e.seq == 0) {
+		stats.failed++;
+		return;
+	}
+	replaying.erase(e.seq);
+	parked[e.seq] = e;
+}
+
+void TxtMqttPublishQueue::park(const Inflight_t& f) {
+	Entry_t e;
+	e.msg = f.msg;
+	e.timeout = f.timeout;
+	e.lane = f.lane;
+	e.tsEnqueued = std::chrono::steady_clock::now();
+	e.seq = f.seq;
+	e.tsExpiry = f.tsExpiry;
+	park(e);
+}
+
+void TxtMqttPublishQueue::acked(uint64_t seq) {
+	if (seq == 0) return;
+	if (outbox) outbox->ack(seq);
+	if (replaying.erase(seq) && replaying.empty()) {
+		double dt_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tsReplay).count();
+		stats.replay_ms = dt_ms;
+		if (dt_ms > stats.replayMax_ms) stats.replayMax_ms = dt_ms;
+		spdlog::get("console")->info("publish queue: replay done in {} ms", dt_ms);
+	}
+}
+
+void TxtMqttPublishQueue::setMinInterval(const std::string& topic, long interval_ms) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "setMinInterval topic:{} interval_ms:{}", topic, interval_ms);
+	pthread_mutex_lock(&m_mutex);
+	minInterval[topic] = interval_ms;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+std::chrono::steady_clock::time_point TxtMqttPublishQueue::getExpiry(const std::string& topic, std::chrono::steady_clock::time_point ts) {
+	long expiry_s = policy ? policy->get(topic).expiry_s : 0;
+	return (expiry_s > 0) ? ts + std::chrono::seconds(expiry_s) : std::chrono::steady_clock::time_point::max();
+}
+
+long TxtMqttPublishQueue::getMinInterval(const std::string& topic) {
+	auto it = minInterval.find(topic);
+	return (it != minInterval.end()) ? it->second : 0;
+}
+
+bool TxtMqttPublishQueue::push(mqtt::const_message_ptr msg, long timeout, TxtMqttLane_t lane) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "push topic:{} timeout:{} lane:{}", msg->get_topic(), timeout, (int)lane);
+	metrics.enqueued(metrics.slot(msg->get_topic()), msg->get_payload().size());
+	pthread_mutex_lock(&m_mutex);
+	bool ret = enqueue(msg, timeout, lane, "");
+	pthread_mutex_unlock(&m_mutex);
+	return ret;
+}
+
+bool TxtMqttPublishQueue::pushLatest(mqtt::const_message_ptr msg, long timeout, const std::string& key) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "pushLatest topic:{} timeout:{} key:{}", msg->get_topic(), timeout, key);
+	TxtMqttLane_t lane = getLane(msg->get_topic());
+	auto now = std::chrono::steady_clock::now();
+	bool ret = true;
+	metrics.enqueued(metrics.slot(msg->get_topic()), msg->get_payload().size());
+	pthread_mutex_lock(&m_mutex);
+	Coalesce_t& c = coalesce[key];
+	if (c.pending)
+	{
+		//held back by min interval, replace value
+		c.entry.msg = msg;
+		c.entry.timeout = timeout;
+		c.entry.tsExpiry = getExpiry(msg->get_topic(), now);
+		stats.suppressed++;
+		pthread_mutex_unlock(&m_mutex);
+		return true;
+	}
+	for (auto it = queue[lane].begin(); it != queue[lane].end(); ++it)
+	{
+		if (it->key == key)
+		{
+			//not sent yet, replace value and keep position
+			acked(it->seq);
+			it->msg = msg;
+			it->timeout = timeout;
+			it->tsExpiry = getExpiry(msg->get_topic(), now);
+			persist(*it);
+			stats.suppressed++;
+			pthread_mutex_unlock(&m_mutex);
+			return true;
+		}
+	}
+	long interval_ms = getMinInterval(msg->get_topic());
+	if ((interval_ms > 0) && (now < c.tsLastSent + std::chrono::milliseconds(interval_ms)))
+	{
+		c.pending = true;
+		c.entry.msg = msg;
+		c.entry.timeout = timeout;
+		c.entry.lane = lane;
+		c.entry.tsEnqueued = now;
+		c.entry.key = key;
+		c.entry.tsExpiry = getExpiry(msg->get_topic(), now);
+		npending++;
+		stats.deferred++;
+		pthread_cond_signal(&m_condWork);
+	} else {
+		ret = enqueue(msg, timeout, lane, key);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return ret;
+}
+
+bool TxtMqttPublishQueue::enqueue(mqtt::const_message_ptr msg, long timeout, TxtMqttLane_t lane, const std::string& key) {
+	auto tsStart = std::chrono::steady_clock::now();
+	bool ret = true;
+	std::deque<Entry_t>& q = queue[lane];
+	if (lane == LANE_BULK)
+	{
+		//latest message wins
+		for (auto it = q.begin(); it != q.end(); ++it)
+		{
+			if (it->msg->get_topic() == msg->get_topic())
+			{
+				q.erase(it);
+				stats.lane[lane].dropped++;
+				break;
+			}
+		}
+		if (q.size() >= capacity)
+		{
+			q.pop_front();
+			stats.lane[lane].dropped++;
+		}
+	}
+	else if (q.size() >= capacity)
+	{
+		if (msg->get_qos() == 0)
+		{
+			//fire and forget messages are not worth blocking the caller
+			stats.dropped++;
+			ret = false;
+		} else {
+			//back-pressure: wait for the sender thread
+			stats.blocked++;
+			auto deadline = tsStart + std::chrono::milliseconds(timeout);
+			while (m_running && (q.size() >= capacity) && (std::chrono::steady_clock::now() < deadline))
+			{
+				timedwait(&m_condSpace, 10);
+			}
+			if (q.size() >= capacity)
+			{
+				stats.dropped++;
+				ret = false;
+			}
+		}
+		if (!ret)
+		{
+			stats.lane[lane].dropped++;
+			spdlog::get("console")->warn("publish queue full, dropped topic:{}", msg->get_topic());
+		}
+	}
+	if (ret)
+	{
+		Entry_t e;
+		e.msg = msg;
+		e.timeout = timeout;
+		e.lane = lane;
+		e.tsEnqueued = std::chrono::steady_clock::now();
+		e.key = key;
+		e.tsExpiry = getExpiry(msg->get_topic(), e.tsEnqueued);
+		persist(e);
+		q.push_back(e);
+		stats.enqueued++;
+		stats.lane[lane].enqueued++;
+		size_t depth = getDepth();
+		if (depth > stats.depthMax) stats.depthMax = depth;
+		pthread_cond_signal(&m_condWork);
+	}
+	double dt_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tsStart).count();
+	pushSum_us += dt_us;
+	if (dt_us > stats.pushMax_us) stats.pushMax_us = dt_us;
+	return ret;
+}
+
+bool TxtMqttPublishQueue::flush(long timeout) {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "flush timeout:{}", timeout);
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+	pthread_mutex_lock(&m_mutex);
+	pthread_cond_signal(&m_condWork);
+	while (m_running && !isIdle() && (std::chrono::steady_clock::now() < deadline))
+	{
+		timedwait(&m_condIdle, 10);
+	}
+	bool ret = isIdle();
+	pthread_mutex_unlock(&m_mutex);
+	return ret;
+}
+
+TxtMqttPublishStats TxtMqttPublishQueue::getStats() {
+	pthread_mutex_lock(&m_mutex);
+	TxtMqttPublishStats s = stats;
+	s.depth = getDepth();
+	s.inflight = inflight.size() + sending;
+	s.pushAvg_us = (stats.enqueued + stats.dropped) > 0 ? pushSum_us / (stats.enqueued + stats.dropped) : 0.0;
+	s.parked = parked.size();
+	s.late = late.size();
+	if (outbox) s.outbox = outbox->getStats();
+	for (int i = 0; i < LANE_COUNT; i++)
+	{
+		s.lane[i].depth = queue[i].size();
+		s.lane[i].delayAvg_us = stats.lane[i].sent > 0 ? delaySum_us[i] / stats.lane[i].sent : 0.0;
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return s;
+}
+
+void TxtMqttPublishQueue::resetStats() {
+	pthread_mutex_lock(&m_mutex);
+	memset(&stats, 0, sizeof(stats));
+	memset(delaySum_us, 0, sizeof(delaySum_us));
+	pushSum_us = 0.0;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttPublishQueue::notify() {
+	pthread_mutex_lock(&m_mutex);
+	pthread_cond_signal(&m_condWork);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttPublishQueue::reap() {
+	auto now = std::chrono::steady_clock::now();
+	for (auto it = inflight.begin(); it != inflight.end(); )
+	{
+		bool complete = it->tok->isComplete();
+		if (complete && (it->tok->getReturnCode() == 0))
+		{
+			stats.completed++;
+			metrics.acked(it->metric, std::chrono::duration_cast<std::chrono::microseconds>(now - it->tsSent).count(), it->timeout);
+			acked(it->seq);
+			inflightLane[it->lane]--;
+			it = inflight.erase(it);
+		} else if (complete || (now >= it->deadline)) {
+			if (complete) {
+				spdlog::get("file_logger")->error("publish failed topic:{}", it->msg->get_topic());
+				park(*it);
+			} else {
+				stats.timeouts++;
+				spdlog::get("file_logger")->error("publish timeout topic:{}", it->msg->get_topic());
+				//the client still delivers it, a replay now could send it twice
+				late.push_back(*it);
+			}
+			metrics.failed(it->metric);
+			inflightLane[it->lane]--;
+			it = inflight.erase(it);
+		} else {
+			++it;
+		}
+	}
+	//timed out messages: acked or failed later, parked if the connection is lost
+	bool connected = late.empty() || transport.isConnected();
+	for (auto it = late.begin(); it != late.end(); )
+	{
+		if (it->tok->isComplete() && (it->tok->getReturnCode() == 0)) {
+			stats.completed++;
+			acked(it->seq);
+			it = late.erase(it);
+		} else if (it->tok->isComplete() || !connected) {
+			park(*it);
+			it = late.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void TxtMqttPublishQueue::releasePending() {
+	if (npending == 0) return;
+	auto now = std::chrono::steady_clock::now();
+	for (auto it = coalesce.begin(); it != coalesce.end(); ++it)
+	{
+		Coalesce_t& c = it->second;
+		if (c.pending && (now >= c.tsLastSent + std::chrono::milliseconds(getMinInterval(c.entry.msg->get_topic()))))
+		{
+			persist(c.entry);
+			queue[c.entry.lane].push_back(c.entry);
+			c.entry.msg.reset();
+			c.pending = false;
+			npending--;
+		}
+	}
+}
+
+size_t TxtMqttPublishQueue::getDepth() {
+	size_t depth = 0;
+	for (int i = 0; i < LANE_COUNT; i++)
+	{
+		depth += queue[i].size();
+	}
+	return depth;
+}
+
+int TxtMqttPublishQueue::nextLane() {
+	if (inflight.size() >= max_inflight) return -1;
+	if (!queue[LANE_CONTROL].empty()) return LANE_CONTROL;
+	if (!queue[LANE_STATE].empty()) return LANE_STATE;
+	//bulk only if no control message is in flight, one bulk message at a time
+	if (!queue[LANE_BULK].empty() && (inflightLane[LANE_CONTROL] == 0) && (inflightLane[LANE_BULK] == 0)) return LANE_BULK;
+	return -1;
+}
+
+void TxtMqttPublishQueue::run() {
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "run");
+	pthread_mutex_lock(&m_mutex);
+	while (!m_stoprequested)
+	{
+		reap();
+		releasePending();
+		int lane = nextLane();
+		if (lane >= 0)
+		{
+			Entry_t e = queue[lane].front();
+			queue[lane].pop_front();
+			auto tsSent = std::chrono::steady_clock::now();
+			if (tsSent >= e.tsExpiry)
+			{
+				//stale, a newer value follows or nobody waits for it anymore
+				stats.expired++;
+				acked(e.seq);
+				pthread_cond_broadcast(&m_condSpace);
+				continue;
+			}
+			double delay_us = std::chrono::duration<double, std::micro>(tsSent - e.tsEnqueued).count();
+			int metric = metrics.slot(e.msg->get_topic());
+			metrics.sent(metric, (uint64_t)delay_us);
+			delaySum_us[lane] += delay_us;
+			if (delay_us > stats.lane[lane].delayMax_us) stats.lane[lane].delayMax_us = delay_us;
+			stats.lane[lane].sent++;
+			if (!e.key.empty())
+			{
+				coalesce[e.key].tsLastSent = std::chrono::steady_clock::now();
+			}
+			sending++;
+			pthread_cond_broadcast(&m_condSpace);
+			pthread_mutex_unlock(&m_mutex);
+
+			//publish without holding the queue lock, callbacks need it
+			TxtMqttDeliveryPtr tok;
+			if (transport.isConnected()) {
+				try {
+					tok = transport.publish(e.msg);
+				} catch (const mqtt::exception& exc) {
+					std::cout << "Error: " << exc.what() << std::endl;
+				}
+			}
+
+			pthread_mutex_lock(&m_mutex);
+			sending--;
+			if (tok)
+			{
+				Inflight_t f;
+				f.tok = tok;
+				f.msg = e.msg;
+				f.lane = e.lane;
+				f.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(e.timeout);
+				f.timeout = e.timeout;
+				f.seq = e.seq;
+				f.metric = metric;
+				f.tsSent = tsSent;
+				f.tsExpiry = e.tsExpiry;
+				inflight.push_back(f);
+				inflightLane[f.lane]++;
+				stats.sent++;
+			} else {
+				metrics.failed(metric);
+				park(e);
+			}
+			continue;
+		}
+		if (periodic && (periodic_ms > 0) && (std::chrono::steady_clock::now() >= tsPeriodic + std::chrono::milliseconds(periodic_ms)))
+		{
+			tsPeriodic = std::chrono::steady_clock::now();
+			std::function<void()> fn = periodic;
+			pthread_mutex_unlock(&m_mutex);
+			fn();
+			pthread_mutex_lock(&m_mutex);
+			continue;
+		}
+		if (!parked.empty() && (std::chrono::steady_clock::now() >= tsRetry + std::chrono::milliseconds(PUBLISH_RETRY_MS)))
+		{
+			//failed while connected, the reconnect replay does not come
+			tsRetry = std::chrono::steady_clock::now();
+			if (transport.isConnected())
+			{
+				replay();
+				continue;
+			}
+		}
+		if (isIdle())
+		{
+			pthread_cond_broadcast(&m_condIdle);
+		}
+		timedwait(&m_condWork, (inflight.empty() && (npending == 0)) ? 100 : 10);
+	}
+	pthread_cond_broadcast(&m_condIdle);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,162 @@
+/*
+ * TxtMqttTopicPolicy.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMqttTopicPolicy.h"
+#include "TxtMqttFactoryClient.h"
+
+#include <iostream>
+
+
+namespace ft {
+
+
+typedef struct
+{
+	const char* filter;
+	TxtMqttPolicy_t policy; // qos, retained, expiry_s
+} DefaultRule_t;
+
+static const DefaultRule_t defaultRules[] = {
+	//telemetry: the next value follows, no PUBACK round trip
+	{ TOPIC_INPUT_LDR,          { 0, false, 60 } },
+	{ TOPIC_INPUT_BME680,       { 0, false, 60 } },
+	{ TOPIC_INPUT_CAM,          { 0, false, 0 } },
+	{ TOPIC_INPUT_CAM "/#",     { 0, false, 0 } },
+	{ TOPIC_INPUT_METRICS_ "#", { 0, false, 0 } },
+	{ TOPIC_LOCAL_SSC_JOY,      { 0, false, 1 } },
+	//states: retained for dashboards that connect later
+	{ TOPIC_INPUT_STATE_ "#",   { 1, true, 0 } },
+	{ TOPIC_INPUT_STOCK,        { 1, true, 0 } },
+	{ TOPIC_INPUT_STATE_ORDER,  { 1, true, 0 } },
+	{ TOPIC_INPUT_STATE_PICKUP, { 1, true, 0 } },
+	{ TOPIC_INPUT_STATE_STORE,  { 1, true, 0 } },
+	{ TOPIC_INPUT_PTUPOS,       { 1, true, 0 } },
+	//commands and events
+	{ "fl/#",                   { 1, false, 0 } },
+	{ "f/o/#",                  { 1, false, 0 } },
+	{ "o/#",                    { 1, false, 0 } },
+	{ "c/#",                    { 1, false, 0 } },
+	{ TOPIC_INPUT_ALERT,        { 1, false, 0 } },
+	{ TOPIC_INPUT_BROADCAST,    { 1, false, 0 } },
+	{ TOPIC_INPUT_NFC_DS,       { 1, false, 0 } },
+};
+
+
+TxtMqttTopicPolicy::TxtMqttTopicPolicy(int qos, bool retained)
+	: rules(), cache(), m_mutex()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttTopicPolicy qos:{} retained:{}", qos, retained);
+	dflt.qos = qos;
+	dflt.retained = retained;
+	dflt.expiry_s = 0;
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_mutex, &attr);
+	for (size_t i = 0; i < sizeof(defaultRules)/sizeof(defaultRules[0]); i++) {
+		set(defaultRules[i].filter, defaultRules[i].policy);
+	}
+}
+
+TxtMqttTopicPolicy::~TxtMqttTopicPolicy()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtMqttTopicPolicy");
+	pthread_mutex_destroy(&m_mutex);
+}
+
+size_t TxtMqttTopicPolicy::getRank(const std::string& filter)
+{
+	size_t pos = filter.find_first_of("+#");
+	return (pos == std::string::npos) ? (size_t)-1 : pos;
+}
+
+void TxtMqttTopicPolicy::set(const std::string& filter, const TxtMqttPolicy_t& p)
+{
+	pthread_mutex_lock(&m_mutex);
+	Rule_t r;
+	r.filter = filter;
+	r.policy = p;
+	r.policy.qos = (p.qos < 0) ? 0 : (p.qos > 2 ? 2 : p.qos);
+	r.rank = getRank(filter);
+	auto it = rules.begin();
+	for (; it != rules.end(); ++it) {
+		if (it->filter == filter) break;
+	}
+	if (it != rules.end()) {
+		*it = r;
+	} else {
+		//insert behind the rules of the same rank
+		auto pos = rules.begin();
+		while ((pos != rules.end()) && (pos->rank >= r.rank)) ++pos;
+		rules.insert(pos, r);
+	}
+	cache.clear();
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttTopicPolicy::set(const Json::Value& js)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "set json",0);
+	if (!js.isObject()) return;
+	pthread_mutex_lock(&m_mutex);
+	for (auto const& filter : js.getMemberNames()) {
+		const Json::Value& v = js[filter];
+		if (!v.isObject()) continue;
+		TxtMqttPolicy_t p = lookup(filter);
+		for (auto const& r : rules) {
+			if (r.filter == filter) p = r.policy;
+		}
+		p.qos = v.get("qos", p.qos).asInt();
+		p.retained = v.get("retained", p.retained).asBool();
+		p.expiry_s = v.get("expiry_s", (Json::Int64)p.expiry_s).asInt64();
+		std::cout << "topic policy " << filter << ": qos " << p.qos << " retained " << p.retained
+				<< " expiry " << p.expiry_s << "s" << std::endl;
+		set(filter, p);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+TxtMqttPolicy_t TxtMqttTopicPolicy::lookup(const std::string& topic)
+{
+	//rules are sorted by rank, the first match is the most specific one
+	for (auto const& r : rules) {
+		if (TxtMqttTransport::matches(r.filter, topic)) return r.policy;
+	}
+	return dflt;
+}
+
+TxtMqttPolicy_t TxtMqttTopicPolicy::get(const std::string& topic)
+{
+	pthread_mutex_lock(&m_mutex);
+	auto it = cache.find(topic);
+	if (it == cache.end()) {
+		it = cache.insert(std::make_pair(topic, lookup(topic))).first;
+	}
+	TxtMqttPolicy_t p = it->second;
+	pthread_mutex_unlock(&m_mutex);
+	return p;
+}
+
+void TxtMqttTopicPolicy::apply(mqtt::message_ptr msg)
+{
+	TxtMqttPolicy_t p = get(msg->get_topic());
+	msg->set_qos(p.qos);
+	msg->set_retained(p.retained);
+}
+
+void TxtMqttTopicPolicy::print()
+{
+	pthread_mutex_lock(&m_mutex);
+	for (auto const& r : rules) {
+		spdlog::get("console")->info("topic policy {}: qos:{} retained:{} expiry:{}s",
+				r.filter, r.policy.qos, r.policy.retained, r.policy.expiry_s);
+	}
+	spdlog::get("console")->info("topic policy default: qos:{} retained:{}", dflt.qos, dflt.retained);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,329 @@
+/*
+ * TxtMqttTopicRouter.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMqttTopicRouter.h"
+#include "TxtMqttFactoryClient.h"
+#include "TxtJsonReader.h"
+
+#include <string.h>
+#include <assert.h>
+#include <chrono>
+#include <sstream>
+
+
+#define ROUTER_TABLE_SIZE 64 // power of 2, more than twice TOPIC_ID_COUNT
+
+
+namespace ft {
+
+
+static const char* topicNames[TOPIC_ID_COUNT] = {
+	TOPIC_OUTPUT_PTU,
+	TOPIC_CONFIG_LINK,
+	TOPIC_CONFIG_BME680,
+	TOPIC_CONFIG_LDR,
+	TOPIC_CONFIG_CAM,
+	TOPIC_INPUT_STATE_HBW,
+	TOPIC_INPUT_STATE_VGR,
+	TOPIC_INPUT_STATE_MPO,
+	TOPIC_INPUT_STATE_SLD,
+	TOPIC_INPUT_STATE_DSI,
+	TOPIC_INPUT_STATE_DSO,
+	TOPIC_OUTPUT_STATE_ACK,
+	TOPIC_OUTPUT_ORDER,
+	TOPIC_OUTPUT_PICKUP,
+	TOPIC_OUTPUT_STORE,
+	TOPIC_OUTPUT_NFC_DS,
+	TOPIC_LOCAL_BROADCAST,
+	TOPIC_LOCAL_SSC_JOY,
+	TOPIC_LOCAL_MPO_ACK,
+	TOPIC_LOCAL_VGR_DO,
+	TOPIC_LOCAL_HBW_ACK,
+	TOPIC_LOCAL_HBW_FAULT,
+	TOPIC_LOCAL_SLD_ACK
+};
+
+static uint32_t fnv1a(const char* s, size_t len)
+{
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+typedef struct
+{
+	uint32_t hash;
+	int id; // TOPIC_ID_UNKNOWN: empty slot
+} Slot_t;
+
+class TopicTable
+{
+public:
+	TopicTable()
+	{
+		for (int i = 0; i < ROUTER_TABLE_SIZE; i++) {
+			slot[i].hash = 0;
+			slot[i].id = TOPIC_ID_UNKNOWN;
+		}
+		for (int id = 0; id < TOPIC_ID_COUNT; id++) {
+			uint32_t h = fnv1a(topicNames[id], strlen(topicNames[id]));
+			uint32_t i = h & (ROUTER_TABLE_SIZE-1);
+			while (slot[i].id != TOPIC_ID_UNKNOWN) {
+				i = (i + 1) & (ROUTER_TABLE_SIZE-1);
+			}
+			slot[i].hash = h;
+			slot[i].id = id;
+		}
+	}
+	Slot_t slot[ROUTER_TABLE_SIZE];
+};
+
+static const TopicTable topicTable;
+
+
+//keys are string literals, the length check rejects most keys without memcmp
+template<size_t N> static inline bool isKey(const char* key, size_t len, const char (&k)[N]) { return (len == N-1) && (memcmp(key, k, N-1) == 0); }
+
+
+TxtMqttTopicRouter::TxtMqttTopicRouter()
+	: reader()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttTopicRouter",0);
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_mutex, &attr);
+	for (int id = 0; id < TOPIC_ID_COUNT; id++) {
+		handlers[id].fields = 0;
+		handlers[id].checkTTL = false;
+	}
+	resetStats();
+	Json::CharReaderBuilder builder;
+	reader.reset(builder.newCharReader());
+}
+
+TxtMqttTopicRouter::~TxtMqttTopicRouter()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "~TxtMqttTopicRouter",0);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+TxtMqttTopicId_t TxtMqttTopicRouter::lookup(const char* topic, size_t len)
+{
+	uint32_t h = fnv1a(topic, len);
+	uint32_t i = h & (ROUTER_TABLE_SIZE-1);
+	while (topicTable.slot[i].id != TOPIC_ID_UNKNOWN) {
+		const Slot_t& s = topicTable.slot[i];
+		if ((s.hash == h) && (strncmp(topicNames[s.id], topic, len) == 0) && (topicNames[s.id][len] == 0)) {
+			return (TxtMqttTopicId_t)s.id;
+		}
+		i = (i + 1) & (ROUTER_TABLE_SIZE-1);
+	}
+	return TOPIC_ID_UNKNOWN;
+}
+
+const char* TxtMqttTopicRouter::getTopic(TxtMqttTopicId_t id)
+{
+	if ((id < 0) || (id >= TOPIC_ID_COUNT)) return "";
+	return topicNames[id];
+}
+
+void TxtMqttTopicRouter::add(TxtMqttTopicId_t id, unsigned int fields, TxtMqttHandler_t handler, bool checkTTL)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "add topic:{} fields:{:x} checkTTL:{}", getTopic(id), fields, checkTTL);
+	assert((id >= 0) && (id < TOPIC_ID_COUNT));
+	if (checkTTL) fields |= FIELD_TS;
+	pthread_mutex_lock(&m_mutex);
+	handlers[id].fn = handler;
+	handlers[id].fields = fields;
+	handlers[id].checkTTL = checkTTL;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttTopicRouter::remove(TxtMqttTopicId_t id)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "remove topic:{}", getTopic(id));
+	assert((id >= 0) && (id < TOPIC_ID_COUNT));
+	pthread_mutex_lock(&m_mutex);
+	handlers[id].fn = nullptr;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+std::vector<std::string> TxtMqttTopicRouter::getTopics()
+{
+	std::vector<std::string> topics;
+	pthread_mutex_lock(&m_mutex);
+	for (int id = 0; id < TOPIC_ID_COUNT; id++) {
+		if (handlers[id].fn) {
+			topics.push_back(topicNames[id]);
+		}
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return topics;
+}
+
+bool TxtMqttTopicRouter::dispatch(mqtt::const_message_ptr msg)
+{
+	assert(msg);
+	auto start = std::chrono::steady_clock::now();
+	const std::string& topic = msg->get_topic();
+	TxtMqttTopicId_t id = lookup(topic);
+	if (id == TOPIC_ID_UNKNOWN) {
+		return false;
+	}
+	//handlers are registered before the client connects, the callback thread only reads them
+	Handler_t& h = handlers[id];
+	if (!h.fn) {
+		return false;
+	}
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "DETECTED {} id:{}", topic, (int)id);
+
+	TxtMqttMessage m(id, msg);
+	bool expired = false;
+	bool error = false;
+	std::string errs;
+	const std::string& payload = msg->get_payload();
+	try {
+		if (!decode(payload.data(), payload.size(), h.fields, m, errs)) {
+			std::cout << "Error: " << topic << ": " << errs << std::endl;
+			error = true;
+		} else {
+			SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "  ts:{} code:{}", m.ts, m.code);
+			if (h.checkTTL && !trycheckTimestampTTL(m.ts)) {
+				expired = true;
+			} else {
+				h.fn(m);
+			}
+		}
+	} catch (const Json::Exception& exc) {
+		std::cout << "Error: " << exc.what() << std::endl;
+		error = true;
+	}
+
+	auto dur = std::chrono::steady_clock::now() - start;
+	double us = std::chrono::duration_cast< std::chrono::duration<double, std::micro> >(dur).count();
+	pthread_mutex_lock(&m_mutex);
+	if (expired) h.stats.expired++;
+	if (error) h.stats.errors++;
+	record(h, us);
+	pthread_mutex_unlock(&m_mutex);
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "OK. {}us", us);
+	return true;
+}
+
+bool TxtMqttTopicRouter::decode(const char* data, size_t size, unsigned int fields, TxtMqttMessage& m, std::string& errs)
+{
+	if (fields & FIELD_ROOT) {
+		if (!reader->parse(data, data + size, &m.root, &errs)) {
+			return false;
+		}
+		if (m.root.isObject()) {
+			m.ts = m.root["ts"].asString();
+			m.code = m.root["code"].asInt();
+		}
+		fields &= ~FIELD_ROOT;
+		if (fields == 0) return true;
+	}
+	TxtJsonReader r(data, size);
+	if (!r.beginObject()) {
+		errs = "object expected";
+		return false;
+	}
+	const char* key;
+	size_t len;
+	while (r.nextMember(key, len)) {
+		if ((fields & FIELD_TS) && isKey(key, len, "ts")) {
+			r.readString(m.ts);
+		} else if ((fields & FIELD_CODE) && isKey(key, len, "code")) {
+			r.readInt(m.code);
+		} else if ((fields & FIELD_WORKPIECE) && isKey(key, len, "workpiece")) {
+			m.hasWorkpiece = !r.readNull() && r.readWorkpiece(m.wp);
+		} else if ((fields & FIELD_TYPE) && isKey(key, len, "type")) {
+			r.readWPType(m.type);
+		} else if ((fields & FIELD_ID) && isKey(key, len, "id")) {
+			r.readString(m.sid);
+		} else if ((fields & FIELD_CMD) && isKey(key, len, "cmd")) {
+			r.readString(m.cmd);
+		} else if ((fields & FIELD_JOY) && isKey(key, len, "aX1")) {
+			r.readInt(m.joy.aX1);
+		} else if ((fields & FIELD_JOY) && isKey(key, len, "aY1")) {
+			r.readInt(m.joy.aY1);
+		} else if ((fields & FIELD_JOY) && isKey(key, len, "b1")) {
+			r.readBool(m.joy.b1);
+		} else if ((fields & FIELD_JOY) && isKey(key, len, "aX2")) {
+			r.readInt(m.joy.aX2);
+		} else if ((fields & FIELD_JOY) && isKey(key, len, "aY2")) {
+			r.readInt(m.joy.aY2);
+		} else if ((fields & FIELD_JOY) && isKey(key, len, "b2")) {
+			r.readBool(m.joy.b2);
+		} else {
+			r.skipValue();
+		}
+	}
+	if (!r.ok()) {
+		std::ostringstream sout;
+		sout << "syntax error at offset " << r.getErrorOffset();
+		errs = sout.str();
+		return false;
+	}
+	return true;
+}
+
+void TxtMqttTopicRouter::record(Handler_t& h, double us)
+{
+	h.stats.count++;
+	h.sum_us += us;
+	h.stats.avg_us = h.sum_us / h.stats.count;
+	if (us > h.stats.max_us) h.stats.max_us = us;
+	int b = 0;
+	uint64_t u = (uint64_t)us;
+	while ((u > 0) && (b < ROUTER_HIST_BUCKETS-1)) {
+		u >>= 1;
+		b++;
+	}
+	h.stats.hist[b]++;
+}
+
+TxtMqttHandlerStats TxtMqttTopicRouter::getStats(TxtMqttTopicId_t id)
+{
+	assert((id >= 0) && (id < TOPIC_ID_COUNT));
+	pthread_mutex_lock(&m_mutex);
+	TxtMqttHandlerStats s = handlers[id].stats;
+	pthread_mutex_unlock(&m_mutex);
+	return s;
+}
+
+void TxtMqttTopicRouter::resetStats()
+{
+	pthread_mutex_lock(&m_mutex);
+	for (int id = 0; id < TOPIC_ID_COUNT; id++) {
+		memset(&handlers[id].stats, 0, sizeof(TxtMqttHandlerStats));
+		handlers[id].sum_us = 0.0;
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TxtMqttTopicRouter::printStats()
+{
+	pthread_mutex_lock(&m_mutex);
+	for (int id = 0; id < TOPIC_ID_COUNT; id++) {
+		const TxtMqttHandlerStats& s = handlers[id].stats;
+		if (s.count == 0) continue;
+		std::ostringstream sout;
+		for (int b = 0; b < ROUTER_HIST_BUCKETS; b++) {
+			sout << s.hist[b] << (b < ROUTER_HIST_BUCKETS-1 ? " " : "");
+		}
+		spdlog::get("console")->info("{}: count:{} expired:{} errors:{} avg:{}us max:{}us hist:[{}]",
+				topicNames[id], s.count, s.expired, s.errors, s.avg_us, s.max_us, sout.str());
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+
+} /* namespace ft */
@@ -0,0 +1,127 @@
+/*
+ * TxtMqttTransport.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TxtMqttTransport.h"
+#include "TxtMqttLoopback.h"
+
+
+namespace ft {
+
+
+class TxtMqttPahoDelivery : public TxtMqttDelivery
+{
+public:
+	TxtMqttPahoDelivery(mqtt::delivery_token_ptr tok) : tok(tok) {}
+	bool isComplete() override { return tok->is_complete(); }
+	int getReturnCode() override { return tok->get_return_code(); }
+
+protected:
+	mqtt::delivery_token_ptr tok;
+};
+
+
+TxtMqttTransport* TxtMqttTransport::create(const std::string& host, const std::string& port, const std::string& clientId,
+		const std::string& user, mqtt::binary_ref pass)
+{
+	if (host == TRANSPORT_LOOPBACK_HOST) {
+		spdlog::get("console")->info("mqtt transport: in-process loopback, client {}", clientId);
+		return new TxtMqttLoopback(clientId);
+	}
+	return new TxtMqttPahoTransport("tcp://" + host + ":" + port, clientId, user, pass);
+}
+
+
+bool TxtMqttTransport::matches(const std::string& filter, const std::string& topic)
+{
+	size_t f = 0, t = 0;
+	const size_t fn = filter.size(), tn = topic.size();
+	//wildcards at the first level do not match $SYS/...
+	if ((tn > 0) && (topic[0] == '$') && (fn > 0) && ((filter[0] == '#') || (filter[0] == '+'))) return false;
+	while (f < fn) {
+		if (filter[f] == '#') return true;
+		if (filter[f] == '+') {
+			while ((t < tn) && (topic[t] != '/')) t++;
+			f++;
+		} else {
+			while ((f < fn) && (filter[f] != '/')) {
+				if ((t >= tn) || (topic[t] != filter[f])) return false;
+				f++;
+				t++;
+			}
+			if ((t < tn) && (topic[t] != '/')) return false;
+		}
+		//end of a level
+		if (f == fn) return t == tn;
+		if (t == tn) return filter.compare(f, std::string::npos, "/#") == 0; //"a/#" matches "a"
+		f++;
+		t++;
+	}
+	return t == tn;
+}
+
+
+TxtMqttPahoTransport::TxtMqttPahoTransport(const std::string& serverURI, const std::string& clientId,
+		const std::string& user, mqtt::binary_ref pass)
+	: cli(serverURI, clientId), connOpts(), aListSub(), aListPub()
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "TxtMqttPahoTransport serverURI:{} clientId:{}", serverURI, clientId);
+	connOpts.set_connect_timeout(90);
+	connOpts.set_keep_alive_interval(60);
+	connOpts.set_clean_session(true);
+	connOpts.set_automatic_reconnect(true);
+	//connOpts.set_max_inflight(20);
+	connOpts.set_mqtt_version(MQTTVERSION_3_1_1);
+	connOpts.set_user_name(user);
+	connOpts.set_password(pass);
+}
+
+void TxtMqttPahoTransport::setWill(const mqtt::message& msg)
+{
+	mqtt::will_options will(msg);
+	connOpts.set_will(will);
+}
+
+int TxtMqttPahoTransport::setMqttVersion(int version)
+{
+	//the paho library of the TXT implements 3.1 and 3.1.1 only, no MQTT 5 properties
+	if (version != MQTTVERSION_3_1) version = MQTTVERSION_3_1_1;
+	connOpts.set_mqtt_version(version);
+	return version;
+}
+
+bool TxtMqttPahoTransport::connect(long timeout)
+{
+	mqtt::token_ptr conntok = cli.connect(connOpts);
+	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "conntok->wait_for {}", timeout);
+	return conntok->wait_for(timeout);
+}
+
+bool TxtMqttPahoTransport::disconnect(long timeout)
+{
+	mqtt::token_ptr conntok = cli.disconnect();
+	return conntok->wait_for(timeout);
+}
+
+void TxtMqttPahoTransport::subscribe(const std::vector<std::string>& topics, int qos, std::function<void(bool)> done)
+{
+	aListSub.setDone(done);
+	mqtt::iasync_client::qos_collection qc(topics.size(), qos);
+	cli.subscribe(mqtt::string_collection::create(topics), qc, nullptr, aListSub);
+}
+
+bool TxtMqttPahoTransport::unsubscribe(const std::vector<std::string>& topics, long timeout)
+{
+	mqtt::token_ptr unsubtok = cli.unsubscribe(mqtt::string_collection::create(topics));
+	return unsubtok->wait_for(timeout);
+}
+
+TxtMqttDeliveryPtr TxtMqttPahoTransport::publish(mqtt::const_message_ptr msg)
+{
+	return std::make_shared<TxtMqttPahoDelivery>(cli.publish(msg, nullptr, aListPub));
+}
+
+
+} /* namespace ft */
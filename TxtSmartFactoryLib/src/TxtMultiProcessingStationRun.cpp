@@ -314,6 +314,7 @@ void TxtMultiProcessingStation::run()
 
 	assert(mqttclient);
 	mqttclient->publishMPO_Ack(MPO_EXIT, TIMEOUT_MS_PUBLISH);
+	mqttclient->flush(TIMEOUT_MS_PUBLISH);
 }
 
 
@@ -459,6 +459,7 @@ void TxtSortingLine::run()
 
 	assert(mqttclient);
 	mqttclient->publishSLD_Ack(SLD_EXIT, ft::WP_TYPE_NONE, 0, TIMEOUT_MS_PUBLISH);
+	mqttclient->flush(TIMEOUT_MS_PUBLISH);
 }
 
 
@@ -1232,6 +1232,7 @@ void TxtVacuumGripperRobot::run()
 	assert(mqttclient);
 	mqttclient->publishVGR_Do(VGR_EXIT, 0, TIMEOUT_MS_PUBLISH);
 	initDashboard();
+	mqttclient->flush(TIMEOUT_MS_PUBLISH);
 }
 
 
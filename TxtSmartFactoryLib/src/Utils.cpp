@@ -8,6 +8,8 @@
 #include "Utils.h"
 
 #include <algorithm>
+#include <stdint.h>
+#include <stdexcept>
 
 #ifndef NO_MQTT
 #include "opencv2/opencv.hpp"
@@ -17,143 +19,186 @@
 namespace ft {
 
 
-// returns difference in seconds from UTC at current time if not specified
-long time_offset()
+#define NS_PER_S 1000000000LL
+
+
+// days since 1970-01-01 of a proleptic gregorian date (H. Hinnant, days_from_civil)
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
 {
-	time_t when = std::time(nullptr);
-    auto const tm = *std::localtime(&when);
-    std::ostringstream os;
-    os << std::put_time(&tm, "%z");
-    std::string s = os.str();
-    // s is in ISO 8601 format: "±HHMM"
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "±HHMM {}", s);
-    int h = std::stoi(s.substr(0,3), nullptr, 10);
-    int m = std::stoi(s[0]+s.substr(3), nullptr, 10);
-    return h * 3600 + m * 60;
+	y -= m <= 2;
+	const int64_t era = (y >= 0 ? y : y-399) / 400;
+	const unsigned yoe = (unsigned)(y - era * 400);
+	const unsigned doy = (153*(m + (m > 2 ? -3 : 9)) + 2)/5 + d-1;
+	const unsigned doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+	return era * 146097 + (int64_t)doe - 719468;
 }
 
-bool trycheckTimestampTTL(const std::string& str, double diff_max)
+// inverse of daysFromCivil (H. Hinnant, civil_from_days)
+static void civilFromDays(int64_t z, int& y, unsigned& m, unsigned& d)
 {
-	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "checkTimestamp: {} offset secs:{}",str, std::chrono::seconds(time_offset()).count());
-	auto start = ft::trygettimepoint(str) + std::chrono::seconds(time_offset());
-	auto now = std::chrono::system_clock::now();
-
-	auto itt_start = std::chrono::system_clock::to_time_t(start);
-	std::ostringstream ss_start;
-	ss_start << std::put_time(std::gmtime(&itt_start), "%FT%TZ");
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "ss_start.str():{}", ss_start.str());
+	z += 719468;
+	const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	const unsigned doe = (unsigned)(z - era * 146097);
+	const unsigned yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+	const unsigned doy = doe - (365*yoe + yoe/4 - yoe/100);
+	const unsigned mp = (5*doy + 2)/153;
+	d = doy - (153*mp+2)/5 + 1;
+	m = mp + (mp < 10 ? 3 : -9);
+	y = (int)((int64_t)yoe + era * 400 + (m <= 2));
+}
 
-	auto itt_now = std::chrono::system_clock::to_time_t(now);
-	std::ostringstream ss_now;
-	ss_now << std::put_time(std::gmtime(&itt_now), "%FT%TZ");
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "ss_now.str():{}", ss_now.str());
+static inline bool readDigits(const char*& p, int n, int& v)
+{
+	v = 0;
+	for (int i = 0; i < n; i++) {
+		unsigned c = (unsigned char)p[i] - '0';
+		if (c > 9) return false;
+		v = v * 10 + (int)c;
+	}
+	p += n;
+	return true;
+}
 
-	auto dur = now-start;
-	auto diff_s = std::abs(std::chrono::duration_cast< std::chrono::duration<float> >(dur).count());
+static inline void writeDigits(char* p, int n, unsigned v)
+{
+	for (int i = n-1; i >= 0; i--) {
+		p[i] = (char)('0' + v % 10);
+		v /= 10;
+	}
+}
 
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "str:{} diff_s:{} diff_max:{}", str.c_str(), diff_s, diff_max);
+int64_t getnowtimestamp_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * NS_PER_S + ts.tv_nsec;
+}
 
-	bool r = (diff_s < diff_max);
-	if (!r)
-	{
-		spdlog::get("file_logger")->info("str:{} diff_s:{} diff_max:{}", str.c_str(), diff_s, diff_max);
-		//spdlog::get("file_logger")->info("Wrong date and time! try to execute: sudo ntpdate -u pool.ntp.org");
-		//int r = system("sudo ntpdate -u pool.ntp.org");
-		spdlog::get("file_logger")->info("  RETURN {}", r);
+bool parsetimestamp(const char* s, size_t len, int64_t& timestamp)
+{
+	//"YYYY-MM-DDTHH:MM:SS[.f...][Z]"
+	if (len < 19) return false;
+	const char* p = s;
+	const char* end = s + len;
+	int y, mo, d, h, mi, sec;
+	if (!readDigits(p, 4, y) || (*p++ != '-')) return false;
+	if (!readDigits(p, 2, mo) || (*p++ != '-')) return false;
+	if (!readDigits(p, 2, d) || ((*p != 'T') && (*p != ' '))) return false;
+	p++;
+	if (!readDigits(p, 2, h) || (*p++ != ':')) return false;
+	if (!readDigits(p, 2, mi) || (*p++ != ':')) return false;
+	if (!readDigits(p, 2, sec)) return false;
+	if ((mo < 1) || (mo > 12) || (d < 1) || (d > 31) || (h > 23) || (mi > 59) || (sec > 60)) return false;
+	int64_t frac = 0;
+	if ((p < end) && (*p == '.')) {
+		p++;
+		int64_t scale = NS_PER_S;
+		const char* f = p;
+		while ((p < end) && ((unsigned)(*p - '0') <= 9)) {
+			if (scale > 1) {
+				scale /= 10;
+				frac += (*p - '0') * scale;
+			}
+			p++;
+		}
+		if (p == f) return false;
 	}
-	return r;
+	if ((p < end) && (*p == 'Z')) p++;
+	if (p != end) return false;
+	int64_t days = daysFromCivil(y, mo, d);
+	timestamp = ((days * 24 + h) * 60 + mi) * 60 * NS_PER_S + (int64_t)sec * NS_PER_S + frac;
+	return true;
 }
 
 void gettimestampstr(int64_t timestamp, char* sts) {
 	//SPDLOG_LOGGER_TRACE(spdlog::get("console"), "gettimestampstr");
-	time_t epch = timestamp/1000000000.;
-	double temp_modf_integer_part;
-	int ms = modf(timestamp/1000000000., &temp_modf_integer_part) * 1000.;
-
-	struct tm * timeinfo;
-	timeinfo = gmtime ( &epch ); //UTC
-	sprintf(sts, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
-			timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
-			timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, ms);
+	int64_t secs = timestamp / NS_PER_S;
+	int64_t ns = timestamp % NS_PER_S;
+	if (ns < 0) {
+		ns += NS_PER_S;
+		secs--;
+	}
+	gettimestr((time_t)secs, (int)(ns / 1000000), sts);
 }
 
 void gettimestr(time_t rawtime, int ms, char* sts) {
 	//SPDLOG_LOGGER_TRACE(spdlog::get("console"), "gettimestr");
-	struct tm * timeinfo;
-	//time ( &rawtime );
-	timeinfo = gmtime ( &rawtime ); //UTC
-	sprintf(sts, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
-			timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
-			timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, ms);
+	//"YYYY-MM-DDTHH:MM:SS.mmmZ" UTC, same as strftime/gmtime but without locale
+	int64_t t = rawtime;
+	int64_t days = t / 86400;
+	int64_t sod = t % 86400;
+	if (sod < 0) {
+		sod += 86400;
+		days--;
+	}
+	int y;
+	unsigned m, d;
+	civilFromDays(days, y, m, d);
+	writeDigits(sts, 4, (unsigned)y);
+	sts[4] = '-';
+	writeDigits(sts+5, 2, m);
+	sts[7] = '-';
+	writeDigits(sts+8, 2, d);
+	sts[10] = 'T';
+	writeDigits(sts+11, 2, (unsigned)(sod / 3600));
+	sts[13] = ':';
+	writeDigits(sts+14, 2, (unsigned)((sod / 60) % 60));
+	sts[16] = ':';
+	writeDigits(sts+17, 2, (unsigned)(sod % 60));
+	sts[19] = '.';
+	writeDigits(sts+20, 3, (unsigned)ms);
+	sts[23] = 'Z';
+	sts[24] = 0;
 }
 
 void getnowstr(char* sts) {
 	//SPDLOG_LOGGER_TRACE(spdlog::get("console"), "getnowstr");
-	struct timespec ts;
-	timespec_get(&ts, TIME_UTC);
-	struct timespec {
-		time_t   tv_sec;        /* seconds */
-		long     tv_nsec;       /* nanoseconds */
-	};
-	time_t epch = ts.tv_sec;
-	gettimestr(epch, (int)(ts.tv_nsec/1000000), sts);
+	gettimestampstr(getnowtimestamp_ns(), sts);
 }
 
 double getnowtimestamp_s() {
 	//SPDLOG_LOGGER_TRACE(spdlog::get("console"), "getnowtimestamp");
 	struct timespec ts;
-	timespec_get(&ts, TIME_UTC);
-	struct timespec {
-		time_t   tv_sec;        /* seconds */
-		long     tv_nsec;       /* nanoseconds */
-	};
-	time_t epch = ts.tv_sec;
-	double ms = ts.tv_nsec/1000000000.;
-	//SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "epch:{} ms:{}", epch, ms);
-	return (double)epch+ms;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec/1000000000.;
+}
+
+bool checkTimestampTTL(const char* s, size_t len, int64_t ttl_ns)
+{
+	int64_t timestamp;
+	if (!parsetimestamp(s, len, timestamp)) {
+		spdlog::get("file_logger")->info("str:{} invalid timestamp", std::string(s, len));
+		return false;
+	}
+	int64_t diff = getnowtimestamp_ns() - timestamp;
+	if (diff < 0) diff = -diff;
+	bool r = (diff < ttl_ns);
+	if (!r)
+	{
+		spdlog::get("file_logger")->info("str:{} diff_s:{} diff_max:{}", std::string(s, len), diff / 1e9, ttl_ns / 1e9);
+		//spdlog::get("file_logger")->info("Wrong date and time! try to execute: sudo ntpdate -u pool.ntp.org");
+		//int r = system("sudo ntpdate -u pool.ntp.org");
+		spdlog::get("file_logger")->info("  RETURN {}", r);
+	}
+	return r;
+}
+
+bool trycheckTimestampTTL(const std::string& str, double diff_max)
+{
+	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "checkTimestamp: {}", str);
+	return checkTimestampTTL(str.data(), str.size(), (int64_t)(diff_max * NS_PER_S));
 }
 
 std::chrono::system_clock::time_point trygettimepoint(const std::string& str)
 {
 	SPDLOG_LOGGER_TRACE(spdlog::get("console"), "gettimepoint {}",str);
-	std::string _str = str;
-	replace(_str.begin(), _str.end(), 'T', ' ');
-	_str = _str.substr(0,_str.length()-1); // ...Z
-	//_str = _str.substr(0,_str.find(".")); // .XXX
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "replace {}",_str);
-    std::istringstream iss{_str};
-    std::tm tm = {0};
-    tm.tm_isdst = -1; //initialize!
-    if (!(iss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S")))//"%F %T")))
-    {
-    	std::cout << "te1" << std::endl;
-        throw std::invalid_argument("get_time str:"+_str);
-    }
-    time_t t = std::mktime(&tm); //FIXME statt 15Uhr, 14Uhr -1h Unterschied, std::mktime falsch
-	char sts[25];
-    gettimestr(t, 0, sts);
-    SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "sts {}", sts);
-
-    std::chrono::system_clock::time_point tp = std::chrono::system_clock::from_time_t(t);
-
-	auto itt_tp = std::chrono::system_clock::to_time_t(tp);
-	std::ostringstream ss_tp;
-	ss_tp << std::put_time(std::gmtime(&itt_tp), "%FT%TZ");
-	SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "ss_tp.str():{}", ss_tp.str());
-
-    if (iss.eof())
-    {
-        return tp;
-    }
-    double zz;
-    if (iss.peek() != '.' || !(iss >> zz))
-    {
-        throw std::invalid_argument("decimal str:"+_str);
-    }
-    using hr_clock = std::chrono::high_resolution_clock;
-    std::size_t nanoseconds = zz * hr_clock::period::den / hr_clock::period::num;
-    SPDLOG_LOGGER_DEBUG(spdlog::get("console"), "frac seconds {}",(double)(nanoseconds)/1000000000.);
-    return tp += hr_clock::duration(nanoseconds);
+	int64_t timestamp;
+	if (!parsetimestamp(str.data(), str.size(), timestamp))
+	{
+		throw std::invalid_argument("get_time str:"+str);
+	}
+	return std::chrono::system_clock::time_point(
+			std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(timestamp)));
 }
 
 #ifndef NO_MQTT
@@ -164,6 +209,20 @@ std::string ftos(float f, int nd) {
     ostr << round(f*tens)/tens;
     return ostr.str();
 }
+
+int ftoa(float f, int nd, char* buf, size_t size) {
+	static const int pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+	int tens = pow10[nd];
+	//same rounding and "%g" format as ftos
+	return snprintf(buf, size, "%g", (double)(round(f*tens)/tens));
+}
+
+double ftod(float f, int nd) {
+	char buf[32];
+	ftoa(f, nd, buf, sizeof(buf));
+	double d = strtod(buf, NULL);
+	return std::isfinite(d) ? d : 0.0; //istream does not parse "inf" and "nan"
+}
 #endif
 
 
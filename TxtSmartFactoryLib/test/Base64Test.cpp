@@ -0,0 +1,124 @@
+/*
+ * Base64Test.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//block encoders of base64.cpp against the byte-wise encoder of version 1.01.00,
+//built once per variant: SWAR, -mssse3 and -mavx2 (see Makefile)
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "TxtTest.h"
+#include "base64.h"
+
+
+namespace ft {
+
+
+static const char reference_chars[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz"
+		"0123456789+/";
+
+//base64_encode of version 1.01.00
+static std::string reference(unsigned char const* bytes_to_encode, unsigned int in_len) {
+	std::string ret;
+	int i = 0;
+	int j = 0;
+	unsigned char char_array_3[3];
+	unsigned char char_array_4[4];
+	while (in_len--) {
+		char_array_3[i++] = *(bytes_to_encode++);
+		if (i == 3) {
+			char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+			char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+			char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+			char_array_4[3] = char_array_3[2] & 0x3f;
+			for (i = 0; i < 4; i++) ret += reference_chars[char_array_4[i]];
+			i = 0;
+		}
+	}
+	if (i) {
+		for (j = i; j < 3; j++) char_array_3[j] = '\0';
+		char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+		char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+		char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+		for (j = 0; j < i + 1; j++) ret += reference_chars[char_array_4[j]];
+		while (i++ < 3) ret += '=';
+	}
+	return ret;
+}
+
+static void testVectors() {
+	//RFC 4648
+	const char* in[] = { "", "f", "fo", "foo", "foob", "fooba", "foobar" };
+	const char* out[] = { "", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+	for (size_t i = 0; i < sizeof(in)/sizeof(in[0]); i++) {
+		CHECK_EQ(base64_encode((unsigned char const*)in[i], (unsigned int)strlen(in[i])), std::string(out[i]));
+	}
+}
+
+static void testLengths() {
+	//all lengths around the block sizes of the variants (6, 12, 24, 48 bytes) and their tails,
+	//at all alignments of the input
+	std::vector<unsigned char> buf(512 + 16);
+	srand(1);
+	for (size_t i = 0; i < buf.size(); i++) buf[i] = (unsigned char)rand();
+	int mismatch = 0;
+	for (size_t off = 0; off < 16; off++) {
+		for (size_t len = 0; len <= 512; len++) {
+			const unsigned char* p = &buf[off];
+			std::string r = reference(p, (unsigned int)len);
+			std::string s = base64_encode(p, (unsigned int)len);
+			if (s != r) mismatch++;
+			//into a caller buffer: exact size, nothing written behind it
+			std::string b(base64_encoded_size(len) + 8, '#');
+			size_t n = base64_encode(p, len, &b[0]);
+			if ((n != r.size()) || (b.compare(0, n, r) != 0) || (b.compare(n, 8, "########") != 0)) mismatch++;
+			if (base64_decode(s) != std::string((const char*)p, len)) mismatch++;
+		}
+	}
+	CHECK_EQ(mismatch, 0);
+}
+
+static void testAllBytes() {
+	//all values in all positions of a 3-byte group
+	std::vector<unsigned char> buf(3 * 256);
+	for (size_t i = 0; i < buf.size(); i++) buf[i] = (unsigned char)(i / 3 + (i % 3) * 85);
+	CHECK_EQ(base64_encode(&buf[0], (unsigned int)buf.size()), reference(&buf[0], (unsigned int)buf.size()));
+	for (size_t i = 0; i < buf.size(); i++) buf[i] = (unsigned char)(255 - i / 3);
+	CHECK_EQ(base64_encode(&buf[0], (unsigned int)buf.size()), reference(&buf[0], (unsigned int)buf.size()));
+}
+
+static void testLarge() {
+	//camera frame size
+	std::vector<unsigned char> buf(320 * 240 / 4 * 3 + 7);
+	for (size_t i = 0; i < buf.size(); i++) buf[i] = (unsigned char)(i * 2654435761u >> 24);
+	auto ts = std::chrono::steady_clock::now();
+	std::string s = base64_encode(&buf[0], (unsigned int)buf.size());
+	double us = elapsed_us(ts);
+	CHECK_EQ(s, reference(&buf[0], (unsigned int)buf.size()));
+	std::cout << "base64_encode " << buf.size() << " bytes: " << us << " us" << std::endl;
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+#if defined(__AVX2__)
+	std::cout << "base64 AVX2" << std::endl;
+#elif defined(__SSSE3__)
+	std::cout << "base64 SSSE3" << std::endl;
+#else
+	std::cout << "base64 SWAR" << std::endl;
+#endif
+	ft::testVectors();
+	ft::testLengths();
+	ft::testAllBytes();
+	ft::testLarge();
+	return TEST_RESULT();
+}
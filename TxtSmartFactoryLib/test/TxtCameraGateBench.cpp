@@ -0,0 +1,153 @@
+/*
+ * TxtCameraGateBench.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//cost of the change gate counters in the capture thread while other threads read them:
+//a mutex around the counters, locked increments of atomics and TxtCameraGate
+//(single writer, relaxed load and store)
+
+#include <pthread.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "TxtTest.h"
+#include "TxtCameraGate.h"
+
+
+namespace ft {
+
+
+#define BENCH_FRAMES 5000000
+#define BENCH_READERS_MAX 3
+
+
+//counters under a mutex, as with a lock shared with the stats readers
+class MutexGate
+{
+public:
+	MutexGate() : tsLast_ns(0), m_mutex() {
+		pthread_mutex_init(&m_mutex, 0);
+		st.changed = st.keepalive = st.unchanged = 0;
+	}
+	~MutexGate() { pthread_mutex_destroy(&m_mutex); }
+	bool update(bool first, uint32_t sad, int64_t ts_ns) {
+		bool c = first || (sad >= 2 * CAM_GATE_W * CAM_GATE_H);
+		pthread_mutex_lock(&m_mutex);
+		if (c) {
+			st.changed++;
+		} else if (ts_ns - tsLast_ns >= 10000000000LL) {
+			st.keepalive++;
+			c = true;
+		} else {
+			st.unchanged++;
+		}
+		pthread_mutex_unlock(&m_mutex);
+		if (c) tsLast_ns = ts_ns;
+		return c;
+	}
+	TxtCameraGateStats getStats() {
+		pthread_mutex_lock(&m_mutex);
+		TxtCameraGateStats s = st;
+		pthread_mutex_unlock(&m_mutex);
+		return s;
+	}
+protected:
+	TxtCameraGateStats st;
+	int64_t tsLast_ns;
+	pthread_mutex_t m_mutex;
+};
+
+//atomics with locked increments (operator++)
+class FetchAddGate
+{
+public:
+	FetchAddGate() : tsLast_ns(0), changed(0), keepalives(0), unchanged(0) {}
+	bool update(bool first, uint32_t sad, int64_t ts_ns) {
+		bool c = first || (sad >= 2 * CAM_GATE_W * CAM_GATE_H);
+		if (c) {
+			changed++;
+		} else if (ts_ns - tsLast_ns >= 10000000000LL) {
+			keepalives++;
+			c = true;
+		} else {
+			unchanged++;
+		}
+		if (c) tsLast_ns = ts_ns;
+		return c;
+	}
+	TxtCameraGateStats getStats() {
+		TxtCameraGateStats s;
+		s.changed = changed;
+		s.keepalive = keepalives;
+		s.unchanged = unchanged;
+		return s;
+	}
+protected:
+	int64_t tsLast_ns;
+	std::atomic<uint64_t> changed;
+	std::atomic<uint64_t> keepalives;
+	std::atomic<uint64_t> unchanged;
+};
+
+
+static volatile uint64_t sink;
+
+//ns per update() of the capture thread with readers polling getStats()
+template <class G>
+static double run(G& g, int readers, uint64_t& reads) {
+	std::atomic<bool> stop(false);
+	std::atomic<uint64_t> n(0);
+	std::vector<std::thread> threads;
+	for (int r = 0; r < readers; r++) {
+		threads.push_back(std::thread([&]() {
+			uint64_t i = 0, sum = 0;
+			while (!stop) {
+				sum += g.getStats().changed;
+				i++;
+			}
+			sink = sum;
+			n += i;
+		}));
+	}
+	auto ts = std::chrono::steady_clock::now();
+	uint64_t streamed = 0;
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		streamed += g.update(i == 0, (uint32_t)((i * 2654435761u) >> 20), (int64_t)i * 66000000LL);
+	}
+	double us = elapsed_us(ts);
+	stop = true;
+	for (auto& t : threads) t.join();
+	reads = n;
+	TxtCameraGateStats st = g.getStats();
+	CHECK_EQ(st.changed + st.keepalive + st.unchanged, (uint64_t)BENCH_FRAMES);
+	CHECK_EQ(st.changed + st.keepalive, streamed);
+	return us * 1000. / BENCH_FRAMES;
+}
+
+static void bench() {
+	std::cout << "readers  mutex_ns  fetch_add_ns  gate_ns  (reads/s mutex/fetch_add/gate)" << std::endl;
+	for (int readers = 0; readers <= BENCH_READERS_MAX; readers++) {
+		MutexGate m;
+		FetchAddGate f;
+		TxtCameraGate g;
+		uint64_t rm, rf, rg;
+		double nm = run(m, readers, rm);
+		double nf = run(f, readers, rf);
+		double ng = run(g, readers, rg);
+		std::cout << readers << "  " << nm << "  " << nf << "  " << ng << "  ("
+				<< rm * 1e9 / (nm * BENCH_FRAMES) << "/" << rf * 1e9 / (nf * BENCH_FRAMES) << "/"
+				<< rg * 1e9 / (ng * BENCH_FRAMES) << ")" << std::endl;
+	}
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::bench();
+	return TEST_RESULT();
+}
@@ -0,0 +1,101 @@
+/*
+ * TxtCameraGateTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//decisions of TxtCameraGate, counters read and settings changed during the capture
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "TxtTest.h"
+#include "TxtCameraGate.h"
+
+
+namespace ft {
+
+
+#define TEST_FRAMES 2000000
+#define TEST_READERS 3
+#define NS_PER_S 1000000000LL
+
+
+static void testDecision() {
+	TxtCameraGate g(2.0, 10.0);
+	CHECK(g.isEnabled());
+	const uint32_t th = 2 * CAM_GATE_W * CAM_GATE_H;
+	int64_t ts = 1000 * NS_PER_S;
+	//first frame: no reference
+	CHECK(g.update(true, 0, ts));
+	CHECK(!g.update(false, th - 1, ts + NS_PER_S));
+	CHECK(g.update(false, th, ts + 2 * NS_PER_S));
+	//keep-alive after 10s of unchanged frames, counted from the last changed frame
+	ts += 2 * NS_PER_S;
+	CHECK(!g.update(false, 0, ts + 10 * NS_PER_S - 1));
+	CHECK(g.update(false, 0, ts + 10 * NS_PER_S));
+	CHECK(!g.update(false, 0, ts + 11 * NS_PER_S));
+	TxtCameraGateStats st = g.getStats();
+	CHECK_EQ(st.changed, (uint64_t)2);
+	CHECK_EQ(st.keepalive, (uint64_t)1);
+	CHECK_EQ(st.unchanged, (uint64_t)3);
+
+	//a fraction of a gray value per pixel rounds the sum up
+	g.set(0.5001, 10.0);
+	CHECK(!g.update(false, 384, ts + 12 * NS_PER_S));
+	CHECK(g.update(false, 385, ts + 13 * NS_PER_S));
+	g.set(0., 10.0);
+	CHECK(!g.isEnabled());
+	CHECK(g.update(false, 0, ts + 14 * NS_PER_S));
+}
+
+static void testConcurrent() {
+	//the capture thread updates, readers poll the counters, the settings change meanwhile
+	TxtCameraGate g(2.0, 0.001);
+	std::atomic<bool> stop(false);
+	std::atomic<int> errors(0);
+	std::vector<std::thread> readers;
+	for (int n = 0; n < TEST_READERS; n++) {
+		readers.push_back(std::thread([&]() {
+			TxtCameraGateStats last = g.getStats();
+			while (!stop) {
+				TxtCameraGateStats st = g.getStats();
+				if ((st.changed < last.changed) || (st.keepalive < last.keepalive) || (st.unchanged < last.unchanged)
+						|| (st.changed + st.keepalive + st.unchanged > TEST_FRAMES)) {
+					errors++;
+				}
+				last = st;
+			}
+		}));
+	}
+	std::thread setter([&]() {
+		for (int i = 0; !stop; i++) {
+			g.set((i % 2) ? 1.0 : 3.0, 0.001);
+			std::this_thread::yield();
+		}
+	});
+	int streamed = 0;
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		if (g.update(i == 0, (uint32_t)(i % 5000), (int64_t)i * 1000)) streamed++;
+	}
+	stop = true;
+	for (auto& t : readers) t.join();
+	setter.join();
+	TxtCameraGateStats st = g.getStats();
+	CHECK_EQ(errors.load(), 0);
+	CHECK_EQ(st.changed + st.keepalive + st.unchanged, (uint64_t)TEST_FRAMES);
+	CHECK_EQ(st.changed + st.keepalive, (uint64_t)streamed);
+	CHECK(st.unchanged > 0);
+	CHECK(st.keepalive > 0);
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testDecision();
+	ft::testConcurrent();
+	return TEST_RESULT();
+}
@@ -0,0 +1,141 @@
+/*
+ * TxtJsonReaderTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//TxtJsonReader against Json::Value::asString()/asInt() of jsoncpp
+
+#include <string.h>
+#include <memory>
+
+#include "TxtTest.h"
+#include "TxtJsonReader.h"
+
+#include "json/json.h"
+
+
+namespace ft {
+
+
+static Json::Value parse(const std::string& doc) {
+	Json::CharReaderBuilder builder;
+	std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+	Json::Value root;
+	std::string errs;
+	reader->parse(doc.data(), doc.data() + doc.size(), &root, &errs);
+	return root;
+}
+
+//document {"v":<value>}: readString and readInt as jsoncpp
+static void checkValue(const std::string& value, bool isInt) {
+	std::string doc = "{\"v\":" + value + "}";
+	Json::Value root = parse(doc);
+	TxtJsonReader r(doc.data(), doc.size());
+	const char* key;
+	size_t len;
+	CHECK(r.beginObject());
+	CHECK(r.nextMember(key, len));
+	CHECK_EQ(std::string(key, len), std::string("v"));
+	if (isInt) {
+		int i = -1;
+		CHECK(r.readInt(i));
+		CHECK_EQ(i, root["v"].asInt());
+	} else {
+		std::string s;
+		CHECK(r.readString(s));
+		CHECK_EQ(s, root["v"].asString());
+	}
+	CHECK(!r.nextMember(key, len));
+	CHECK(r.ok());
+}
+
+static void testValues() {
+	checkValue("\"plain\"", false);
+	checkValue("\"\"", false);
+	checkValue("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"", false);
+	checkValue("\"\\u00e4\\u20ac\"", false);
+	checkValue("\"\\ud83d\\ude00\"", false);
+	checkValue("\"\xc3\xa4 raw utf-8\"", false);
+	checkValue("null", false);
+	checkValue("true", false);
+	checkValue("false", false);
+	checkValue("0", true);
+	checkValue("-42", true);
+	checkValue("123456789", true);
+	checkValue("2147483647", true);
+	checkValue("-2147483648", true);
+	checkValue("3.9", true);
+	checkValue("-2.5", true);
+	checkValue("1e2", true);
+	checkValue("true", true);
+	checkValue("null", true);
+}
+
+static void testSkip() {
+	//nested values of all kinds are skipped, members after them are read
+	std::string doc = " { \"a\" : [1, -2.5e-3, \"x]\", {\"b\":{\"c\":[]}}, true, null] ,\n"
+			"\"s\":\"}\", \"o\":{}, \"code\" : 7 , \"workpiece\":{\"id\":\"04a1\",\"x\":[1],\"state\":\"PROCESSED\",\"type\":\"WHITE\"}}";
+	TxtJsonReader r(doc.data(), doc.size());
+	const char* key;
+	size_t len;
+	int code = 0;
+	TxtWorkpiece wp;
+	CHECK(r.beginObject());
+	while (r.nextMember(key, len)) {
+		if ((len == 4) && (memcmp(key, "code", 4) == 0)) {
+			CHECK(r.readInt(code));
+		} else if ((len == 9) && (memcmp(key, "workpiece", 9) == 0)) {
+			CHECK(r.readWorkpiece(wp));
+		} else {
+			CHECK(r.skipValue());
+		}
+	}
+	CHECK(r.ok());
+	CHECK_EQ(code, 7);
+	CHECK_EQ(wp.tag_uid, std::string("04a1"));
+	CHECK_EQ(wp.state, WP_STATE_PROCESSED);
+	CHECK_EQ(wp.type, WP_TYPE_WHITE);
+}
+
+//syntax errors are sticky and report their offset
+static void checkError(const std::string& doc, size_t offset) {
+	TxtJsonReader r(doc.data(), doc.size());
+	const char* key;
+	size_t len;
+	if (r.beginObject()) {
+		while (r.nextMember(key, len)) {
+			if (!r.skipValue()) break;
+		}
+	}
+	CHECK(!r.ok());
+	CHECK_EQ(r.getErrorOffset(), offset);
+	int i;
+	CHECK(!r.readInt(i));
+	CHECK(!r.beginObject());
+}
+
+static void testErrors() {
+	checkError("", 0);
+	checkError("[1]", 0);
+	checkError("{\"a\" 1}", 5);
+	checkError("{\"a\":1 \"b\":2}", 7);
+	checkError("{\"a\":\"open", 10);
+	checkError("{\"a\":\"\\x\"}", 7);
+	checkError("{\"a\":\"\\u12g4\"}", 7);
+	checkError("{\"a\":-}", 6);
+	checkError("{\"a\":1.}", 7);
+	checkError("{\"a\":nul}", 5);
+	checkError("{\"a\":[1,2}", 9);
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testValues();
+	ft::testSkip();
+	ft::testErrors();
+	return TEST_RESULT();
+}
@@ -0,0 +1,122 @@
+/*
+ * TxtJsonWriterTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//TxtJsonWriter against "sout << Json::Value" of jsoncpp
+
+#include <sstream>
+#include <limits>
+
+#include "TxtTest.h"
+#include "TxtJsonWriter.h"
+
+#include "json/json.h"
+
+
+namespace ft {
+
+
+static std::string jsoncpp(const Json::Value& v) {
+	std::ostringstream sout;
+	sout << v;
+	return sout.str();
+}
+
+static void testScalars() {
+	TxtJsonWriter jw;
+	Json::Value v;
+	jw.beginObject();
+	jw.key("b").valueBool(true);              v["b"] = true;
+	jw.key("d").valueDouble(0.1);             v["d"] = 0.1;
+	jw.key("e").valueDouble(1e300);           v["e"] = 1e300;
+	jw.key("f").valueDouble(95.);             v["f"] = 95.;
+	jw.key("g").valueDouble(-2.5);            v["g"] = -2.5;
+	jw.key("i").valueInt(-42);                v["i"] = -42;
+	jw.key("l").valueInt(INT64_MIN);          v["l"] = (Json::Int64)INT64_MIN;
+	jw.key("m").valueInt(INT64_MAX);          v["m"] = (Json::Int64)INT64_MAX;
+	jw.key("n").valueNull();                  v["n"] = Json::Value();
+	jw.key("z").valueInt(0);                  v["z"] = 0;
+	jw.endObject();
+	CHECK_EQ(jw.str(), jsoncpp(v));
+}
+
+static void testStrings() {
+	//quotes, control characters, 2-4 byte UTF-8 and invalid sequences
+	const char* s[] = { "plain", "a\"b\\c", "tab\tnl\ncr\rbs\bff\f", "\x01\x1f", "\xc3\xa4\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xc3", "\xe2\x82" };
+	TxtJsonWriter jw;
+	Json::Value v(Json::arrayValue);
+	jw.beginArray();
+	for (size_t i = 0; i < sizeof(s)/sizeof(s[0]); i++) {
+		jw.valueString(s[i]);
+		v.append(s[i]);
+	}
+	jw.endArray();
+	CHECK_EQ(jw.str(), jsoncpp(v));
+	//embedded NUL
+	jw.clear();
+	jw.valueString(std::string("a\0b", 3));
+	CHECK_EQ(jw.str(), std::string("\"a\\u0000b\""));
+}
+
+static void testNested() {
+	TxtJsonWriter jw;
+	Json::Value v;
+	jw.beginObject();
+	jw.key("empty").beginObject().endObject();
+	v["empty"] = Json::Value(Json::objectValue);
+	jw.key("list").beginArray();
+	for (int i = 0; i < 3; i++) {
+		jw.beginObject();
+		jw.key("id").valueInt(i);
+		jw.key("tags").beginArray().valueString("x").valueInt(i).endArray();
+		jw.endObject();
+		Json::Value e;
+		e["id"] = i;
+		e["tags"].append("x");
+		e["tags"].append(i);
+		v["list"].append(e);
+	}
+	jw.endArray();
+	jw.key("none").beginArray().endArray();
+	v["none"] = Json::Value(Json::arrayValue);
+	jw.key("ts").valueString("2026-10-17T12:00:00.000Z");
+	v["ts"] = "2026-10-17T12:00:00.000Z";
+	jw.endObject();
+	CHECK_EQ(jw.str(), jsoncpp(v));
+}
+
+static void testNonFinite() {
+	TxtJsonWriter jw;
+	jw.beginArray();
+	jw.valueDouble(std::numeric_limits<double>::quiet_NaN());
+	jw.valueDouble(std::numeric_limits<double>::infinity());
+	jw.valueDouble(-std::numeric_limits<double>::infinity());
+	jw.endArray();
+	CHECK_EQ(jw.str(), std::string("[\n\tnull,\n\t1e+9999,\n\t-1e+9999\n]"));
+}
+
+static void testLocal() {
+	//the thread writer is cleared for each document
+	TxtJsonWriter& a = TxtJsonWriter::local();
+	a.beginObject().key("a").valueInt(1).endObject();
+	TxtJsonWriter& b = TxtJsonWriter::local();
+	CHECK(&a == &b);
+	CHECK_EQ(b.size(), (size_t)0);
+	b.beginObject().key("b").valueInt(2).endObject();
+	CHECK_EQ(b.str(), std::string("{\n\t\"b\" : 2\n}"));
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testScalars();
+	ft::testStrings();
+	ft::testNested();
+	ft::testNonFinite();
+	ft::testLocal();
+	return TEST_RESULT();
+}
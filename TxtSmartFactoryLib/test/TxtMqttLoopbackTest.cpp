@@ -0,0 +1,155 @@
+/*
+ * TxtMqttLoopbackTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//TxtMqttLoopback: delivery, retained messages and a slow subscriber
+
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "TxtTest.h"
+#include "TxtMqttLoopback.h"
+
+
+namespace ft {
+
+
+class TestCallback : public mqtt::callback
+{
+public:
+	TestCallback() : arrived(0), retained(0), hold(false) {}
+	void message_arrived(mqtt::const_message_ptr msg) override {
+		//a slow station: the inbox fills up while hold is set
+		while (hold) usleep(1000);
+		if (msg->is_retained()) retained++;
+		arrived++;
+	}
+	std::atomic<int> arrived;
+	std::atomic<int> retained;
+	std::atomic<bool> hold;
+};
+
+
+static bool waitFor(std::function<bool()> cond, int timeout_ms) {
+	auto ts = std::chrono::steady_clock::now();
+	while (!cond()) {
+		if (elapsed_us(ts) > timeout_ms * 1000.) return false;
+		usleep(1000);
+	}
+	return true;
+}
+
+static mqtt::const_message_ptr message(const std::string& topic, int qos, bool retained=false) {
+	auto msg = mqtt::make_message(topic, "{}");
+	msg->set_qos(qos);
+	msg->set_retained(retained);
+	return msg;
+}
+
+static void testDeliver() {
+	TestCallback cbA, cbB;
+	TxtMqttLoopback a("a"), b("b");
+	a.setCallback(cbA);
+	b.setCallback(cbB);
+	CHECK(a.connect(1000));
+	CHECK(b.connect(1000));
+	CHECK(b.publish(message("f/t/state/hbw", 1, true))->getReturnCode() == 0);
+	//retained message on subscribe, again for each new matching filter
+	a.subscribe(std::vector<std::string>{ "f/t/state/#" }, 1, nullptr);
+	CHECK(waitFor([&]() { return cbA.retained == 1; }, 1000));
+	a.subscribe(std::vector<std::string>{ "f/t/+/hbw" }, 1, nullptr);
+	CHECK(waitFor([&]() { return cbA.retained == 2; }, 1000));
+	//overlapping filters: one delivery
+	b.publish(message("f/t/state/hbw", 1));
+	b.publish(message("f/t/state/vgr", 0));
+	b.publish(message("f/t/other", 1));
+	CHECK(waitFor([&]() { return cbA.arrived == 4; }, 1000));
+	//empty retained message clears the topic, it is delivered as usual
+	b.publish(mqtt::make_message("f/t/state/hbw", "", 1, true));
+	CHECK(waitFor([&]() { return cbA.arrived == 5; }, 1000));
+	b.subscribe(std::vector<std::string>{ "f/t/#" }, 1, nullptr);
+	usleep(10000);
+	CHECK_EQ(cbA.arrived.load(), 5);
+	CHECK_EQ(cbA.retained.load(), 2);
+	CHECK_EQ(cbB.arrived.load(), 0);
+	a.disconnect(1000);
+	b.disconnect(1000);
+}
+
+static void testSlowSubscriber() {
+	TestCallback cbA, cbB, cbC;
+	TxtMqttLoopback a("a"), b("b"), c("c");
+	a.setCallback(cbA);
+	b.setCallback(cbB);
+	c.setCallback(cbC);
+	CHECK(a.connect(1000));
+	CHECK(b.connect(1000));
+	CHECK(c.connect(1000));
+	a.subscribe(std::vector<std::string>{ "f/t/slow" }, 1, nullptr);
+	TxtMqttLoopbackStats st0 = TxtMqttLoopbackBus::instance().getStats();
+
+	//b blocks on the full inbox of a
+	cbA.hold = true;
+	int n = LOOPBACK_QUEUE_SIZE + 16;
+	std::atomic<int> ok(0);
+	std::thread pub([&]() {
+		for (int i = 0; i < n; i++) {
+			if (b.publish(message("f/t/slow", 1))->getReturnCode() == 0) ok++;
+		}
+	});
+	CHECK(waitFor([&]() { return TxtMqttLoopbackBus::instance().getStats().delivered - st0.delivered >= LOOPBACK_QUEUE_SIZE; }, 1000));
+	usleep(10000);
+	//the table is not locked by the waiting publisher
+	auto ts = std::chrono::steady_clock::now();
+	c.subscribe(std::vector<std::string>{ "f/t/fast" }, 1, nullptr);
+	b.publish(message("f/t/fast", 1));
+	CHECK(waitFor([&]() { return cbC.arrived == 1; }, 1000));
+	double us = elapsed_us(ts);
+	CHECK(us < LOOPBACK_BLOCK_MS * 1000. / 4);
+	std::cout << "subscribe and deliver while a publisher waits: " << us << " us" << std::endl;
+
+	//the publisher continues as soon as a has space
+	cbA.hold = false;
+	pub.join();
+	CHECK_EQ(ok.load(), n);
+	CHECK(waitFor([&]() { return cbA.arrived == n; }, 2000));
+	TxtMqttLoopbackStats st = TxtMqttLoopbackBus::instance().getStats();
+	CHECK_EQ(st.failed, st0.failed);
+
+	//detach wakes a waiting publisher, its delivery fails
+	cbA.hold = true;
+	ok = 0;
+	std::thread pub2([&]() {
+		for (int i = 0; i < n; i++) {
+			if (b.publish(message("f/t/slow", 1))->getReturnCode() == 0) ok++;
+		}
+	});
+	CHECK(waitFor([&]() { return TxtMqttLoopbackBus::instance().getStats().delivered - st.delivered >= LOOPBACK_QUEUE_SIZE; }, 1000));
+	ts = std::chrono::steady_clock::now();
+	TxtMqttLoopbackBus::instance().detach(&a);
+	pub2.join();
+	us = elapsed_us(ts);
+	CHECK(us < LOOPBACK_BLOCK_MS * 1000. / 4);
+	CHECK_EQ(ok.load(), n - 1);
+	CHECK_EQ(TxtMqttLoopbackBus::instance().getStats().failed - st.failed, (uint64_t)1);
+	cbA.hold = false;
+	a.disconnect(1000);
+	b.disconnect(1000);
+	c.disconnect(1000);
+	CHECK_EQ(TxtMqttLoopbackBus::instance().getStats().clients, (size_t)0);
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testLoggers();
+	ft::testDeliver();
+	ft::testSlowSubscriber();
+	return TEST_RESULT();
+}
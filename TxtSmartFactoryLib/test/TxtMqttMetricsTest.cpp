@@ -0,0 +1,165 @@
+/*
+ * TxtMqttMetricsTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//slot table and histograms of TxtMqttMetrics
+
+#include <thread>
+#include <vector>
+#include <set>
+
+#include "TxtTest.h"
+#include "TxtMqttMetrics.h"
+
+
+namespace ft {
+
+
+#define TEST_THREADS 4
+#define TEST_RECORDS 10000
+
+
+static std::string topic(int i) {
+	return "f/i/test/" + std::to_string(i);
+}
+
+static const TxtMqttTopicMetrics* find(const std::vector<TxtMqttTopicMetrics>& v, const std::string& topic) {
+	for (size_t i = 0; i < v.size(); i++) {
+		if (v[i].topic == topic) return &v[i];
+	}
+	return NULL;
+}
+
+static void testBucket() {
+	CHECK_EQ(TxtMqttMetrics::bucket(0), 0);
+	CHECK_EQ(TxtMqttMetrics::bucket(1), 1);
+	CHECK_EQ(TxtMqttMetrics::bucket(2), 2);
+	CHECK_EQ(TxtMqttMetrics::bucket(3), 2);
+	CHECK_EQ(TxtMqttMetrics::bucket(4), 3);
+	CHECK_EQ(TxtMqttMetrics::bucket(1023), 10);
+	CHECK_EQ(TxtMqttMetrics::bucket(1024), 11);
+	CHECK_EQ(TxtMqttMetrics::bucket((1ULL << (METRICS_HIST_BUCKETS-1)) - 1), METRICS_HIST_BUCKETS-1);
+	CHECK_EQ(TxtMqttMetrics::bucket(1ULL << 40), METRICS_HIST_BUCKETS-1);
+	CHECK_EQ(TxtMqttMetrics::bucket(UINT64_MAX), METRICS_HIST_BUCKETS-1);
+}
+
+static void testSlots() {
+	TxtMqttMetrics m;
+	std::set<int> used;
+	for (int i = 0; i < METRICS_MAX_TOPICS; i++) {
+		int s = m.slot(topic(i));
+		CHECK(s >= 0);
+		CHECK(used.insert(s).second);
+	}
+	//same topic, same slot
+	for (int i = 0; i < METRICS_MAX_TOPICS; i++) {
+		CHECK(used.count(m.slot(topic(i))) == 1);
+	}
+	//table full: not recorded
+	CHECK_EQ(m.slot("f/i/other"), -1);
+	m.enqueued(-1, 10);
+	m.sent(-1, 10);
+	m.acked(-1, 10, 1000);
+	m.failed(-1);
+	std::vector<TxtMqttTopicMetrics> v;
+	m.getSnapshot(v);
+	CHECK_EQ(v.size(), (size_t)METRICS_MAX_TOPICS);
+	CHECK(find(v, "f/i/other") == NULL);
+
+	//topics are truncated, the longer one shares the slot
+	TxtMqttMetrics t;
+	std::string longTopic(METRICS_TOPIC_LEN + 10, 'x');
+	int s = t.slot(longTopic);
+	CHECK(s >= 0);
+	CHECK_EQ(t.slot(longTopic + "y"), s);
+	CHECK_EQ(t.slot(longTopic.substr(0, METRICS_TOPIC_LEN - 1)), s);
+	CHECK(t.slot(longTopic.substr(0, METRICS_TOPIC_LEN - 2)) != s);
+	t.getSnapshot(v);
+	CHECK_EQ(v.size(), (size_t)2);
+	CHECK(find(v, longTopic.substr(0, METRICS_TOPIC_LEN - 1)) != NULL);
+}
+
+static void testRecord() {
+	TxtMqttMetrics m;
+	int s = m.slot("f/i/state/hbw");
+	m.enqueued(s, 100);
+	m.enqueued(s, 3000);
+	m.sent(s, 5);
+	m.sent(s, 700);
+	m.acked(s, 2000, 10000);
+	m.acked(s, 7600, 10000);
+	m.acked(s, 7500, 10000);
+	m.failed(s);
+	std::vector<TxtMqttTopicMetrics> v;
+	m.getSnapshot(v);
+	CHECK_EQ(v.size(), (size_t)1);
+	const TxtMqttTopicMetrics* t = find(v, "f/i/state/hbw");
+	CHECK(t != NULL);
+	if (!t) return;
+	CHECK_EQ(t->enqueued, (uint64_t)2);
+	CHECK_EQ(t->bytes, (uint64_t)3100);
+	CHECK_EQ(t->size[TxtMqttMetrics::bucket(100)], (uint64_t)1);
+	CHECK_EQ(t->size[TxtMqttMetrics::bucket(3000)], (uint64_t)1);
+	CHECK_EQ(t->sent, (uint64_t)2);
+	CHECK_EQ(t->queueMax_us, (uint64_t)700);
+	CHECK_EQ(t->queue_us[TxtMqttMetrics::bucket(5)], (uint64_t)1);
+	CHECK_EQ(t->acked, (uint64_t)3);
+	CHECK_EQ(t->ackMax_us, (uint64_t)7600);
+	CHECK_EQ(t->slow, (uint64_t)0);
+	CHECK_EQ(t->failed, (uint64_t)1);
+
+	//7600us of a 10ms timeout is slow, 7500us is not
+	m.reset();
+	m.acked(s, 7600, 10);
+	m.acked(s, 7500, 10);
+	m.getSnapshot(v);
+	t = find(v, "f/i/state/hbw");
+	CHECK(t != NULL);
+	if (!t) return;
+	CHECK_EQ(t->slow, (uint64_t)1);
+	CHECK_EQ(t->enqueued, (uint64_t)0);
+	CHECK_EQ(t->ackMax_us, (uint64_t)7600);
+	//reset keeps the slot
+	CHECK_EQ(m.slot("f/i/state/hbw"), s);
+}
+
+static void testThreads() {
+	//threads claim the same topics concurrently, no count is lost
+	TxtMqttMetrics m;
+	std::vector<std::thread> threads;
+	for (int n = 0; n < TEST_THREADS; n++) {
+		threads.push_back(std::thread([&m, n]() {
+			for (int i = 0; i < TEST_RECORDS; i++) {
+				int s = m.slot(topic(i % 8));
+				m.enqueued(s, 10);
+				m.sent(s, (uint64_t)(n * TEST_RECORDS + i));
+			}
+		}));
+	}
+	for (auto& t : threads) t.join();
+	std::vector<TxtMqttTopicMetrics> v;
+	m.getSnapshot(v);
+	CHECK_EQ(v.size(), (size_t)8);
+	uint64_t enqueued = 0, queueMax_us = 0;
+	for (auto const& t : v) {
+		CHECK_EQ(t.enqueued, t.sent);
+		enqueued += t.enqueued;
+		if (t.queueMax_us > queueMax_us) queueMax_us = t.queueMax_us;
+	}
+	CHECK_EQ(enqueued, (uint64_t)(TEST_THREADS * TEST_RECORDS));
+	CHECK_EQ(queueMax_us, (uint64_t)(TEST_THREADS * TEST_RECORDS - 1));
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testBucket();
+	ft::testSlots();
+	ft::testRecord();
+	ft::testThreads();
+	return TEST_RESULT();
+}
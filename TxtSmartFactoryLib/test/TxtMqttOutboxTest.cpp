@@ -0,0 +1,216 @@
+/*
+ * TxtMqttOutboxTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//ring file of TxtMqttOutbox: recovery, wraparound, overflow and torn records
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "TxtTest.h"
+#include "TxtMqttOutbox.h"
+
+
+namespace ft {
+
+
+#define TEST_RING_SIZE 1024
+#define TEST_HEADER_SIZE 64 // Header_t
+#define TEST_RECORD_SIZE 32 // Record_t
+#define TEST_TOPIC "t/x"
+#define TEST_PAYLOAD_LEN 77 // record: 32+3+77 = 112 bytes, does not divide the ring
+
+
+typedef std::vector<std::pair<uint64_t, mqtt::const_message_ptr> > Messages;
+
+
+static std::string tempFile() {
+	char name[] = "/tmp/TxtMqttOutboxTest-XXXXXX";
+	int fd = mkstemp(name);
+	if (fd >= 0) ::close(fd);
+	return name;
+}
+
+static std::string payload(uint64_t i) {
+	std::string p(TEST_PAYLOAD_LEN, 'a' + (char)(i % 26));
+	snprintf(&p[0], 9, "%08llu", (unsigned long long)i);
+	return p;
+}
+
+static mqtt::const_message_ptr message(uint64_t i, int qos=1, bool retained=false) {
+	auto msg = mqtt::make_message(TEST_TOPIC, payload(i));
+	msg->set_qos(qos);
+	msg->set_retained(retained);
+	return msg;
+}
+
+//overwrites one byte of the file
+static void corrupt(const std::string& filename, long offset) {
+	FILE* f = fopen(filename.c_str(), "r+b");
+	CHECK(f != NULL);
+	if (!f) return;
+	fseek(f, offset, SEEK_SET);
+	int c = fgetc(f);
+	fseek(f, offset, SEEK_SET);
+	fputc(c ^ 0xFF, f);
+	fclose(f);
+}
+
+static void testRecover() {
+	std::string filename = tempFile();
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		CHECK_EQ(ob.append(message(1, 1, false)), (uint64_t)1);
+		CHECK_EQ(ob.append(message(2, 2, true)), (uint64_t)2);
+		CHECK_EQ(ob.append(message(3, 1, true)), (uint64_t)3);
+		//out of order PUBACK: the tail stays at the first record
+		ob.ack(2);
+		ob.ack(2);
+		ob.ack(99);
+		TxtMqttOutboxStats st = ob.getStats();
+		CHECK_EQ(st.depth, (size_t)2);
+		CHECK_EQ(st.acked, (uint64_t)1);
+		CHECK_EQ(st.bytes, (size_t)336);
+	}
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		CHECK_EQ(ob.getStats().recovered, (uint64_t)2);
+		Messages msgs;
+		ob.getMessages(msgs);
+		CHECK_EQ(msgs.size(), (size_t)2);
+		if (msgs.size() == 2) {
+			CHECK_EQ(msgs[0].first, (uint64_t)1);
+			CHECK_EQ(msgs[0].second->get_topic(), std::string(TEST_TOPIC));
+			CHECK_EQ(msgs[0].second->get_payload_str(), payload(1));
+			CHECK_EQ(msgs[0].second->get_qos(), 1);
+			CHECK(!msgs[0].second->is_retained());
+			CHECK_EQ(msgs[1].first, (uint64_t)3);
+			CHECK_EQ(msgs[1].second->get_payload_str(), payload(3));
+			CHECK(msgs[1].second->is_retained());
+		}
+		//seq numbers continue after the recovered ones
+		CHECK_EQ(ob.append(message(4)), (uint64_t)4);
+		ob.ack(1);
+		ob.ack(3);
+		ob.ack(4);
+		CHECK_EQ(ob.getStats().depth, (size_t)0);
+		CHECK_EQ(ob.getStats().bytes, (size_t)0);
+	}
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		CHECK_EQ(ob.getStats().recovered, (uint64_t)0);
+		CHECK_EQ(ob.append(message(5)), (uint64_t)5);
+	}
+	unlink(filename.c_str());
+}
+
+static void testWrap() {
+	//records straddle the end of the ring, the crc runs over the wrap
+	std::string filename = tempFile();
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		for (uint64_t i = 1; i <= 50; i++) {
+			CHECK_EQ(ob.append(message(i)), i);
+			if (i > 3) ob.ack(i - 3);
+		}
+		CHECK_EQ(ob.getStats().overflow, (uint64_t)0);
+		CHECK_EQ(ob.getStats().depth, (size_t)3);
+	}
+	TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+	CHECK(ob.open());
+	CHECK_EQ(ob.getStats().recovered, (uint64_t)3);
+	Messages msgs;
+	ob.getMessages(msgs);
+	CHECK_EQ(msgs.size(), (size_t)3);
+	for (size_t i = 0; i < msgs.size(); i++) {
+		CHECK_EQ(msgs[i].first, (uint64_t)(48 + i));
+		CHECK_EQ(msgs[i].second->get_payload_str(), payload(48 + i));
+	}
+	unlink(filename.c_str());
+}
+
+static void testOverflow() {
+	std::string filename = tempFile();
+	TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+	CHECK(ob.open());
+	//9 records of 112 bytes fit, the oldest are dropped
+	for (uint64_t i = 1; i <= 20; i++) {
+		CHECK_EQ(ob.append(message(i)), i);
+	}
+	TxtMqttOutboxStats st = ob.getStats();
+	CHECK_EQ(st.overflow, (uint64_t)11);
+	CHECK_EQ(st.depth, (size_t)9);
+	CHECK_EQ(st.depthMax, (size_t)9);
+	CHECK(st.bytes <= (size_t)TEST_RING_SIZE);
+	Messages msgs;
+	ob.getMessages(msgs);
+	CHECK_EQ(msgs.size(), (size_t)9);
+	if (!msgs.empty()) CHECK_EQ(msgs[0].first, (uint64_t)12);
+	//PUBACK of a dropped message is ignored
+	ob.ack(5);
+	CHECK_EQ(ob.getStats().depth, (size_t)9);
+	//larger than half the ring: not stored
+	CHECK_EQ(ob.append(mqtt::make_message(TEST_TOPIC, std::string(TEST_RING_SIZE / 2, 'x'))), (uint64_t)0);
+	CHECK_EQ(ob.getStats().rejected, (uint64_t)1);
+	unlink(filename.c_str());
+}
+
+static void testTorn() {
+	std::string filename = tempFile();
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		for (uint64_t i = 1; i <= 3; i++) ob.append(message(i));
+	}
+	//payload byte of the third record
+	corrupt(filename, TEST_HEADER_SIZE + 2 * 112 + TEST_RECORD_SIZE + 3 + 10);
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		CHECK_EQ(ob.getStats().recovered, (uint64_t)2);
+		CHECK_EQ(ob.getStats().bytes, (size_t)224);
+		//the seq of the torn record is not used again
+		CHECK_EQ(ob.append(message(4)), (uint64_t)4);
+	}
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		CHECK_EQ(ob.getStats().recovered, (uint64_t)3);
+	}
+	//invalid magic: content discarded
+	corrupt(filename, 0);
+	{
+		TxtMqttOutbox ob(filename, TEST_RING_SIZE);
+		CHECK(ob.open());
+		CHECK_EQ(ob.getStats().recovered, (uint64_t)0);
+		CHECK_EQ(ob.append(message(1)), (uint64_t)1);
+	}
+	//other ring size: content discarded
+	{
+		TxtMqttOutbox ob(filename, 2 * TEST_RING_SIZE);
+		CHECK(ob.open());
+		CHECK_EQ(ob.getStats().recovered, (uint64_t)0);
+	}
+	unlink(filename.c_str());
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testLoggers();
+	ft::testRecover();
+	ft::testWrap();
+	ft::testOverflow();
+	ft::testTorn();
+	return TEST_RESULT();
+}
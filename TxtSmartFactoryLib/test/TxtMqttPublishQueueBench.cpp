@@ -0,0 +1,206 @@
+/*
+ * TxtMqttPublishQueueBench.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//publishes/s and caller latency of the publish queue against a broker stand-in
+//with a fixed round trip, compared to publish and wait as before the queue
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <stdio.h>
+
+#include "TxtTest.h"
+#include "TxtMqttPublishQueue.h"
+
+
+#define BENCH_RTT_US 2000  // broker round trip
+#define BENCH_MESSAGES 2000
+#define BENCH_PAYLOAD 200  // bytes, a typical state message
+
+
+namespace ft {
+
+
+class BenchDelivery : public TxtMqttDelivery
+{
+public:
+	BenchDelivery() : complete(false) {}
+	bool isComplete() override { return complete; }
+	int getReturnCode() override { return 0; }
+	std::atomic<bool> complete;
+};
+
+
+//acks each publish BENCH_RTT_US after it, in order, on its own thread like paho
+class BenchTransport : public TxtMqttTransport
+{
+public:
+	BenchTransport() : stop(false), thread(&BenchTransport::run, this) {}
+	~BenchTransport() {
+		{
+			std::lock_guard<std::mutex> lk(mtx);
+			stop = true;
+		}
+		cond.notify_all();
+		thread.join();
+	}
+
+	bool isConnected() override { return true; }
+	bool connect(long) override { return true; }
+	bool disconnect(long) override { return true; }
+	void setCallback(mqtt::callback&) override {}
+	void setWill(const mqtt::message&) override {}
+	int setMqttVersion(int version) override { return version; }
+	void subscribe(const std::vector<std::string>&, int, std::function<void(bool)> done) override { done(true); }
+	bool unsubscribe(const std::vector<std::string>&, long) override { return true; }
+
+	TxtMqttDeliveryPtr publish(mqtt::const_message_ptr) override {
+		std::shared_ptr<BenchDelivery> d = std::make_shared<BenchDelivery>();
+		std::lock_guard<std::mutex> lk(mtx);
+		pending.push_back(std::make_pair(std::chrono::steady_clock::now() + std::chrono::microseconds(BENCH_RTT_US), d));
+		cond.notify_all();
+		return d;
+	}
+	void setDeliveryDone(std::function<void()> fn) override {
+		std::lock_guard<std::mutex> lk(mtx);
+		done = fn;
+	}
+
+protected:
+	void run() {
+		std::unique_lock<std::mutex> lk(mtx);
+		while (!stop) {
+			if (pending.empty()) {
+				cond.wait(lk);
+				continue;
+			}
+			auto ts = pending.front().first;
+			if (std::chrono::steady_clock::now() < ts) {
+				cond.wait_until(lk, ts);
+				continue;
+			}
+			pending.front().second->complete = true;
+			pending.pop_front();
+			std::function<void()> fn = done;
+			lk.unlock();
+			if (fn) fn();
+			lk.lock();
+		}
+	}
+
+	std::mutex mtx;
+	std::condition_variable cond;
+	std::deque<std::pair<std::chrono::steady_clock::time_point, std::shared_ptr<BenchDelivery> > > pending;
+	std::function<void()> done;
+	bool stop;
+	std::thread thread;
+};
+
+
+static mqtt::message_ptr benchMessage(const std::string& topic) {
+	mqtt::message_ptr msg = mqtt::make_message(topic, std::string(BENCH_PAYLOAD, 'x'));
+	msg->set_qos(1);
+	return msg;
+}
+
+static void report(const char* name, std::vector<double>& lat_us, double total_us) {
+	std::sort(lat_us.begin(), lat_us.end());
+	double sum = 0.0;
+	for (size_t i = 0; i < lat_us.size(); i++) sum += lat_us[i];
+	printf("%-28s %8.0f msg/s  caller avg %8.1f us  p50 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+			name, lat_us.size() * 1e6 / total_us, sum / lat_us.size(),
+			lat_us[lat_us.size() / 2], lat_us[lat_us.size() * 99 / 100], lat_us.back());
+}
+
+//publish and wait for the ack in the caller, the path before the queue
+static void benchSync() {
+	BenchTransport transport;
+	std::vector<double> lat;
+	auto ts0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < BENCH_MESSAGES; i++) {
+		mqtt::message_ptr msg = benchMessage("f/i/state/hbw");
+		auto ts = std::chrono::steady_clock::now();
+		TxtMqttDeliveryPtr tok = transport.publish(msg);
+		while (!tok->isComplete()) std::this_thread::sleep_for(std::chrono::microseconds(50));
+		lat.push_back(elapsed_us(ts));
+	}
+	report("publish and wait", lat, elapsed_us(ts0));
+}
+
+//burst of pushes, the queue drains with PUBLISH_MAX_INFLIGHT in flight
+static void benchQueue() {
+	BenchTransport transport;
+	TxtMqttPublishQueue queue(transport);
+	queue.startThread();
+	std::vector<double> lat;
+	auto ts0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < BENCH_MESSAGES; i++) {
+		mqtt::message_ptr msg = benchMessage("f/i/state/hbw");
+		auto ts = std::chrono::steady_clock::now();
+		queue.push(msg, 60000);
+		lat.push_back(elapsed_us(ts));
+	}
+	queue.flush(60000);
+	report("queue, burst", lat, elapsed_us(ts0));
+	TxtMqttPublishStats st = queue.getStats();
+	printf("%-28s blocked:%llu dropped:%llu completed:%llu\n", "",
+			(unsigned long long)st.blocked, (unsigned long long)st.dropped, (unsigned long long)st.completed);
+	queue.stopThread();
+}
+
+//a second publisher of the client sends one message per ms while the first
+//floods the queue, with the client mutex held in push() or released before
+static void benchClientLock(bool pushLocked) {
+	BenchTransport transport;
+	TxtMqttPublishQueue queue(transport);
+	queue.startThread();
+	std::mutex clientMutex;
+	std::atomic<bool> flooding(true);
+	std::thread flood([&]() {
+		for (int i = 0; i < BENCH_MESSAGES; i++) {
+			std::unique_lock<std::mutex> lk(clientMutex);
+			mqtt::message_ptr msg = benchMessage("f/i/state/vgr");
+			if (!pushLocked) lk.unlock();
+			queue.push(msg, 60000);
+		}
+		flooding = false;
+	});
+	std::vector<double> lat;
+	auto ts0 = std::chrono::steady_clock::now();
+	while (flooding) {
+		auto ts = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> lk(clientMutex);
+		mqtt::message_ptr msg = benchMessage("fl/vgr/ack");
+		if (!pushLocked) lk.unlock();
+		queue.push(msg, 60000);
+		if (lk.owns_lock()) lk.unlock();
+		lat.push_back(elapsed_us(ts));
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	flood.join();
+	queue.flush(60000);
+	report(pushLocked ? "ack, push under client lock" : "ack, push after unlock", lat, elapsed_us(ts0));
+	queue.stopThread();
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testLoggers();
+	printf("broker round trip %d us, %d messages of %d bytes, queue %d, in flight %d\n",
+			BENCH_RTT_US, BENCH_MESSAGES, BENCH_PAYLOAD, PUBLISH_QUEUE_SIZE, PUBLISH_MAX_INFLIGHT);
+	ft::benchSync();
+	ft::benchQueue();
+	ft::benchClientLock(true);
+	ft::benchClientLock(false);
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * TxtMqttTopicPolicyTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//filter ranking, cache and JSON configuration of TxtMqttTopicPolicy
+
+#include "TxtTest.h"
+#include "TxtMqttTopicPolicy.h"
+#include "TxtMqttFactoryClient.h"
+
+
+namespace ft {
+
+
+static void checkPolicy(TxtMqttTopicPolicy& tp, const std::string& topic, int qos, bool retained, long expiry_s) {
+	TxtMqttPolicy_t p = tp.get(topic);
+	CHECK_EQ(p.qos, qos);
+	CHECK_EQ(p.retained, retained);
+	CHECK_EQ(p.expiry_s, expiry_s);
+}
+
+static void testDefaults() {
+	TxtMqttTopicPolicy tp(2, false);
+	checkPolicy(tp, TOPIC_INPUT_LDR, 0, false, 60);
+	checkPolicy(tp, TOPIC_INPUT_CAM, 0, false, 0);
+	checkPolicy(tp, TOPIC_INPUT_CAM "/jpeg", 0, false, 0);
+	checkPolicy(tp, TOPIC_INPUT_METRICS_ "hbw", 0, false, 0);
+	checkPolicy(tp, TOPIC_INPUT_STATE_ "hbw", 1, true, 0);
+	checkPolicy(tp, TOPIC_INPUT_STOCK, 1, true, 0);
+	checkPolicy(tp, TOPIC_INPUT_ALERT, 1, false, 0);
+	//exact filter before "fl/#"
+	checkPolicy(tp, TOPIC_LOCAL_SSC_JOY, 0, false, 1);
+	checkPolicy(tp, "fl/ssc/ack", 1, false, 0);
+	//no matching filter: default of the constructor
+	checkPolicy(tp, "i/unknown", 2, false, 0);
+	checkPolicy(tp, "f/i", 2, false, 0);
+}
+
+static void testRank() {
+	TxtMqttTopicPolicy tp(0, false);
+	TxtMqttPolicy_t p0 = { 0, false, 0 };
+	TxtMqttPolicy_t p1 = { 1, false, 0 };
+	TxtMqttPolicy_t p2 = { 2, true, 5 };
+	tp.set("t/#", p0);
+	checkPolicy(tp, "t/a/b", 0, false, 0);
+	//the cache is cleared by set()
+	tp.set("t/a/+", p1);
+	checkPolicy(tp, "t/a/b", 1, false, 0);
+	checkPolicy(tp, "t/b/b", 0, false, 0);
+	tp.set("t/a/b", p2);
+	checkPolicy(tp, "t/a/b", 2, true, 5);
+	checkPolicy(tp, "t/a/c", 1, false, 0);
+	//"+" is one level, "#" also matches the parent
+	checkPolicy(tp, "t/a/b/c", 0, false, 0);
+	checkPolicy(tp, "t", 0, false, 0);
+	//same filter replaces its rule, QoS is limited to 0..2
+	TxtMqttPolicy_t p9 = { 9, false, 0 };
+	tp.set("t/a/b", p9);
+	checkPolicy(tp, "t/a/b", 2, false, 0);
+	TxtMqttPolicy_t pn = { -1, false, 0 };
+	tp.set("t/a/b", pn);
+	checkPolicy(tp, "t/a/b", 0, false, 0);
+}
+
+static void testJson() {
+	TxtMqttTopicPolicy tp(1, false);
+	Json::Value js;
+	//missing members keep the value of the matching rule
+	js[TOPIC_INPUT_LDR]["qos"] = 1;
+	js[TOPIC_INPUT_STATE_ "dsi"]["retained"] = false;
+	js["x/#"]["expiry_s"] = 30;
+	js["ignored"] = 5;
+	tp.set(js);
+	checkPolicy(tp, TOPIC_INPUT_LDR, 1, false, 60);
+	checkPolicy(tp, TOPIC_INPUT_STATE_ "dsi", 1, false, 0);
+	checkPolicy(tp, TOPIC_INPUT_STATE_ "dso", 1, true, 0);
+	checkPolicy(tp, "x/y", 1, false, 30);
+	checkPolicy(tp, "ignored", 1, false, 0);
+	tp.set(Json::Value("not an object"));
+	checkPolicy(tp, TOPIC_INPUT_LDR, 1, false, 60);
+}
+
+static void testApply() {
+	TxtMqttTopicPolicy tp(1, false);
+	mqtt::message_ptr msg = mqtt::make_message(TOPIC_INPUT_STATE_ "vgr", "{}");
+	tp.apply(msg);
+	CHECK_EQ(msg->get_qos(), 1);
+	CHECK(msg->is_retained());
+	msg = mqtt::make_message(TOPIC_INPUT_LDR, "{}", 2, true);
+	tp.apply(msg);
+	CHECK_EQ(msg->get_qos(), 0);
+	CHECK(!msg->is_retained());
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testLoggers();
+	ft::testDefaults();
+	ft::testRank();
+	ft::testJson();
+	ft::testApply();
+	return TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+/*
+ * TxtMqttTopicRouterTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//topic hash table and selective decode of TxtMqttTopicRouter
+
+#include <string.h>
+
+#include "TxtTest.h"
+#include "TxtMqttTopicRouter.h"
+#include "TxtMqttFactoryClient.h"
+
+
+namespace ft {
+
+
+static void testLookup() {
+	//every known topic maps to its id
+	for (int id = 0; id < TOPIC_ID_COUNT; id++) {
+		std::string topic = TxtMqttTopicRouter::getTopic((TxtMqttTopicId_t)id);
+		CHECK(!topic.empty());
+		CHECK_EQ((int)TxtMqttTopicRouter::lookup(topic), id);
+		//prefix, extension and a changed last character are unknown
+		CHECK_EQ((int)TxtMqttTopicRouter::lookup(topic.substr(0, topic.size()-1)), (int)TOPIC_ID_UNKNOWN);
+		CHECK_EQ((int)TxtMqttTopicRouter::lookup(topic + "/x"), (int)TOPIC_ID_UNKNOWN);
+		std::string changed = topic;
+		changed[changed.size()-1] ^= 0x01;
+		CHECK_EQ((int)TxtMqttTopicRouter::lookup(changed), (int)TOPIC_ID_UNKNOWN);
+		//the length limits the topic, the buffer does not have to end there
+		std::string buf = topic + "trailing";
+		CHECK_EQ((int)TxtMqttTopicRouter::lookup(buf.data(), topic.size()), id);
+	}
+	CHECK_EQ((int)TxtMqttTopicRouter::lookup(""), (int)TOPIC_ID_UNKNOWN);
+	CHECK_EQ((int)TxtMqttTopicRouter::lookup("f/i/state/"), (int)TOPIC_ID_UNKNOWN);
+	CHECK_EQ(std::string(TxtMqttTopicRouter::getTopic(TOPIC_ID_UNKNOWN)), std::string(""));
+	CHECK_EQ(std::string(TxtMqttTopicRouter::getTopic(TOPIC_ID_COUNT)), std::string(""));
+	CHECK_EQ((int)TxtMqttTopicRouter::lookup(TOPIC_LOCAL_VGR_DO), (int)TOPIC_ID_LOCAL_VGR_DO);
+}
+
+static void testDispatch() {
+	TxtMqttTopicRouter router;
+	int called = 0;
+	TxtMqttMessage last(TOPIC_ID_UNKNOWN, mqtt::const_message_ptr());
+	router.add(TOPIC_ID_LOCAL_HBW_ACK, FIELD_TS | FIELD_CODE | FIELD_WORKPIECE, [&](const TxtMqttMessage& m) {
+		called++;
+		last = m;
+	});
+	CHECK_EQ(router.getTopics().size(), (size_t)1);
+	CHECK_EQ(router.getTopics()[0], std::string(TOPIC_LOCAL_HBW_ACK));
+
+	//fields not declared are skipped, nested values included
+	CHECK(router.dispatch(mqtt::make_message(TOPIC_LOCAL_HBW_ACK,
+			"{\"cid\":\"1-2\",\"code\":2,\"skip\":{\"a\":[1,{\"b\":null}],\"c\":\"}\"},"
+			"\"ts\":\"2026-10-17T12:00:00.000Z\",\"workpiece\":{\"id\":\"04a1\",\"state\":\"RAW\",\"type\":\"RED\"}}")));
+	CHECK_EQ(called, 1);
+	CHECK_EQ(last.id, TOPIC_ID_LOCAL_HBW_ACK);
+	CHECK_EQ(last.code, 2);
+	CHECK_EQ(last.ts, std::string("2026-10-17T12:00:00.000Z"));
+	CHECK(last.hasWorkpiece);
+	CHECK_EQ(last.wp.tag_uid, std::string("04a1"));
+	CHECK_EQ(last.wp.type, WP_TYPE_RED);
+	CHECK_EQ(last.wp.state, WP_STATE_RAW);
+	CHECK(last.root.isNull());
+
+	//null workpiece, missing code
+	CHECK(router.dispatch(mqtt::make_message(TOPIC_LOCAL_HBW_ACK, "{\"ts\":\"x\",\"workpiece\":null}")));
+	CHECK_EQ(called, 2);
+	CHECK(!last.hasWorkpiece);
+	CHECK_EQ(last.code, 0);
+
+	//undecodable payloads are counted, the handler is not called
+	CHECK(router.dispatch(mqtt::make_message(TOPIC_LOCAL_HBW_ACK, "{\"code\":")));
+	CHECK(router.dispatch(mqtt::make_message(TOPIC_LOCAL_HBW_ACK, "[1]")));
+	CHECK_EQ(called, 2);
+	TxtMqttHandlerStats st = router.getStats(TOPIC_ID_LOCAL_HBW_ACK);
+	CHECK_EQ(st.count, (uint64_t)4);
+	CHECK_EQ(st.errors, (uint64_t)2);
+
+	//no handler: not dispatched
+	CHECK(!router.dispatch(mqtt::make_message("f/x/unknown", "{}")));
+	CHECK(!router.dispatch(mqtt::make_message(TOPIC_LOCAL_MPO_ACK, "{}")));
+	router.remove(TOPIC_ID_LOCAL_HBW_ACK);
+	CHECK(!router.dispatch(mqtt::make_message(TOPIC_LOCAL_HBW_ACK, "{}")));
+	CHECK(router.getTopics().empty());
+}
+
+static void testRoot() {
+	TxtMqttTopicRouter router;
+	std::string message;
+	int code = -1;
+	router.add(TOPIC_ID_CONFIG_LINK, FIELD_ROOT, [&](const TxtMqttMessage& m) {
+		message = m.root["message"].asString();
+		code = m.code;
+	});
+	CHECK(router.dispatch(mqtt::make_message(TOPIC_CONFIG_LINK, "{\"code\":7,\"message\":\"hi\",\"ts\":\"t\"}")));
+	CHECK_EQ(message, std::string("hi"));
+	CHECK_EQ(code, 7);
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testLoggers();
+	ft::testLookup();
+	ft::testDispatch();
+	ft::testRoot();
+	return TEST_RESULT();
+}
@@ -0,0 +1,47 @@
+/*
+ * TxtTest.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TXTTEST_H_
+#define TXTTEST_H_
+
+#include <iostream>
+#include <chrono>
+
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/null_sink.h"
+
+
+//host tests of TxtSmartFactoryLib: CHECK counts failures, main returns TEST_RESULT()
+static int test_failed __attribute__((unused)) = 0;
+static int test_checked __attribute__((unused)) = 0;
+
+#define CHECK(cond) do { test_checked++; if (!(cond)) { test_failed++; \
+	std::cout << "FAIL " << __FILE__ << ":" << __LINE__ << ": " << #cond << std::endl; } } while (0)
+#define CHECK_EQ(a, b) do { test_checked++; if (!((a) == (b))) { test_failed++; \
+	std::cout << "FAIL " << __FILE__ << ":" << __LINE__ << ": " << #a << " == " << #b \
+	<< " (" << (a) << " != " << (b) << ")" << std::endl; } } while (0)
+#define TEST_RESULT() (std::cout << (test_failed ? "FAILED " : "OK ") << __FILE__ \
+	<< " checks:" << test_checked << " failed:" << test_failed << std::endl, test_failed ? 1 : 0)
+
+
+namespace ft {
+
+
+//the library logs to "console" and "file_logger"
+inline void testLoggers() {
+	if (!spdlog::get("console")) spdlog::create<spdlog::sinks::null_sink_mt>("console");
+	if (!spdlog::get("file_logger")) spdlog::create<spdlog::sinks::null_sink_mt>("file_logger");
+}
+
+inline double elapsed_us(std::chrono::steady_clock::time_point ts) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - ts).count();
+}
+
+
+} /* namespace ft */
+
+
+#endif /* TXTTEST_H_ */
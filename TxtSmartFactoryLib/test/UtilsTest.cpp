@@ -0,0 +1,151 @@
+/*
+ * UtilsTest.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//timestamps of Utils against timegm()/gmtime_r(), local time zone Europe/Berlin
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdexcept>
+
+#include "TxtTest.h"
+#include "Utils.h"
+
+
+namespace ft {
+
+
+#define NS_PER_S 1000000000LL
+
+
+static time_t utc(int y, int mo, int d, int h, int mi, int s) {
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_year = y - 1900;
+	tm.tm_mon = mo - 1;
+	tm.tm_mday = d;
+	tm.tm_hour = h;
+	tm.tm_min = mi;
+	tm.tm_sec = s;
+	return timegm(&tm);
+}
+
+static std::string str(int64_t timestamp) {
+	char sts[25];
+	gettimestampstr(timestamp, sts);
+	return sts;
+}
+
+static std::string strftimeUtc(time_t t, int ms) {
+	struct tm tm;
+	char buf[32];
+	gmtime_r(&t, &tm);
+	size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+	snprintf(buf + n, sizeof(buf) - n, ".%03dZ", ms);
+	return buf;
+}
+
+static bool parse(const std::string& s, int64_t& timestamp) {
+	return parsetimestamp(s.data(), s.size(), timestamp);
+}
+
+//every minute of the three hours around a switch: format, parse and round trip are UTC
+static void checkSwitch(time_t tsSwitch, int gmtoffBefore, int gmtoffAfter) {
+	struct tm tm;
+	time_t t = tsSwitch - 1;
+	localtime_r(&t, &tm);
+	CHECK_EQ(tm.tm_gmtoff, gmtoffBefore);
+	t = tsSwitch;
+	localtime_r(&t, &tm);
+	CHECK_EQ(tm.tm_gmtoff, gmtoffAfter);
+
+	for (time_t t = tsSwitch - 5400; t <= tsSwitch + 5400; t += 60) {
+		int64_t timestamp = (int64_t)t * NS_PER_S + 250 * 1000000LL;
+		std::string s = str(timestamp);
+		CHECK_EQ(s, strftimeUtc(t, 250));
+		int64_t parsed = 0;
+		CHECK(parse(s, parsed));
+		CHECK_EQ(parsed, timestamp);
+	}
+	//last ms before and first ms after the switch are 1 ms apart
+	int64_t before = 0, after = 0;
+	CHECK(parse(strftimeUtc(tsSwitch - 1, 999), before));
+	CHECK(parse(strftimeUtc(tsSwitch, 0), after));
+	CHECK_EQ(after - before, 1000000LL);
+}
+
+static void testDst() {
+	setenv("TZ", "Europe/Berlin", 1);
+	tzset();
+	//2026-03-29 01:00Z: 02:00 CET -> 03:00 CEST, one local hour is skipped
+	checkSwitch(utc(2026, 3, 29, 1, 0, 0), 3600, 7200);
+	//2026-10-25 01:00Z: 03:00 CEST -> 02:00 CET, one local hour is repeated
+	checkSwitch(utc(2026, 10, 25, 1, 0, 0), 7200, 3600);
+
+	//both instants of the repeated local 02:30 have their own UTC string
+	CHECK_EQ(str((int64_t)utc(2026, 10, 25, 0, 30, 0) * NS_PER_S), std::string("2026-10-25T00:30:00.000Z"));
+	CHECK_EQ(str((int64_t)utc(2026, 10, 25, 1, 30, 0) * NS_PER_S), std::string("2026-10-25T01:30:00.000Z"));
+}
+
+static void testTTL() {
+	//the age of a timestamp does not depend on the local offset
+	setenv("TZ", "Europe/Berlin", 1);
+	tzset();
+	int64_t now = getnowtimestamp_ns();
+	std::string s = str(now - 5 * NS_PER_S);
+	CHECK(checkTimestampTTL(s.data(), s.size(), 10 * NS_PER_S));
+	CHECK(trycheckTimestampTTL(s, 10.0));
+	s = str(now - 15 * NS_PER_S);
+	CHECK(!checkTimestampTTL(s.data(), s.size(), 10 * NS_PER_S));
+	s = str(now + 5 * NS_PER_S);
+	CHECK(checkTimestampTTL(s.data(), s.size(), 10 * NS_PER_S));
+	//one hour off, as a publisher stamping local time instead of UTC in winter
+	s = str(now + 3600 * NS_PER_S);
+	CHECK(!trycheckTimestampTTL(s, 10.0));
+	CHECK(!trycheckTimestampTTL("", 10.0));
+}
+
+static void testParse() {
+	int64_t timestamp = 0;
+	CHECK(parse("2028-02-29T12:00:00Z", timestamp));
+	CHECK_EQ(timestamp, (int64_t)utc(2028, 2, 29, 12, 0, 0) * NS_PER_S);
+	CHECK(parse("1970-01-01 00:00:00", timestamp));
+	CHECK_EQ(timestamp, 0LL);
+	CHECK(parse("2026-03-29T00:59:59.123456789Z", timestamp));
+	CHECK_EQ(timestamp, (int64_t)utc(2026, 3, 29, 0, 59, 59) * NS_PER_S + 123456789LL);
+	CHECK(parse("2026-03-29T00:59:59.1234567891Z", timestamp));
+	CHECK_EQ(timestamp, (int64_t)utc(2026, 3, 29, 0, 59, 59) * NS_PER_S + 123456789LL);
+	CHECK_EQ(str(-1), std::string("1969-12-31T23:59:59.999Z"));
+	CHECK_EQ(str((int64_t)utc(2028, 2, 29, 23, 59, 59) * NS_PER_S), std::string("2028-02-29T23:59:59.000Z"));
+
+	const char* invalid[] = { "", "2026-10-17", "2026-10-17T12:00", "2026-10-17T12:00:0Z",
+		"2026/10/17T12:00:00Z", "2026-13-17T12:00:00Z", "2026-10-00T12:00:00Z", "2026-10-17T24:00:00Z",
+		"2026-10-17T12:60:00Z", "2026-10-17T12:00:00.Z", "2026-10-17T12:00:00ZZ", "2026-10-17T12:00:00+02:00",
+		"2026-10-17X12:00:00Z", "-026-10-17T12:00:00Z" };
+	for (size_t i = 0; i < sizeof(invalid)/sizeof(invalid[0]); i++) {
+		CHECK(!parse(invalid[i], timestamp));
+	}
+	try {
+		trygettimepoint("invalid");
+		CHECK(false);
+	} catch (std::invalid_argument&) {
+	}
+	std::chrono::system_clock::time_point tp = trygettimepoint("2026-10-25T01:00:00.000Z");
+	CHECK_EQ((int64_t)std::chrono::system_clock::to_time_t(tp), (int64_t)utc(2026, 10, 25, 1, 0, 0));
+}
+
+
+} /* namespace ft */
+
+
+int main(int argc, char* argv[]) {
+	ft::testLoggers();
+	ft::testDst();
+	ft::testTTL();
+	ft::testParse();
+	return TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+/*
+ * paho.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+//the parts of paho the host tests link against, deps/lib has the ARM libraries only
+
+#include <mqtt/message.h>
+#include "MQTTAsync.h"
+
+
+//TxtMqttPahoTransport::isConnected() is inline, the transport is never connected on the host
+extern "C" int MQTTAsync_isConnected(MQTTAsync handle)
+{
+	return 0;
+}
+
+
+namespace mqtt {
+
+
+constexpr int message::DFLT_QOS;
+constexpr bool message::DFLT_RETAINED;
+const MQTTAsync_message message::DFLT_C_STRUCT = MQTTAsync_message_initializer;
+const string message::EMPTY_STR;
+const binary message::EMPTY_BIN;
+
+message::message(string_ref topic, binary_ref payload, int qos, bool retained)
+	: msg_(DFLT_C_STRUCT), topic_(std::move(topic))
+{
+	set_payload(std::move(payload));
+	set_qos(qos);
+	set_retained(retained);
+}
+
+message::message(string_ref topic, const void* payload, size_t len, int qos, bool retained)
+	: message(std::move(topic), binary_ref(static_cast<const char*>(payload), len), qos, retained)
+{
+}
+
+message::message(const message& other)
+	: msg_(other.msg_), topic_(other.topic_)
+{
+	set_payload(other.payload_);
+}
+
+void message::set_payload(binary_ref payload)
+{
+	payload_ = std::move(payload);
+	if (payload_.empty()) {
+		msg_.payload = nullptr;
+		msg_.payloadlen = 0;
+	} else {
+		msg_.payload = const_cast<binary_ref::value_type*>(payload_.data());
+		msg_.payloadlen = (int)payload_.length();
+	}
+}
+
+void message::clear_payload()
+{
+	set_payload(binary_ref());
+}
+
+
+} /* namespace mqtt */